@@ -121,6 +121,29 @@ typedef enum CborKnownTags {
     CborBase64Tag                  = 34,
     CborRegularExpressionTag       = 35,
     CborMimeMessageTag             = 36,
+    CborTypedArrayUint8Tag         = 64,
+    CborTypedArrayUint16BETag      = 65,
+    CborTypedArrayUint32BETag      = 66,
+    CborTypedArrayUint64BETag      = 67,
+    CborTypedArrayUint8ClampedTag  = 68,
+    CborTypedArrayUint16LETag      = 69,
+    CborTypedArrayUint32LETag      = 70,
+    CborTypedArrayUint64LETag      = 71,
+    CborTypedArraySint8Tag         = 72,
+    CborTypedArraySint16BETag      = 73,
+    CborTypedArraySint32BETag      = 74,
+    CborTypedArraySint64BETag      = 75,
+    CborTypedArraySint16LETag      = 77,
+    CborTypedArraySint32LETag      = 78,
+    CborTypedArraySint64LETag      = 79,
+    CborTypedArrayFloat16BETag     = 80,
+    CborTypedArrayFloat32BETag     = 81,
+    CborTypedArrayFloat64BETag     = 82,
+    CborTypedArrayFloat128BETag    = 83,
+    CborTypedArrayFloat16LETag     = 84,
+    CborTypedArrayFloat32LETag     = 85,
+    CborTypedArrayFloat64LETag     = 86,
+    CborTypedArrayFloat128LETag    = 87,
     CborCOSE_EncryptTag            = 96,
     CborCOSE_MacTag                = 97,
     CborCOSE_SignTag               = 98,
@@ -146,6 +169,29 @@ typedef enum CborKnownTags {
 #define CborBase64Tag CborBase64Tag
 #define CborRegularExpressionTag CborRegularExpressionTag
 #define CborMimeMessageTag CborMimeMessageTag
+#define CborTypedArrayUint8Tag CborTypedArrayUint8Tag
+#define CborTypedArrayUint16BETag CborTypedArrayUint16BETag
+#define CborTypedArrayUint32BETag CborTypedArrayUint32BETag
+#define CborTypedArrayUint64BETag CborTypedArrayUint64BETag
+#define CborTypedArrayUint8ClampedTag CborTypedArrayUint8ClampedTag
+#define CborTypedArrayUint16LETag CborTypedArrayUint16LETag
+#define CborTypedArrayUint32LETag CborTypedArrayUint32LETag
+#define CborTypedArrayUint64LETag CborTypedArrayUint64LETag
+#define CborTypedArraySint8Tag CborTypedArraySint8Tag
+#define CborTypedArraySint16BETag CborTypedArraySint16BETag
+#define CborTypedArraySint32BETag CborTypedArraySint32BETag
+#define CborTypedArraySint64BETag CborTypedArraySint64BETag
+#define CborTypedArraySint16LETag CborTypedArraySint16LETag
+#define CborTypedArraySint32LETag CborTypedArraySint32LETag
+#define CborTypedArraySint64LETag CborTypedArraySint64LETag
+#define CborTypedArrayFloat16BETag CborTypedArrayFloat16BETag
+#define CborTypedArrayFloat32BETag CborTypedArrayFloat32BETag
+#define CborTypedArrayFloat64BETag CborTypedArrayFloat64BETag
+#define CborTypedArrayFloat128BETag CborTypedArrayFloat128BETag
+#define CborTypedArrayFloat16LETag CborTypedArrayFloat16LETag
+#define CborTypedArrayFloat32LETag CborTypedArrayFloat32LETag
+#define CborTypedArrayFloat64LETag CborTypedArrayFloat64LETag
+#define CborTypedArrayFloat128LETag CborTypedArrayFloat128LETag
 #define CborCOSE_EncryptTag CborCOSE_EncryptTag
 #define CborCOSE_MacTag CborCOSE_MacTag
 #define CborCOSE_SignTag CborCOSE_SignTag
@@ -195,11 +241,14 @@ typedef enum CborError {
     CborErrorNestingTooDeep,
     CborErrorUnsupportedType,
     CborErrorUnimplementedValidation,
+    CborErrorUnsupportedSource,     /* operation requires a linear buffer (not cbor_parser_init_reader) */
 
-    /* errors in converting to JSON */
+    /* errors in converting to and from JSON */
     CborErrorJsonObjectKeyIsAggregate = 1280,
     CborErrorJsonObjectKeyNotString,
     CborErrorJsonNotImplemented,
+    CborErrorJsonSyntax,            /* malformed JSON text */
+    CborErrorJsonInvalidMetadata,   /* "$cbor" metadata that does not describe its value */
 
     CborErrorOutOfMemory = (int) (~0U / 2 + 1),
     CborErrorInternalError = (int) (~0U / 2)    /* INT_MAX on two's complement machines */
@@ -220,6 +269,8 @@ typedef CborError (*CborEncoderWriteFunction)(void *, const void *, size_t, Cbor
 enum CborEncoderFlags
 {
     CborIteratorFlag_WriterFunction         = 0x01,
+    CborEncoderFlag_SortMapKeys             = 0x02,
+    CborIteratorFlag_CountOnly              = 0x04,
     CborIteratorFlag_ContainerIsMap_        = 0x20
 };
 
@@ -236,14 +287,84 @@ struct CborEncoder
 };
 typedef struct CborEncoder CborEncoder;
 
+struct CborBufferedWriter
+{
+    CborEncoderWriteFunction writer;
+    void *token;
+    uint8_t *buffer;
+    size_t size;
+    size_t used;
+};
+typedef struct CborBufferedWriter CborBufferedWriter;
+
+struct CborAllocator
+{
+    void *(*allocate)(void *context, size_t size);
+    void *(*reallocate)(void *context, void *ptr, size_t oldSize, size_t newSize);
+    void (*deallocate)(void *context, void *ptr, size_t size);
+    void *context;
+};
+typedef struct CborAllocator CborAllocator;
+
+struct CborGrowableBuffer
+{
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    const CborAllocator *allocator;
+    CborError error;
+};
+typedef struct CborGrowableBuffer CborGrowableBuffer;
+
+struct CborArena
+{
+    CborAllocator allocator;
+    uint8_t *buffer;
+    size_t size;
+    size_t used;
+};
+typedef struct CborArena CborArena;
+
+CBOR_API void cbor_arena_init(CborArena *arena, void *buffer, size_t size);
+CBOR_INLINE_API const CborAllocator *cbor_arena_get_allocator(const CborArena *arena)
+{ return &arena->allocator; }
+CBOR_INLINE_API void cbor_arena_reset(CborArena *arena)
+{ arena->used = 0; }
+CBOR_INLINE_API size_t cbor_arena_get_used_size(const CborArena *arena)
+{ return arena->used; }
+
 static const size_t CborIndefiniteLength = SIZE_MAX;
 
+enum CborShortestFloatFlags
+{
+    CborShortestFloatDefaultFlags           = 0,
+    CborShortestFloatAllowIntegers          = 1
+};
+
 #ifndef CBOR_NO_ENCODER_API
 CBOR_API void cbor_encoder_init(CborEncoder *encoder, uint8_t *buffer, size_t size, int flags);
 CBOR_API void cbor_encoder_init_writer(CborEncoder *encoder, CborEncoderWriteFunction writer, void *);
+CBOR_API void cbor_encoder_init_counting(CborEncoder *encoder);
+CBOR_API void cbor_encoder_init_buffered_writer(CborEncoder *encoder, CborBufferedWriter *bufferedWriter,
+                                                uint8_t *buffer, size_t size, CborEncoderWriteFunction writer,
+                                                void *token);
+CBOR_API CborError cbor_buffered_writer_flush(CborBufferedWriter *bufferedWriter);
+CBOR_API void cbor_encoder_init_growable(CborEncoder *encoder, CborGrowableBuffer *buffer,
+                                         const CborAllocator *allocator, size_t initialCapacity);
+CBOR_API void cbor_growable_buffer_init(CborGrowableBuffer *buffer, const CborAllocator *allocator,
+                                        size_t initialCapacity);
+CBOR_API CborError cbor_growable_buffer_reserve(CborGrowableBuffer *buffer, size_t len);
+CBOR_API uint8_t *cbor_growable_buffer_release(CborGrowableBuffer *buffer, size_t *size);
+CBOR_API void cbor_growable_buffer_free(CborGrowableBuffer *buffer);
 CBOR_API CborError cbor_encode_uint(CborEncoder *encoder, uint64_t value);
 CBOR_API CborError cbor_encode_int(CborEncoder *encoder, int64_t value);
 CBOR_API CborError cbor_encode_negative_int(CborEncoder *encoder, uint64_t absolute_value);
+CBOR_API CborError cbor_encode_uint_array(CborEncoder *encoder, const uint64_t *values, size_t count);
+CBOR_API CborError cbor_encode_int_array(CborEncoder *encoder, const int64_t *values, size_t count);
+CBOR_API CborError cbor_encode_double_array(CborEncoder *encoder, const double *values, size_t count);
+CBOR_API CborError cbor_encode_double_shortest(CborEncoder *encoder, double value, int flags);
+CBOR_API CborError cbor_encode_double_array_shortest(CborEncoder *encoder, const double *values, size_t count,
+                                                     int flags);
 CBOR_API CborError cbor_encode_simple_value(CborEncoder *encoder, uint8_t value);
 CBOR_API CborError cbor_encode_tag(CborEncoder *encoder, CborTag tag);
 CBOR_API CborError cbor_encode_text_string(CborEncoder *encoder, const char *string, size_t length);
@@ -267,6 +388,17 @@ CBOR_INLINE_API CborError cbor_encode_float(CborEncoder *encoder, float value)
 CBOR_INLINE_API CborError cbor_encode_double(CborEncoder *encoder, double value)
 { return cbor_encode_floating_point(encoder, CborDoubleType, &value); }
 
+CBOR_API CborError cbor_encode_uint8_typed_array(CborEncoder *encoder, const uint8_t *data, size_t count);
+CBOR_API CborError cbor_encode_uint16_typed_array(CborEncoder *encoder, const uint16_t *data, size_t count);
+CBOR_API CborError cbor_encode_uint32_typed_array(CborEncoder *encoder, const uint32_t *data, size_t count);
+CBOR_API CborError cbor_encode_uint64_typed_array(CborEncoder *encoder, const uint64_t *data, size_t count);
+CBOR_API CborError cbor_encode_int8_typed_array(CborEncoder *encoder, const int8_t *data, size_t count);
+CBOR_API CborError cbor_encode_int16_typed_array(CborEncoder *encoder, const int16_t *data, size_t count);
+CBOR_API CborError cbor_encode_int32_typed_array(CborEncoder *encoder, const int32_t *data, size_t count);
+CBOR_API CborError cbor_encode_int64_typed_array(CborEncoder *encoder, const int64_t *data, size_t count);
+CBOR_API CborError cbor_encode_float_typed_array(CborEncoder *encoder, const float *data, size_t count);
+CBOR_API CborError cbor_encode_double_typed_array(CborEncoder *encoder, const double *data, size_t count);
+
 CBOR_API CborError cbor_encoder_create_array(CborEncoder *parentEncoder, CborEncoder *arrayEncoder, size_t length);
 CBOR_API CborError cbor_encoder_create_map(CborEncoder *parentEncoder, CborEncoder *mapEncoder, size_t length);
 CBOR_API CborError cbor_encoder_close_container(CborEncoder *parentEncoder, const CborEncoder *containerEncoder);
@@ -286,6 +418,36 @@ CBOR_INLINE_API size_t cbor_encoder_get_extra_bytes_needed(const CborEncoder *en
 {
     return encoder->end ? 0 : (size_t)encoder->data.bytes_needed;
 }
+
+CBOR_INLINE_API size_t cbor_encoder_get_counted_size(const CborEncoder *encoder)
+{
+    return (size_t)encoder->data.bytes_needed;
+}
+
+/* Encoded sizes */
+CBOR_INLINE_API size_t cbor_encoded_size_uint(uint64_t value)
+{
+    return 1 + (value >= 24) + (value > 0xffU) + 2 * (value > 0xffffU) + 4 * (value > 0xffffffffU);
+}
+CBOR_INLINE_API size_t cbor_encoded_size_negative_int(uint64_t absolute_value)
+{ return cbor_encoded_size_uint(absolute_value - 1); }
+CBOR_INLINE_API size_t cbor_encoded_size_int(int64_t value)
+{ return cbor_encoded_size_uint((uint64_t)(value >> 63) ^ (uint64_t)value); }
+CBOR_INLINE_API size_t cbor_encoded_size_simple_value(uint8_t value)
+{ return cbor_encoded_size_uint(value); }
+CBOR_INLINE_API size_t cbor_encoded_size_tag(CborTag tag)
+{ return cbor_encoded_size_uint(tag); }
+CBOR_INLINE_API size_t cbor_encoded_size_string_header(size_t length)
+{ return cbor_encoded_size_uint(length); }
+CBOR_INLINE_API size_t cbor_encoded_size_text_string(size_t length)
+{ return cbor_encoded_size_uint(length) + length; }
+CBOR_INLINE_API size_t cbor_encoded_size_byte_string(size_t length)
+{ return cbor_encoded_size_uint(length) + length; }
+CBOR_INLINE_API size_t cbor_encoded_size_floating_point(CborType fpType)
+{ return 1 + (2U << (fpType - CborHalfFloatType)); }
+CBOR_INLINE_API size_t cbor_encoded_size_container(size_t length)
+{ return length == CborIndefiniteLength ? 2 : cbor_encoded_size_uint(length); }
+CBOR_API size_t cbor_encoded_size_double_shortest(double value, int flags);
 #endif /* CBOR_NO_ENCODER_API */
 
 /* Parser API */
@@ -334,6 +496,7 @@ struct CborParser
         const struct CborParserOperations *ops;
     } source;
     enum CborParserGlobalFlags flags;
+    const CborAllocator *allocator;
 };
 typedef struct CborParser CborParser;
 
@@ -351,9 +514,119 @@ struct CborValue
 };
 typedef struct CborValue CborValue;
 
+struct CborValidationFrame
+{
+    CborValue container;
+    const uint8_t *previousKey;
+    const uint8_t *previousKeyEnd;
+    const uint8_t *currentKey;
+    void *keySet;
+    size_t keySetCapacity;
+    uint32_t entry;
+    uint32_t items;
+    bool isMap;
+    bool expectingValue;
+};
+typedef struct CborValidationFrame CborValidationFrame;
+
+struct CborMappedFile
+{
+    const uint8_t *data;
+    size_t size;
+};
+typedef struct CborMappedFile CborMappedFile;
+
+#ifndef CBOR_STREAM_PARSER_MAX_DEPTH
+#  define CBOR_STREAM_PARSER_MAX_DEPTH 32
+#endif
+
+typedef enum CborStreamEventType {
+    CborStreamValue,
+    CborStreamContainerStart,
+    CborStreamContainerEnd,
+    CborStreamStringStart,
+    CborStreamStringData,
+    CborStreamStringEnd
+} CborStreamEventType;
+
+enum CborStreamEventFlags
+{
+    CborStreamFlag_NegativeInteger          = 0x01,
+    CborStreamFlag_IndefiniteLength         = 0x02
+};
+
+struct CborStreamEvent
+{
+    uint64_t value;
+    const uint8_t *data;
+    size_t size;
+    uint8_t event;
+    uint8_t type;
+    uint8_t flags;
+};
+typedef struct CborStreamEvent CborStreamEvent;
+
+struct CborStreamParser
+{
+    const uint8_t *ptr;
+    const uint8_t *end;
+    const uint8_t *start;
+    uint64_t consumed;
+    uint64_t stringRemaining;
+    uint64_t remaining[CBOR_STREAM_PARSER_MAX_DEPTH];
+    uint8_t levelFlags[CBOR_STREAM_PARSER_MAX_DEPTH];
+    uint32_t depth;
+    uint8_t header[9];
+    uint8_t headerLength;
+    uint8_t stringType;
+    uint8_t state;
+};
+typedef struct CborStreamParser CborStreamParser;
+
+struct CborCallbacks
+{
+    CborError (*on_uint)(void *context, uint64_t value);
+    CborError (*on_negative_int)(void *context, uint64_t absolute_value);
+    CborError (*on_tag)(void *context, CborTag tag);
+    CborError (*on_simple_type)(void *context, uint8_t type);
+    CborError (*on_boolean)(void *context, bool value);
+    CborError (*on_null)(void *context);
+    CborError (*on_undefined)(void *context);
+    CborError (*on_half_float)(void *context, uint16_t value);
+    CborError (*on_float)(void *context, float value);
+    CborError (*on_double)(void *context, double value);
+    CborError (*on_string_start)(void *context, CborType type, size_t length);
+    CborError (*on_string_chunk)(void *context, CborType type, const uint8_t *data, size_t len);
+    CborError (*on_string_end)(void *context, CborType type);
+    CborError (*on_array_start)(void *context, size_t length);
+    CborError (*on_array_end)(void *context);
+    CborError (*on_map_start)(void *context, size_t length);
+    CborError (*on_map_end)(void *context);
+};
+typedef struct CborCallbacks CborCallbacks;
+
 #ifndef CBOR_NO_PARSER_API
 CBOR_API CborError cbor_parser_init(const uint8_t *buffer, size_t size, uint32_t flags, CborParser *parser, CborValue *it);
 CBOR_API CborError cbor_parser_init_reader(const struct CborParserOperations *ops, CborParser *parser, CborValue *it, void *token);
+CBOR_INLINE_API void cbor_parser_set_allocator(CborParser *parser, const CborAllocator *allocator)
+{ parser->allocator = allocator; }
+CBOR_API CborError cbor_parser_init_file(const char *fileName, uint32_t flags, CborMappedFile *file,
+                                         CborParser *parser, CborValue *it);
+CBOR_API void cbor_mapped_file_close(CborMappedFile *file);
+
+CBOR_API void cbor_stream_parser_init(CborStreamParser *parser);
+CBOR_API void cbor_stream_parser_feed(CborStreamParser *parser, const void *data, size_t size);
+CBOR_API CborError cbor_stream_parser_next(CborStreamParser *parser, CborStreamEvent *event);
+CBOR_INLINE_API bool cbor_stream_parser_at_top_level(const CborStreamParser *parser)
+{ return parser->depth == 0 && parser->state == 0 && parser->headerLength == 0; }
+CBOR_INLINE_API const uint8_t *cbor_stream_parser_get_next_byte(const CborStreamParser *parser)
+{ return parser->ptr; }
+CBOR_INLINE_API uint64_t cbor_stream_parser_get_offset(const CborStreamParser *parser)
+{ return parser->consumed + (uint64_t)(parser->ptr - parser->start); }
+CBOR_API CborError cbor_stream_parser_dispatch(CborStreamParser *parser, const CborCallbacks *callbacks,
+                                              void *context);
+CBOR_API CborError cbor_parse_with_callbacks(const uint8_t *buffer, size_t size, const CborCallbacks *callbacks,
+                                             void *context);
 
 CBOR_API CborError cbor_value_validate_basic(const CborValue *it);
 
@@ -594,6 +867,104 @@ CBOR_INLINE_API CborError cbor_value_get_map_length(const CborValue *value, size
 }
 
 CBOR_API CborError cbor_value_map_find_value(const CborValue *map, const char *string, CborValue *element);
+CBOR_API CborError cbor_value_map_find_values(const CborValue *map, const char *const *strings, size_t count,
+                                              CborValue *elements);
+
+/* Container index */
+struct CborContainerIndex
+{
+    CborValue first;
+    uint32_t *offsets;
+    uint32_t *keyHashes;
+    size_t count;
+    size_t required;
+};
+typedef struct CborContainerIndex CborContainerIndex;
+
+CBOR_API CborError cbor_value_create_container_index(const CborValue *container, CborContainerIndex *index,
+                                                     uint32_t *offsets, uint32_t *keyHashes, size_t capacity);
+CBOR_INLINE_API size_t cbor_container_index_get_count(const CborContainerIndex *index)
+{ return index->count; }
+CBOR_INLINE_API size_t cbor_container_index_get_required_count(const CborContainerIndex *index)
+{ return index->required; }
+CBOR_API CborError cbor_container_index_get_item(const CborContainerIndex *index, size_t n, CborValue *item);
+CBOR_API CborError cbor_container_index_map_find_value(const CborContainerIndex *index, const char *string,
+                                                       CborValue *element);
+
+/* Document index, built by cbor_value_validate_and_index() */
+enum CborIndexEntryFlags
+{
+    CborIndexEntryFlag_Tagged           = 0x01,
+    CborIndexEntryFlag_IndefiniteLength = 0x02
+};
+
+struct CborIndexEntry
+{
+    uint32_t offset;
+    uint32_t end;
+    uint32_t next;
+    uint32_t count;
+    uint8_t type;
+    uint8_t flags;
+};
+typedef struct CborIndexEntry CborIndexEntry;
+
+struct CborDocumentIndex
+{
+    CborValue first;
+    const CborIndexEntry *entries;
+    size_t count;
+    size_t required;
+};
+typedef struct CborDocumentIndex CborDocumentIndex;
+
+CBOR_INLINE_API size_t cbor_document_index_get_count(const CborDocumentIndex *index)
+{ return index->count; }
+CBOR_INLINE_API size_t cbor_document_index_get_required_count(const CborDocumentIndex *index)
+{ return index->required; }
+CBOR_INLINE_API const CborIndexEntry *cbor_document_index_get_entry(const CborDocumentIndex *index, size_t n)
+{ return n < index->count ? &index->entries[n] : NULL; }
+CBOR_API CborError cbor_document_index_get_value(const CborDocumentIndex *index, size_t n, CborValue *value);
+CBOR_API CborError cbor_document_index_get_string(const CborDocumentIndex *index, size_t n,
+                                                  const uint8_t **data, size_t *len);
+CBOR_API CborError cbor_document_index_map_find_value(const CborDocumentIndex *index, size_t map,
+                                                      const char *string, size_t *position);
+
+/* Arrays of numbers */
+CBOR_API CborError cbor_value_get_uint64_array(const CborValue *value, uint64_t *buffer, size_t *count,
+                                               CborValue *next);
+CBOR_API CborError cbor_value_get_int64_array(const CborValue *value, int64_t *buffer, size_t *count,
+                                              CborValue *next);
+CBOR_API CborError cbor_value_get_uint32_array(const CborValue *value, uint32_t *buffer, size_t *count,
+                                               CborValue *next);
+CBOR_API CborError cbor_value_get_int32_array(const CborValue *value, int32_t *buffer, size_t *count,
+                                              CborValue *next);
+CBOR_API CborError cbor_value_get_double_array(const CborValue *value, double *buffer, size_t *count,
+                                               CborValue *next);
+CBOR_API CborError cbor_value_get_float_array(const CborValue *value, float *buffer, size_t *count,
+                                              CborValue *next);
+
+/* RFC 8746 typed arrays */
+CBOR_API CborError cbor_value_get_uint8_typed_array(const CborValue *value, const uint8_t **data, size_t *count,
+                                                    uint8_t *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_uint16_typed_array(const CborValue *value, const uint16_t **data, size_t *count,
+                                                     uint16_t *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_uint32_typed_array(const CborValue *value, const uint32_t **data, size_t *count,
+                                                     uint32_t *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_uint64_typed_array(const CborValue *value, const uint64_t **data, size_t *count,
+                                                     uint64_t *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_int8_typed_array(const CborValue *value, const int8_t **data, size_t *count,
+                                                   int8_t *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_int16_typed_array(const CborValue *value, const int16_t **data, size_t *count,
+                                                    int16_t *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_int32_typed_array(const CborValue *value, const int32_t **data, size_t *count,
+                                                    int32_t *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_int64_typed_array(const CborValue *value, const int64_t **data, size_t *count,
+                                                    int64_t *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_float_typed_array(const CborValue *value, const float **data, size_t *count,
+                                                    float *buffer, CborValue *next);
+CBOR_API CborError cbor_value_get_double_typed_array(const CborValue *value, const double **data, size_t *count,
+                                                     double *buffer, CborValue *next);
 
 /* Floating point */
 CBOR_INLINE_API bool cbor_value_is_half_float(const CborValue *value)
@@ -662,7 +1033,7 @@ enum CborValidationFlags {
     CborValidateNoUndefined                 = 0x200000,
     CborValidateNoTags                      = 0x400000,
     CborValidateFiniteFloatingPoint         = 0x800000,
-    /* unused                               = 0x1000000, */
+    CborValidateMapKeysAreUniqueUnsorted    = 0x1000000,
     /* unused                               = 0x2000000, */
 
     CborValidateNoUnknownSimpleTypesSA      = 0x4000000,
@@ -678,6 +1049,10 @@ enum CborValidationFlags {
 };
 
 CBOR_API CborError cbor_value_validate(const CborValue *it, uint32_t flags);
+CBOR_API CborError cbor_value_validate_with_stack(const CborValue *it, uint32_t flags,
+                                                 CborValidationFrame *stack, size_t stackSize);
+CBOR_API CborError cbor_value_validate_and_index(const CborValue *it, uint32_t flags, CborDocumentIndex *index,
+                                                CborIndexEntry *entries, size_t capacity);
 #endif /* CBOR_NO_VALIDATION_API */
 
 /* Human-readable (dump) API */
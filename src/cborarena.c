@@ -0,0 +1,162 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "compilersupport_p.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+/**
+ * \struct CborArena
+ * Bump allocator that hands out memory from a caller-supplied buffer. It is
+ * meant to be attached to a parser with cbor_parser_set_allocator() (or
+ * passed to cbor_encoder_init_growable()) when many short-lived blocks are
+ * needed, such as the strings duplicated by cbor_value_dup_text_string() or
+ * the temporaries used by cbor_value_to_json(): allocating costs a pointer
+ * increment and everything is released at once by cbor_arena_reset().
+ *
+ * Freeing or reallocating the most recently allocated block is done in place;
+ * freeing any other block is a no-op, so the memory is reclaimed early only if
+ * the blocks are freed in the reverse order of their allocation, as the
+ * library itself does. All members are private.
+ *
+ * \sa cbor_arena_init(), cbor_arena_get_allocator()
+ */
+
+/**
+ * \fn const CborAllocator *cbor_arena_get_allocator(const CborArena *arena)
+ *
+ * Returns the CborAllocator that allocates from \a arena. The pointer remains
+ * valid for as long as \a arena does.
+ */
+
+/**
+ * \fn void cbor_arena_reset(CborArena *arena)
+ *
+ * Releases all memory allocated from \a arena at once, in constant time. Any
+ * pointers previously returned by it become invalid.
+ */
+
+/**
+ * \fn size_t cbor_arena_get_used_size(const CborArena *arena)
+ *
+ * Returns how many bytes of the buffer of \a arena are in use, including the
+ * padding that rounds each block up to the alignment.
+ */
+
+/* malloc() guarantees this alignment on common ABIs */
+enum { ArenaAlignment = 2 * sizeof(void *) };
+
+static size_t align_size(size_t size)
+{
+    return (size + ArenaAlignment - 1) & ~(size_t)(ArenaAlignment - 1);
+}
+
+static void *arena_allocate(void *context, size_t size)
+{
+    CborArena *arena = (CborArena *)context;
+    uint8_t *ptr = arena->buffer + arena->used;
+
+    /* the available size is a multiple of the alignment, so rounding up the
+     * request can't make it exceed that */
+    if (size > arena->size - arena->used)
+        return NULL;
+    arena->used += align_size(size);
+    return ptr;
+}
+
+static bool is_last_block(const CborArena *arena, const void *ptr, size_t size)
+{
+    return ptr && (const uint8_t *)ptr + align_size(size) == arena->buffer + arena->used;
+}
+
+static void *arena_reallocate(void *context, void *ptr, size_t oldSize, size_t newSize)
+{
+    CborArena *arena = (CborArena *)context;
+    void *newptr;
+
+    if (is_last_block(arena, ptr, oldSize)) {
+        /* most recent block: grow or shrink it in place */
+        size_t offset = (size_t)((uint8_t *)ptr - arena->buffer);
+        if (newSize > arena->size - offset)
+            return NULL;
+        arena->used = offset + align_size(newSize);
+        return ptr;
+    }
+
+    newptr = arena_allocate(context, newSize);
+    if (newptr && ptr)
+        memcpy(newptr, ptr, oldSize < newSize ? oldSize : newSize);
+    return newptr;
+}
+
+static void arena_deallocate(void *context, void *ptr, size_t size)
+{
+    CborArena *arena = (CborArena *)context;
+
+    /* only the most recent block can be given back, so blocks freed in the
+     * reverse order of their allocation are all reclaimed */
+    if (is_last_block(arena, ptr, size))
+        arena->used = (size_t)((uint8_t *)ptr - arena->buffer);
+}
+
+/**
+ * Initializes \a arena so that it allocates from the \a size bytes starting
+ * at \a buffer. The arena does not take ownership of \a buffer, which must
+ * remain valid while memory allocated from the arena is in use. Allocations
+ * are aligned to twice the size of a pointer, so a few bytes at either end of
+ * \a buffer may go unused if it is not so aligned.
+ *
+ * \sa cbor_arena_get_allocator(), cbor_arena_reset(), cbor_parser_set_allocator()
+ */
+void cbor_arena_init(CborArena *arena, void *buffer, size_t size)
+{
+    size_t padding = (size_t)(-(uintptr_t)buffer & (ArenaAlignment - 1));
+    if (padding > size)
+        padding = size;
+
+    arena->allocator.allocate = arena_allocate;
+    arena->allocator.reallocate = arena_reallocate;
+    arena->allocator.deallocate = arena_deallocate;
+    arena->allocator.context = arena;
+    arena->buffer = (uint8_t *)buffer + padding;
+    arena->size = (size - padding) & ~(size_t)(ArenaAlignment - 1);
+    arena->used = 0;
+}
+
+/** @} */
@@ -184,6 +184,21 @@
  *     return NULL;
  *  }
  * \endcode
+ *
+ * The loop above encodes the data again every time the buffer turns out to
+ * be too small. cbor_encoder_init_growable() avoids that by letting the
+ * encoder own a buffer that it enlarges as needed:
+ *
+ * \code
+ *      CborGrowableBuffer buffer;
+ *      CborEncoder encoder;
+ *      cbor_encoder_init_growable(&encoder, &buffer, NULL, 256);
+ *      err = encode_everything(&encoder);
+ *      if (err)
+ *          cbor_growable_buffer_free(&buffer);
+ *      else
+ *          send_payload(cbor_growable_buffer_release(&buffer, &len), len);
+ * \endcode
  */
 
 /**
@@ -196,10 +211,35 @@
  * Structure used to encode to CBOR.
  */
 
+/**
+ * \enum CborEncoderFlags
+ * The CborEncoderFlags enum contains the flags that can be passed to
+ * cbor_encoder_init(). The other values in the enumeration are used internally.
+ *
+ * \value CborEncoderFlag_SortMapKeys  Sort the entries of each map when it is
+ *                                     closed, so that the keys appear in the
+ *                                     bytewise lexicographic order of their
+ *                                     encoding (RFC 8949 section 4.2.1). Only
+ *                                     encoders writing to a buffer support it:
+ *                                     with a writer function (as set up by
+ *                                     cbor_encoder_init_writer() or
+ *                                     cbor_encoder_init_growable()), creating
+ *                                     a map fails with CborErrorUnsupportedType.
+ */
+
 /**
  * Initializes a CborEncoder structure \a encoder by pointing it to buffer \a
- * buffer of size \a size. The \a flags field is currently unused and must be
- * zero.
+ * buffer of size \a size. The \a flags field is either zero or
+ * CborEncoderFlag_SortMapKeys.
+ *
+ * With CborEncoderFlag_SortMapKeys, cbor_encoder_close_container() reorders
+ * the entries of the map being closed in the buffer, so the caller may add
+ * them in any order. Combined with definite lengths for all strings, arrays
+ * and maps and with floating point values encoded in their shortest form, the
+ * encoded stream then passes cbor_value_validate() with
+ * CborValidateCanonicalFormat. Unused space at the end of \a buffer speeds
+ * the sorting up: maps whose contents fit in it (plus a small table per
+ * entry) are sorted in O(n log n), otherwise they are sorted in place.
  */
 void cbor_encoder_init(CborEncoder *encoder, uint8_t *buffer, size_t size, int flags)
 {
@@ -221,6 +261,47 @@ void cbor_encoder_init_writer(CborEncoder *encoder, CborEncoderWriteFunction wri
     encoder->flags = CborIteratorFlag_WriterFunction;
 }
 
+/**
+ * Initializes a CborEncoder structure \a encoder that writes nothing and only
+ * counts the number of bytes that the encoding produces. The same sequence of
+ * encoding calls that would be made on an encoder initialized with
+ * cbor_encoder_init() can be made on it, and they return no error because of
+ * the missing buffer. Afterwards, cbor_encoder_get_counted_size() returns the
+ * exact size of the buffer needed for them, so the data can be encoded in a
+ * second pass, after a single allocation of the right size:
+ *
+ * \code
+ *      CborEncoder encoder;
+ *      cbor_encoder_init_counting(&encoder);
+ *      encode_everything(&encoder);
+ *      size = cbor_encoder_get_counted_size(&encoder);
+ *
+ *      buf = pool_alloc(size);
+ *      cbor_encoder_init(&encoder, buf, size, 0);
+ *      err = encode_everything(&encoder);      // can't fail with CborErrorOutOfMemory
+ * \endcode
+ *
+ * No data is copied, so this is faster than encoding into a buffer that is
+ * too small and reading cbor_encoder_get_extra_bytes_needed(). To compute the
+ * size of individual items without an encoder, use the cbor_encoded_size_*
+ * functions, like cbor_encoded_size_uint() and cbor_encoded_size_text_string().
+ *
+ * The count does not include the scratch space that
+ * CborEncoderFlag_SortMapKeys may need to sort large maps.
+ *
+ * This function cannot be used if the library was built with
+ * CBOR_ENCODER_WRITE_FUNCTION defined.
+ *
+ * \sa cbor_encoder_init(), cbor_encoder_get_counted_size()
+ */
+void cbor_encoder_init_counting(CborEncoder *encoder)
+{
+    encoder->data.bytes_needed = 0;
+    encoder->end = NULL;
+    encoder->remaining = 2;
+    encoder->flags = CborIteratorFlag_CountOnly;
+}
+
 static inline void put16(void *where, uint16_t v)
 {
     uint16_t v_be = cbor_htons(v);
@@ -291,8 +372,9 @@ static inline CborError append_to_buffer(CborEncoder *encoder, const void *data,
             encoder->data.bytes_needed = 0;
         }
 
+        /* the counting encoder always ends up here, without copying */
         advance_ptr(encoder, len);
-        return CborErrorOutOfMemory;
+        return encoder->flags & CborIteratorFlag_CountOnly ? CborNoError : CborErrorOutOfMemory;
     }
 
     memcpy(encoder->data.ptr, data, len);
@@ -386,6 +468,311 @@ CborError cbor_encode_int(CborEncoder *encoder, int64_t value)
     return encode_number(encoder, ui, majorType);
 }
 
+typedef enum NumberArrayType {
+    UIntArray,
+    IntArray,
+    DoubleArray,
+    ShortestDoubleArray,
+    ShortestDoubleOrIntegerArray
+} NumberArrayType;
+
+enum {
+    MaxNumberSize = 1 + sizeof(uint64_t),
+    NumberArrayChunkSize = 256 / MaxNumberSize
+};
+
+/* Writes the encoding of \a ui with major type \a shiftedMajorType at \a p,
+ * which must have room for MaxNumberSize bytes. Returns the end pointer. */
+static inline uint8_t *write_number(uint8_t *p, uint64_t ui, uint8_t shiftedMajorType)
+{
+    if (ui < Value8Bit) {
+        *p = shiftedMajorType + (uint8_t)ui;
+        return p + 1;
+    }
+    if (ui <= 0xffU) {
+        p[0] = shiftedMajorType + Value8Bit;
+        p[1] = (uint8_t)ui;
+        return p + 2;
+    }
+    if (ui <= 0xffffU) {
+        p[0] = shiftedMajorType + Value16Bit;
+        put16(p + 1, (uint16_t)ui);
+        return p + 3;
+    }
+    if (ui <= 0xffffffffU) {
+        p[0] = shiftedMajorType + Value32Bit;
+        put32(p + 1, (uint32_t)ui);
+        return p + 5;
+    }
+    p[0] = shiftedMajorType + Value64Bit;
+    put64(p + 1, ui);
+    return p + 9;
+}
+
+/* Writes the encoding of the double-precision value \a value at \a p, which
+ * must have room for MaxNumberSize bytes, in the shortest floating point
+ * format that represents it exactly. If \a allowIntegers is true, integral
+ * values are written as integers instead, unless that is longer. Returns the
+ * end pointer. */
+static uint8_t *write_double_shortest(uint8_t *p, double value, bool allowIntegers)
+{
+    uint64_t bits, mantissa, significand;
+    uint32_t sign;
+    int exponent;
+    size_t fpSize = 1 + sizeof(uint64_t);
+    uint32_t fpBits = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+    sign = (uint32_t)(bits >> 63);
+    exponent = (int)(bits >> 52) & 0x7ff;
+    mantissa = bits & ((UINT64_C(1) << 52) - 1);
+    significand = mantissa | (UINT64_C(1) << 52);
+
+    if (exponent == 0x7ff) {
+        /* infinities and NaNs: keep the NaN payload */
+        if ((mantissa & ((UINT64_C(1) << 42) - 1)) == 0) {
+            fpSize = 1 + sizeof(uint16_t);
+            fpBits = sign << 15 | 0x7c00U | (uint32_t)(mantissa >> 42);
+        } else if ((mantissa & ((UINT64_C(1) << 29) - 1)) == 0) {
+            fpSize = 1 + sizeof(uint32_t);
+            fpBits = sign << 31 | 0x7f800000U | (uint32_t)(mantissa >> 29);
+        }
+    } else if (exponent == 0) {
+        /* zeroes; subnormal doubles are too small for the other formats */
+        if (mantissa == 0) {
+            if (allowIntegers && !sign)
+                return write_number(p, 0, UnsignedIntegerType << MajorTypeShift);
+            fpSize = 1 + sizeof(uint16_t);
+            fpBits = sign << 15;
+        }
+    } else {
+        exponent -= 1023;
+
+        /* Half precision has 10 bits of mantissa and exponents -14 to 15, plus
+         * subnormals down to 2^-24; single precision has 23 bits and exponents
+         * -126 to 127, plus subnormals down to 2^-149. In both cases, the
+         * value fits if the bits dropped from the significand are zero. */
+        if (exponent >= -24 && exponent <= 15) {
+            int drop = exponent >= -14 ? 52 - 10 : 28 - exponent;
+            if ((significand & ((UINT64_C(1) << drop) - 1)) == 0) {
+                fpSize = 1 + sizeof(uint16_t);
+                fpBits = sign << 15;
+                fpBits |= exponent >= -14 ? (uint32_t)(exponent + 15) << 10 | (uint32_t)(mantissa >> drop)
+                                          : (uint32_t)(significand >> drop);
+            }
+        }
+        if (fpSize > 1 + sizeof(uint16_t) && exponent >= -149 && exponent <= 127) {
+            int drop = exponent >= -126 ? 52 - 23 : -97 - exponent;
+            if ((significand & ((UINT64_C(1) << drop) - 1)) == 0) {
+                fpSize = 1 + sizeof(uint32_t);
+                fpBits = sign << 31;
+                fpBits |= exponent >= -126 ? (uint32_t)(exponent + 127) << 23 | (uint32_t)(mantissa >> drop)
+                                           : (uint32_t)(significand >> drop);
+            }
+        }
+
+        /* integral values below 2^64 in magnitude */
+        if (allowIntegers && exponent >= 0 && exponent < 64 &&
+                (exponent >= 52 || (mantissa << (12 + exponent)) == 0)) {
+            uint64_t ui = exponent >= 52 ? significand << (exponent - 52) : significand >> (52 - exponent);
+            ui -= sign;     /* negative integers are encoded as -1 - n */
+            if (cbor_encoded_size_uint(ui) <= fpSize)
+                return write_number(p, ui, (uint8_t)(sign << 5));
+        }
+    }
+
+    if (fpSize == 1 + sizeof(uint16_t)) {
+        p[0] = CborHalfFloatType;
+        put16(p + 1, (uint16_t)fpBits);
+    } else if (fpSize == 1 + sizeof(uint32_t)) {
+        p[0] = CborFloatType;
+        put32(p + 1, fpBits);
+    } else {
+        p[0] = CborDoubleType;
+        put64(p + 1, bits);
+    }
+    return p + fpSize;
+}
+
+static uint8_t *write_number_array(uint8_t *p, NumberArrayType type, const void *values, size_t first, size_t count)
+{
+    size_t i;
+    if (type == UIntArray) {
+        const uint64_t *v = (const uint64_t *)values + first;
+        for (i = 0; i < count; ++i)
+            p = write_number(p, v[i], UnsignedIntegerType << MajorTypeShift);
+    } else if (type == IntArray) {
+        const int64_t *v = (const int64_t *)values + first;
+        for (i = 0; i < count; ++i) {
+            /* same as cbor_encode_int() */
+            uint64_t ui = v[i] >> 63;
+            uint8_t majorType = ui & 0x20;
+            ui ^= v[i];
+            p = write_number(p, ui, majorType);
+        }
+    } else if (type != DoubleArray) {
+        const double *v = (const double *)values + first;
+        for (i = 0; i < count; ++i)
+            p = write_double_shortest(p, v[i], type == ShortestDoubleOrIntegerArray);
+    } else {
+        /* every element is 9 bytes long, so there's nothing to decide */
+        const double *v = (const double *)values + first;
+        for (i = 0; i < count; ++i, p += MaxNumberSize) {
+            uint64_t bits;
+            memcpy(&bits, &v[i], sizeof(bits));
+            p[0] = CborDoubleType;
+            put64(p + 1, bits);
+        }
+    }
+    return p;
+}
+
+static CborError encode_number_array(CborEncoder *encoder, NumberArrayType type, const void *values, size_t count)
+{
+    uint8_t chunk[NumberArrayChunkSize * MaxNumberSize];
+    CborError err = CborNoError;
+    size_t i, n;
+
+    /* all elements count towards the container's size at once */
+    encoder->remaining = count < encoder->remaining ? encoder->remaining - count : 0;
+
+#if CBOR_ENCODER_WRITER_CONTROL <= 0
+    if (CBOR_ENCODER_WRITER_CONTROL < 0 || !(encoder->flags & CborIteratorFlag_WriterFunction)) {
+        if (count <= SIZE_MAX / MaxNumberSize && !would_overflow(encoder, count * MaxNumberSize)) {
+            /* even the worst case fits: write directly without further checks */
+            encoder->data.ptr = write_number_array(encoder->data.ptr, type, values, 0, count);
+            return CborNoError;
+        }
+    }
+#endif
+
+    /* near the end of the buffer or using a writer function: go through
+     * append_to_buffer() one chunk at a time */
+    for (i = 0; i < count; i += n) {
+        uint8_t *end;
+        n = count - i < (size_t)NumberArrayChunkSize ? count - i : (size_t)NumberArrayChunkSize;
+        end = write_number_array(chunk, type, values, i, n);
+        err = append_to_buffer(encoder, chunk, (size_t)(end - chunk), CborEncoderAppendCborData);
+        if (err && !isOomError(err))
+            return err;
+    }
+    return err;
+}
+
+/**
+ * Appends the \a count unsigned 64-bit integers pointed to by \a values to the
+ * CBOR stream provided by \a encoder, as \a count separate items. This is
+ * equivalent to calling cbor_encode_uint() for each element, but checks for
+ * room in the buffer only once (or, with cbor_encoder_init_writer(), calls
+ * the writer function once per group of elements instead of once per element).
+ *
+ * The elements count towards the number of items of the array or map that \a
+ * encoder belongs to, so this function is usually called right after
+ * cbor_encoder_create_array() with the same \a count:
+ *
+ * \code
+ *      CborEncoder array;
+ *      cbor_encoder_create_array(&encoder, &array, count);
+ *      cbor_encode_uint_array(&array, values, count);
+ *      cbor_encoder_close_container(&encoder, &array);
+ * \endcode
+ *
+ * \sa cbor_encode_int_array(), cbor_encode_double_array(), cbor_encode_uint64_typed_array()
+ */
+CborError cbor_encode_uint_array(CborEncoder *encoder, const uint64_t *values, size_t count)
+{
+    return encode_number_array(encoder, UIntArray, values, count);
+}
+
+/**
+ * Appends the \a count signed 64-bit integers pointed to by \a values to the
+ * CBOR stream provided by \a encoder, as \a count separate items. This is
+ * equivalent to calling cbor_encode_int() for each element. See
+ * cbor_encode_uint_array() for details.
+ *
+ * \sa cbor_encode_uint_array(), cbor_encode_double_array(), cbor_encode_int64_typed_array()
+ */
+CborError cbor_encode_int_array(CborEncoder *encoder, const int64_t *values, size_t count)
+{
+    return encode_number_array(encoder, IntArray, values, count);
+}
+
+/**
+ * Appends the \a count double-precision floating point values pointed to by
+ * \a values to the CBOR stream provided by \a encoder, as \a count separate
+ * items. This is equivalent to calling cbor_encode_double() for each element.
+ * See cbor_encode_uint_array() for details.
+ *
+ * \sa cbor_encode_uint_array(), cbor_encode_int_array(), cbor_encode_double_typed_array()
+ */
+CborError cbor_encode_double_array(CborEncoder *encoder, const double *values, size_t count)
+{
+    return encode_number_array(encoder, DoubleArray, values, count);
+}
+
+/**
+ * \enum CborShortestFloatFlags
+ * The CborShortestFloatFlags enum contains flags that control how
+ * cbor_encode_double_shortest() and cbor_encode_double_array_shortest()
+ * encode floating point values.
+ *
+ * \value CborShortestFloatDefaultFlags    Only use the floating point formats.
+ * \value CborShortestFloatAllowIntegers   Encode integral values as integers when
+ *                                         that is not longer (-0.0 remains a
+ *                                         floating point value).
+ */
+
+/**
+ * Appends the double-precision floating point value \a value to the CBOR
+ * stream provided by \a encoder, in the shortest of the half-, single- and
+ * double-precision formats that represents it exactly. No precision is lost:
+ * the decoded value is always equal to \a value, and infinities and NaN
+ * payloads are preserved too. If \a flags contains
+ * CborShortestFloatAllowIntegers, integral values of magnitude below 2^64 are
+ * encoded as integers, unless that is longer than the floating point form.
+ *
+ * Unlike cbor_encode_float_as_half_float(), this function has defined results
+ * for every input. Finite values, infinities and quiet NaNs without payload
+ * are encoded in the form that cbor_value_validate() with
+ * CborValidateShortestFloatingPoint requires.
+ *
+ * \sa cbor_encode_double(), cbor_encode_double_array_shortest(), cbor_encode_floating_point()
+ */
+CborError cbor_encode_double_shortest(CborEncoder *encoder, double value, int flags)
+{
+    uint8_t buf[MaxNumberSize];
+    uint8_t *end = write_double_shortest(buf, value, flags & CborShortestFloatAllowIntegers);
+    saturated_decrement(encoder);
+    return append_to_buffer(encoder, buf, (size_t)(end - buf), CborEncoderAppendCborData);
+}
+
+/**
+ * Appends the \a count double-precision floating point values pointed to by
+ * \a values to the CBOR stream provided by \a encoder, as \a count separate
+ * items. This is equivalent to calling cbor_encode_double_shortest() with \a
+ * flags for each element. See cbor_encode_uint_array() for details.
+ *
+ * \sa cbor_encode_double_array(), cbor_encode_double_shortest()
+ */
+CborError cbor_encode_double_array_shortest(CborEncoder *encoder, const double *values, size_t count, int flags)
+{
+    return encode_number_array(encoder, flags & CborShortestFloatAllowIntegers ?
+                                   ShortestDoubleOrIntegerArray : ShortestDoubleArray,
+                               values, count);
+}
+
+/**
+ * Returns the number of bytes that cbor_encode_double_shortest() appends to
+ * the stream for \a value and \a flags.
+ *
+ * \sa cbor_encode_double_shortest(), cbor_encoded_size_floating_point()
+ */
+size_t cbor_encoded_size_double_shortest(double value, int flags)
+{
+    uint8_t buf[MaxNumberSize];
+    return (size_t)(write_double_shortest(buf, value, flags & CborShortestFloatAllowIntegers) - buf);
+}
+
 /**
  * Appends the CBOR Simple Type of value \a value to the CBOR stream provided by
  * \a encoder.
@@ -491,6 +878,13 @@ __attribute__((noinline))
 static CborError create_container(CborEncoder *encoder, CborEncoder *container, size_t length, uint8_t shiftedMajorType)
 {
     CborError err;
+    if (CBOR_ENCODER_WRITER_CONTROL >= 0 && encoder->flags & CborEncoderFlag_SortMapKeys &&
+            shiftedMajorType & CborIteratorFlag_ContainerIsMap &&
+            (encoder->flags & CborIteratorFlag_WriterFunction || CBOR_ENCODER_WRITER_CONTROL != 0)) {
+        /* the entries are gone by the time the map is closed */
+        return CborErrorUnsupportedType;
+    }
+
     container->data.ptr = encoder->data.ptr;
     container->end = encoder->end;
     saturated_decrement(encoder);
@@ -500,6 +894,7 @@ static CborError create_container(CborEncoder *encoder, CborEncoder *container,
     cbor_static_assert(((MapType << MajorTypeShift) & CborIteratorFlag_ContainerIsMap) == CborIteratorFlag_ContainerIsMap);
     cbor_static_assert(((ArrayType << MajorTypeShift) & CborIteratorFlag_ContainerIsMap) == 0);
     container->flags = shiftedMajorType & CborIteratorFlag_ContainerIsMap;
+    container->flags |= encoder->flags & (CborEncoderFlag_SortMapKeys | CborIteratorFlag_CountOnly);
     if (CBOR_ENCODER_WRITER_CONTROL == 0)
         container->flags |= encoder->flags & CborIteratorFlag_WriterFunction;
 
@@ -550,6 +945,10 @@ CborError cbor_encoder_create_array(CborEncoder *parentEncoder, CborEncoder *arr
  * value (and is not \ref CborIndefiniteLength), this function returns error
  * CborErrorDataTooLarge.
  *
+ * Encoders that send the data to a writer function cannot sort maps: if \a
+ * parentEncoder has CborEncoderFlag_SortMapKeys set, this function returns
+ * CborErrorUnsupportedType without writing anything.
+ *
  * \sa cbor_encoder_create_array
  */
 CborError cbor_encoder_create_map(CborEncoder *parentEncoder, CborEncoder *mapEncoder, size_t length)
@@ -559,6 +958,222 @@ CborError cbor_encoder_create_map(CborEncoder *parentEncoder, CborEncoder *mapEn
     return create_container(parentEncoder, mapEncoder, length, MapType << MajorTypeShift);
 }
 
+enum {
+    MaximumSortedMapNesting = 1024,
+    MaximumInPlaceSortEntries = 64
+};
+
+struct MapEntrySpan
+{
+    size_t offset;          /* from the start of the map's contents */
+    size_t keyLength;
+    size_t length;          /* key and value */
+};
+typedef struct MapEntrySpan MapEntrySpan;
+
+/* returns the end of the encoded item starting at \a ptr, or null if it is
+ * malformed or extends past \a end */
+static const uint8_t *encoded_item_end(const uint8_t *ptr, const uint8_t *end, int nestingLevels)
+{
+    uint8_t majorType, descriptor;
+    uint64_t value;
+
+    if (ptr == end || nestingLevels == 0)
+        return NULL;
+    majorType = *ptr >> MajorTypeShift;
+    descriptor = *ptr++ & SmallValueMask;
+
+    if (descriptor == IndefiniteLength) {
+        if (majorType < ByteStringType || majorType > MapType)
+            return NULL;
+        while (ptr != end && *ptr != BreakByte) {
+            ptr = encoded_item_end(ptr, end, nestingLevels - 1);
+            if (!ptr)
+                return NULL;
+        }
+        return ptr == end ? NULL : ptr + 1;
+    }
+
+    value = descriptor;
+    if (descriptor >= Value8Bit) {
+        size_t bytes;
+        if (descriptor > Value64Bit)
+            return NULL;
+        bytes = (size_t)1 << (descriptor - Value8Bit);
+        if ((size_t)(end - ptr) < bytes)
+            return NULL;
+        for (value = 0; bytes; --bytes)
+            value = (value << 8) | *ptr++;
+    }
+
+    switch (majorType) {
+    case ByteStringType:
+    case TextStringType:
+        if (value > (uint64_t)(end - ptr))
+            return NULL;
+        return ptr + value;
+
+    case MapType:
+        if (value > UINT64_MAX / 2)
+            return NULL;
+        value *= 2;
+        /* fall through */
+    case ArrayType:
+        while (value--) {
+            ptr = encoded_item_end(ptr, end, nestingLevels - 1);
+            if (!ptr)
+                return NULL;
+        }
+        return ptr;
+
+    case TagType:
+        return encoded_item_end(ptr, end, nestingLevels - 1);
+    }
+    return ptr;
+}
+
+static int compare_map_keys(const uint8_t *key1, size_t len1, const uint8_t *key2, size_t len2)
+{
+    int r = memcmp(key1, key2, len1 < len2 ? len1 : len2);
+    if (r == 0 && len1 != len2)
+        r = len1 < len2 ? -1 : 1;
+    return r;
+}
+
+static void reverse_bytes(uint8_t *begin, uint8_t *end)
+{
+    while (begin < end) {
+        uint8_t c = *begin;
+        *begin++ = *--end;
+        *end = c;
+    }
+}
+
+/* sorts the spans, which point into \a contents, using \a tmp (of the same
+ * size) as scratch; returns the array where the result was stored */
+static MapEntrySpan *merge_sort_spans(const uint8_t *contents, MapEntrySpan *spans, MapEntrySpan *tmp, size_t count)
+{
+    size_t width;
+    for (width = 1; width < count; width *= 2) {
+        size_t lo;
+        MapEntrySpan *swap;
+        for (lo = 0; lo < count; lo += 2 * width) {
+            size_t mid = lo + width < count ? lo + width : count;
+            size_t hi = mid + width < count ? mid + width : count;
+            size_t a = lo, b = mid, k = lo;
+            while (a < mid && b < hi) {
+                /* take from the right run only if strictly smaller, to keep the sort stable */
+                if (compare_map_keys(contents + spans[b].offset, spans[b].keyLength,
+                                     contents + spans[a].offset, spans[a].keyLength) < 0)
+                    tmp[k++] = spans[b++];
+                else
+                    tmp[k++] = spans[a++];
+            }
+            while (a < mid)
+                tmp[k++] = spans[a++];
+            while (b < hi)
+                tmp[k++] = spans[b++];
+        }
+        swap = spans;
+        spans = tmp;
+        tmp = swap;
+    }
+    return spans;
+}
+
+/*
+ * Sorts the entries of the map whose contents are in [begin, end), in the
+ * bytewise order of the encoded keys. The bytes in [end, scratchEnd) are not
+ * part of the stream and may be overwritten: if the contents and two tables of
+ * the entries fit there, the entries are sorted in that table and copied there
+ * in order. Otherwise, small maps are sorted in place by insertion, moving
+ * each entry into position with a rotation of the bytes in between, and for
+ * larger ones this function returns how many more bytes it needs.
+ */
+static size_t sort_map_entries(uint8_t *begin, uint8_t *end, uint8_t *scratchEnd)
+{
+    size_t size = (size_t)(end - begin);
+    size_t count = 0;
+    size_t capacity = 0;
+    bool sorted = true;
+    const uint8_t *previousKey = NULL;
+    size_t previousKeyLength = 0;
+    const uint8_t *ptr = begin;
+    uintptr_t aligned = ((uintptr_t)end + sizeof(size_t) - 1) & ~(uintptr_t)(sizeof(size_t) - 1);
+    MapEntrySpan *spans = (MapEntrySpan *)aligned;
+
+    /* the table must leave room for a second one and for a copy of the contents */
+    if (aligned < (uintptr_t)scratchEnd && (size_t)((uintptr_t)scratchEnd - aligned) > size)
+        capacity = ((size_t)((uintptr_t)scratchEnd - aligned) - size) / (2 * sizeof(MapEntrySpan));
+
+    while (ptr != end) {
+        const uint8_t *keyEnd = encoded_item_end(ptr, end, MaximumSortedMapNesting);
+        const uint8_t *entryEnd = keyEnd ? encoded_item_end(keyEnd, end, MaximumSortedMapNesting) : NULL;
+        if (!entryEnd)
+            return 0;   /* malformed contents are the result of an earlier error */
+
+        if (previousKey && compare_map_keys(ptr, (size_t)(keyEnd - ptr), previousKey, previousKeyLength) < 0)
+            sorted = false;
+        previousKey = ptr;
+        previousKeyLength = (size_t)(keyEnd - ptr);
+        if (count < capacity) {
+            spans[count].offset = (size_t)(ptr - begin);
+            spans[count].keyLength = (size_t)(keyEnd - ptr);
+            spans[count].length = (size_t)(entryEnd - ptr);
+        }
+        ++count;
+        ptr = entryEnd;
+    }
+    if (sorted)
+        return 0;
+
+    if (count <= capacity) {
+        MapEntrySpan *result = merge_sort_spans(begin, spans, spans + count, count);
+        uint8_t *copy = (uint8_t *)(spans + 2 * count);
+        uint8_t *out = copy;
+        size_t i;
+        for (i = 0; i < count; ++i) {
+            memcpy(out, begin + result[i].offset, result[i].length);
+            out += result[i].length;
+        }
+        memcpy(begin, copy, size);
+        return 0;
+    }
+    if (count > MaximumInPlaceSortEntries)
+        return size + 2 * count * sizeof(MapEntrySpan) + sizeof(size_t) - (size_t)(scratchEnd - end);
+
+    /* insertion sort; the contents are known to be well-formed now */
+    previousKey = NULL;
+    ptr = begin;
+    while (ptr != end) {
+        const uint8_t *keyEnd = encoded_item_end(ptr, end, MaximumSortedMapNesting);
+        const uint8_t *entryEnd = encoded_item_end(keyEnd, end, MaximumSortedMapNesting);
+        size_t keyLength = (size_t)(keyEnd - ptr);
+
+        if (previousKey && compare_map_keys(ptr, keyLength, previousKey, previousKeyLength) < 0) {
+            /* find the first entry with a greater key */
+            uint8_t *pos = begin;
+            while (1) {
+                const uint8_t *posKeyEnd = encoded_item_end(pos, end, MaximumSortedMapNesting);
+                if (compare_map_keys(pos, (size_t)(posKeyEnd - pos), ptr, keyLength) > 0)
+                    break;
+                pos = (uint8_t *)encoded_item_end(posKeyEnd, end, MaximumSortedMapNesting);
+            }
+
+            /* rotate [pos, entryEnd) so that the entry comes first */
+            reverse_bytes(pos, (uint8_t *)ptr);
+            reverse_bytes((uint8_t *)ptr, (uint8_t *)entryEnd);
+            reverse_bytes(pos, (uint8_t *)entryEnd);
+            previousKey += entryEnd - ptr;
+        } else {
+            previousKey = ptr;
+            previousKeyLength = keyLength;
+        }
+        ptr = entryEnd;
+    }
+    return 0;
+}
+
 /**
  * Closes the CBOR container (array or map) provided by \a containerEncoder and
  * updates the CBOR stream provided by \a encoder. Both parameters must be the
@@ -569,13 +1184,42 @@ CborError cbor_encoder_create_map(CborEncoder *parentEncoder, CborEncoder *mapEn
  * of items, in the case of a map) was correct. It is no longer necessary to call
  * cbor_encoder_close_container_checked() instead.
  *
+ * If the encoder was initialized with CborEncoderFlag_SortMapKeys and \a
+ * containerEncoder is a map, this function sorts its entries before closing
+ * it. The sorting uses the unused space at the end of the buffer: maps of
+ * more than 64 entries for which that space is too small are left unsorted
+ * and this function returns CborErrorOutOfMemory, with
+ * cbor_encoder_get_extra_bytes_needed() accounting for the missing space. Maps
+ * are also not sorted if an error occurred while encoding their contents.
+ *
  * \sa cbor_encoder_create_array(), cbor_encoder_create_map()
  */
 CborError cbor_encoder_close_container(CborEncoder *parentEncoder, const CborEncoder *containerEncoder)
 {
+    size_t sortBytesNeeded = 0;
+#if CBOR_ENCODER_WRITER_CONTROL <= 0
+    /* the parent's pointer is still at the beginning of the map */
+    const int sortFlags = CborEncoderFlag_SortMapKeys | CborIteratorFlag_ContainerIsMap;
+    if ((containerEncoder->flags & (sortFlags | CborIteratorFlag_WriterFunction)) == sortFlags &&
+            containerEncoder->end && parentEncoder->end) {
+        uint8_t *contents = parentEncoder->data.ptr;
+        uint8_t descriptor = *contents & SmallValueMask;
+        if (descriptor < Value8Bit || descriptor == IndefiniteLength)
+            contents += 1;
+        else
+            contents += 1 + ((size_t)1 << (descriptor - Value8Bit));
+        sortBytesNeeded = sort_map_entries(contents, containerEncoder->data.ptr, containerEncoder->end);
+    }
+#endif
+
     // synchronise buffer state with that of the container
     parentEncoder->end = containerEncoder->end;
     parentEncoder->data = containerEncoder->data;
+    if (sortBytesNeeded) {
+        /* switch to counting, as if the map had overrun the buffer */
+        parentEncoder->end = NULL;
+        parentEncoder->data.bytes_needed = (ptrdiff_t)sortBytesNeeded;
+    }
 
     if (containerEncoder->flags & CborIteratorFlag_UnknownLength)
         return append_byte_to_buffer(parentEncoder, BreakByte);
@@ -583,7 +1227,7 @@ CborError cbor_encoder_close_container(CborEncoder *parentEncoder, const CborEnc
     if (containerEncoder->remaining != 1)
         return containerEncoder->remaining == 0 ? CborErrorTooManyItems : CborErrorTooFewItems;
 
-    if (!parentEncoder->end)
+    if (!parentEncoder->end && !(parentEncoder->flags & CborIteratorFlag_CountOnly))
         return CborErrorOutOfMemory;    /* keep the state */
 
     return CborNoError;
@@ -669,6 +1313,93 @@ CborError cbor_encoder_close_container(CborEncoder *parentEncoder, const CborEnc
  * \sa cbor_encoder_init(), cbor_encoder_get_extra_bytes_needed(), CborEncoding
  */
 
+/**
+ * \fn size_t cbor_encoder_get_counted_size(const CborEncoder *encoder)
+ *
+ * Returns the number of bytes counted by \a encoder, which must have been
+ * initialized with cbor_encoder_init_counting() and whose containers must all
+ * have been closed.
+ *
+ * \sa cbor_encoder_init_counting()
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_uint(uint64_t value)
+ *
+ * Returns the number of bytes that cbor_encode_uint() appends to the stream
+ * for \a value: 1, 2, 3, 5 or 9.
+ *
+ * \sa cbor_encoder_init_counting()
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_int(int64_t value)
+ *
+ * Returns the number of bytes that cbor_encode_int() appends to the stream
+ * for \a value.
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_negative_int(uint64_t absolute_value)
+ *
+ * Returns the number of bytes that cbor_encode_negative_int() appends to the
+ * stream for \a absolute_value.
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_simple_value(uint8_t value)
+ *
+ * Returns the number of bytes that cbor_encode_simple_value() appends to the
+ * stream for \a value.
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_tag(CborTag tag)
+ *
+ * Returns the number of bytes that cbor_encode_tag() appends to the stream
+ * for \a tag. The tagged item is not included.
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_string_header(size_t length)
+ *
+ * Returns the number of bytes that precede the contents of a text or byte
+ * string of \a length bytes.
+ *
+ * \sa cbor_encoded_size_text_string(), cbor_encoded_size_byte_string()
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_text_string(size_t length)
+ *
+ * Returns the number of bytes that cbor_encode_text_string() appends to the
+ * stream for a string of \a length bytes, including the string itself.
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_byte_string(size_t length)
+ *
+ * Returns the number of bytes that cbor_encode_byte_string() appends to the
+ * stream for a string of \a length bytes, including the string itself.
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_floating_point(CborType fpType)
+ *
+ * Returns the number of bytes that cbor_encode_floating_point() appends to
+ * the stream for a value of type \a fpType, which must be one of
+ * CborHalfFloatType, CborFloatType or CborDoubleType.
+ */
+
+/**
+ * \fn size_t cbor_encoded_size_container(size_t length)
+ *
+ * Returns the number of bytes that cbor_encoder_create_array() or
+ * cbor_encoder_create_map() and cbor_encoder_close_container() add around the
+ * contents of an array of \a length items or a map of \a length pairs. For
+ * \ref CborIndefiniteLength, that is the initial byte and the Break.
+ */
+
 /**
  * \fn size_t cbor_encoder_get_extra_bytes_needed(const CborEncoder *encoder)
  *
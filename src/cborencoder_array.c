@@ -0,0 +1,194 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE 1
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "cborinternal_p.h"
+#include "compilersupport_p.h"
+
+/**
+ * \addtogroup CborEncoding
+ * @{
+ */
+
+static CborError encode_typed_array(CborEncoder *encoder, CborTag bigEndianTag, CborTag littleEndianTag,
+                                    const void *data, size_t elementSize, size_t count)
+{
+    CborError err;
+    if (count > SIZE_MAX / elementSize)
+        return CborErrorDataTooLarge;
+
+    err = cbor_encode_tag(encoder, is_little_endian_host() ? littleEndianTag : bigEndianTag);
+    if (err && err != CborErrorOutOfMemory)
+        return err;
+    return cbor_encode_byte_string(encoder, (const uint8_t *)data, count * elementSize);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array: a byte string tagged with
+ * CborTypedArrayUint8Tag. The array counts as a single item in the enclosing
+ * array or map.
+ *
+ * The contents of \a data are copied with a single memcpy() (or a single call
+ * to the writer function), so this is much faster than encoding each element
+ * individually, but the receiver must understand RFC 8746.
+ *
+ * \sa cbor_value_get_uint8_typed_array(), cbor_encode_uint16_typed_array(), cbor_encode_byte_string()
+ */
+CborError cbor_encode_uint8_typed_array(CborEncoder *encoder, const uint8_t *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArrayUint8Tag, CborTypedArrayUint8Tag, data, sizeof(*data), count);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array. The elements are stored in the host's
+ * byte order, so the tag is CborTypedArrayUint16LETag on little-endian hosts
+ * and CborTypedArrayUint16BETag on big-endian ones. The contents of \a data
+ * are copied without conversion.
+ *
+ * \sa cbor_value_get_uint16_typed_array(), cbor_encode_uint8_typed_array()
+ */
+CborError cbor_encode_uint16_typed_array(CborEncoder *encoder, const uint16_t *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArrayUint16BETag, CborTypedArrayUint16LETag,
+                              data, sizeof(*data), count);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array in the host's byte order (tag
+ * CborTypedArrayUint32LETag or CborTypedArrayUint32BETag).
+ *
+ * \sa cbor_value_get_uint32_typed_array(), cbor_encode_uint16_typed_array()
+ */
+CborError cbor_encode_uint32_typed_array(CborEncoder *encoder, const uint32_t *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArrayUint32BETag, CborTypedArrayUint32LETag,
+                              data, sizeof(*data), count);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array in the host's byte order (tag
+ * CborTypedArrayUint64LETag or CborTypedArrayUint64BETag).
+ *
+ * \sa cbor_value_get_uint64_typed_array(), cbor_encode_uint16_typed_array()
+ */
+CborError cbor_encode_uint64_typed_array(CborEncoder *encoder, const uint64_t *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArrayUint64BETag, CborTypedArrayUint64LETag,
+                              data, sizeof(*data), count);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array tagged with CborTypedArraySint8Tag.
+ *
+ * \sa cbor_value_get_int8_typed_array(), cbor_encode_uint8_typed_array()
+ */
+CborError cbor_encode_int8_typed_array(CborEncoder *encoder, const int8_t *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArraySint8Tag, CborTypedArraySint8Tag, data, sizeof(*data), count);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array in the host's byte order (tag
+ * CborTypedArraySint16LETag or CborTypedArraySint16BETag).
+ *
+ * \sa cbor_value_get_int16_typed_array(), cbor_encode_uint16_typed_array()
+ */
+CborError cbor_encode_int16_typed_array(CborEncoder *encoder, const int16_t *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArraySint16BETag, CborTypedArraySint16LETag,
+                              data, sizeof(*data), count);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array in the host's byte order (tag
+ * CborTypedArraySint32LETag or CborTypedArraySint32BETag).
+ *
+ * \sa cbor_value_get_int32_typed_array(), cbor_encode_uint16_typed_array()
+ */
+CborError cbor_encode_int32_typed_array(CborEncoder *encoder, const int32_t *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArraySint32BETag, CborTypedArraySint32LETag,
+                              data, sizeof(*data), count);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array in the host's byte order (tag
+ * CborTypedArraySint64LETag or CborTypedArraySint64BETag).
+ *
+ * \sa cbor_value_get_int64_typed_array(), cbor_encode_uint16_typed_array()
+ */
+CborError cbor_encode_int64_typed_array(CborEncoder *encoder, const int64_t *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArraySint64BETag, CborTypedArraySint64LETag,
+                              data, sizeof(*data), count);
+}
+
+#ifndef CBOR_NO_FLOATING_POINT
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array of IEEE 754 binary32 values in the host's
+ * byte order (tag CborTypedArrayFloat32LETag or CborTypedArrayFloat32BETag).
+ *
+ * \sa cbor_value_get_float_typed_array(), cbor_encode_double_typed_array()
+ */
+CborError cbor_encode_float_typed_array(CborEncoder *encoder, const float *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArrayFloat32BETag, CborTypedArrayFloat32LETag,
+                              data, sizeof(*data), count);
+}
+
+/**
+ * Appends the \a count elements of \a data to the CBOR stream provided by \a
+ * encoder as an RFC 8746 typed array of IEEE 754 binary64 values in the host's
+ * byte order (tag CborTypedArrayFloat64LETag or CborTypedArrayFloat64BETag).
+ *
+ * \sa cbor_value_get_double_typed_array(), cbor_encode_float_typed_array()
+ */
+CborError cbor_encode_double_typed_array(CborEncoder *encoder, const double *data, size_t count)
+{
+    return encode_typed_array(encoder, CborTypedArrayFloat64BETag, CborTypedArrayFloat64LETag,
+                              data, sizeof(*data), count);
+}
+#endif
+
+/** @} */
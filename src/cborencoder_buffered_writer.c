@@ -0,0 +1,122 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborEncoding
+ * @{
+ */
+
+/**
+ * \struct CborBufferedWriter
+ * Staging buffer placed between a CborEncoder and a CborEncoderWriteFunction.
+ * Its members are private; initialize it with
+ * cbor_encoder_init_buffered_writer().
+ */
+
+static CborError buffered_write(void *token, const void *data, size_t len, CborEncoderAppendType appendType)
+{
+    CborBufferedWriter *bufferedWriter = (CborBufferedWriter *)token;
+    if (len > bufferedWriter->size - bufferedWriter->used) {
+        CborError err = cbor_buffered_writer_flush(bufferedWriter);
+        if (err)
+            return err;
+
+        /* too big to be worth copying: pass it on as is */
+        if (len >= bufferedWriter->size)
+            return bufferedWriter->writer(bufferedWriter->token, data, len, appendType);
+    }
+
+    memcpy(bufferedWriter->buffer + bufferedWriter->used, data, len);
+    bufferedWriter->used += len;
+    return CborNoError;
+}
+
+/**
+ * Initializes the CborEncoder \a encoder so that it writes to the function \a
+ * writer, like cbor_encoder_init_writer(), but through the buffer \a buffer of
+ * \a size bytes managed by \a bufferedWriter. The encoder accumulates its
+ * output in \a buffer and calls \a writer (passing it \a token) only when the
+ * buffer is full, when a string payload does not fit in it or when
+ * cbor_buffered_writer_flush() is called. This replaces the one call per
+ * initial byte, tag or number made by a plain writer encoder with one call
+ * per \a size bytes.
+ *
+ * Both \a bufferedWriter and \a buffer must remain valid while \a encoder (or
+ * any container encoder created from it) is in use. Once the encoding is
+ * complete, call cbor_buffered_writer_flush() to write out what is left in
+ * the buffer.
+ *
+ * Since the buffered data mixes CBOR structure and string contents, it is
+ * passed to \a writer as CborEncoderAppendCborData. Strings written without
+ * buffering keep their CborEncoderAppendStringData type.
+ *
+ * This function cannot be used if the library was built with
+ * CBOR_ENCODER_WRITE_FUNCTION defined.
+ *
+ * \sa cbor_encoder_init_writer(), cbor_buffered_writer_flush()
+ */
+void cbor_encoder_init_buffered_writer(CborEncoder *encoder, CborBufferedWriter *bufferedWriter,
+                                       uint8_t *buffer, size_t size, CborEncoderWriteFunction writer, void *token)
+{
+    bufferedWriter->writer = writer;
+    bufferedWriter->token = token;
+    bufferedWriter->buffer = buffer;
+    bufferedWriter->size = size;
+    bufferedWriter->used = 0;
+    cbor_encoder_init_writer(encoder, buffered_write, bufferedWriter);
+}
+
+/**
+ * Passes the data accumulated in \a bufferedWriter to its write function and
+ * empties the buffer. If the write function returns an error, this function
+ * returns that error and the data stays in the buffer.
+ *
+ * \sa cbor_encoder_init_buffered_writer()
+ */
+CborError cbor_buffered_writer_flush(CborBufferedWriter *bufferedWriter)
+{
+    CborError err;
+    if (bufferedWriter->used == 0)
+        return CborNoError;
+
+    err = bufferedWriter->writer(bufferedWriter->token, bufferedWriter->buffer, bufferedWriter->used,
+                                 CborEncoderAppendCborData);
+    if (!err)
+        bufferedWriter->used = 0;
+    return err;
+}
+
+/** @} */
@@ -0,0 +1,259 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "compilersupport_p.h"
+#include "memory.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborEncoding
+ * @{
+ */
+
+/**
+ * \struct CborAllocator
+ * Set of memory allocation functions, all of which receive the \c context
+ * member as their first argument. \c allocate and \c reallocate return null on
+ * failure; \c reallocate and \c deallocate receive the current size of the
+ * block, which allows implementing them on top of a simple bump allocator.
+ */
+
+/**
+ * \struct CborGrowableBuffer
+ * Buffer that is enlarged as data is written to it, by an encoder initialized
+ * with cbor_encoder_init_growable() or by cbor_value_to_json_buffer_advance().
+ * The \c data member points to the data and \c size contains its length. The
+ * other members are private.
+ */
+
+enum { MinimumGrowableBufferSize = 64 };
+
+static void *default_allocate(void *context, size_t size)
+{
+    (void)context;
+    return cbor_malloc(size);
+}
+
+static void *default_reallocate(void *context, void *ptr, size_t oldSize, size_t newSize)
+{
+    (void)context;
+#ifdef cbor_realloc
+    (void)oldSize;
+    return cbor_realloc(ptr, newSize);
+#else
+    void *newptr = cbor_malloc(newSize);
+    if (newptr) {
+        memcpy(newptr, ptr, oldSize < newSize ? oldSize : newSize);
+        cbor_free(ptr);
+    }
+    return newptr;
+#endif
+}
+
+static void default_deallocate(void *context, void *ptr, size_t size)
+{
+    (void)context;
+    (void)size;
+    cbor_free(ptr);
+}
+
+static const CborAllocator defaultAllocator = {
+    default_allocate,
+    default_reallocate,
+    default_deallocate,
+    NULL
+};
+
+static CborError grow(CborGrowableBuffer *buffer, size_t needed)
+{
+    void *newdata;
+    size_t newCapacity = buffer->capacity;
+
+    /* double the capacity until there's enough room */
+    if (newCapacity < MinimumGrowableBufferSize)
+        newCapacity = MinimumGrowableBufferSize;
+    while (newCapacity < needed) {
+        if (newCapacity > SIZE_MAX / 2) {
+            newCapacity = needed;
+            break;
+        }
+        newCapacity *= 2;
+    }
+
+    if (buffer->data)
+        newdata = buffer->allocator->reallocate(buffer->allocator->context, buffer->data,
+                                                buffer->capacity, newCapacity);
+    else
+        newdata = buffer->allocator->allocate(buffer->allocator->context, newCapacity);
+    if (!newdata)
+        return CborErrorOutOfMemory;
+
+    buffer->data = (uint8_t *)newdata;
+    buffer->capacity = newCapacity;
+    return CborNoError;
+}
+
+static CborError growable_write(void *token, const void *data, size_t len, CborEncoderAppendType appendType)
+{
+    CborGrowableBuffer *buffer = (CborGrowableBuffer *)token;
+    CborError err;
+    (void)appendType;
+
+    err = cbor_growable_buffer_reserve(buffer, len);
+    if (err)
+        return err;
+
+    memcpy(buffer->data + buffer->size, data, len);
+    buffer->size += len;
+    return CborNoError;
+}
+
+/**
+ * Initializes the empty growable buffer \a buffer, which will allocate memory
+ * using the functions in \a allocator (or cbor_malloc, cbor_realloc and
+ * cbor_free if \a allocator is null). The first allocation is of \a
+ * initialCapacity bytes, or 64 bytes if that is smaller, and the capacity is
+ * doubled every time it is exhausted.
+ *
+ * Use this function to prepare a buffer for consumers other than the encoder,
+ * like cbor_value_to_json_buffer_advance(). To encode CBOR into a growable
+ * buffer, use cbor_encoder_init_growable() instead.
+ *
+ * \sa cbor_growable_buffer_reserve(), cbor_growable_buffer_release(), cbor_growable_buffer_free()
+ */
+void cbor_growable_buffer_init(CborGrowableBuffer *buffer, const CborAllocator *allocator, size_t initialCapacity)
+{
+    buffer->allocator = allocator ? allocator : &defaultAllocator;
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+    buffer->error = CborNoError;
+    if (initialCapacity)
+        buffer->error = grow(buffer, initialCapacity);
+}
+
+/**
+ * Ensures that \a buffer has room for at least \a len more bytes after its
+ * current \c size, enlarging it if necessary. The caller may then write up to
+ * that many bytes at <tt>data + size</tt> and add the number of bytes written
+ * to \c size.
+ *
+ * Returns CborErrorOutOfMemory if an allocation failed (or
+ * CborErrorDataTooLarge if the size would overflow). Errors are sticky: once
+ * one has happened, this function keeps returning it.
+ *
+ * \sa cbor_growable_buffer_init()
+ */
+CborError cbor_growable_buffer_reserve(CborGrowableBuffer *buffer, size_t len)
+{
+    size_t needed;
+    if (buffer->error)
+        return buffer->error;
+    if (add_check_overflow(buffer->size, len, &needed))
+        buffer->error = CborErrorDataTooLarge;
+    else if (needed > buffer->capacity)
+        buffer->error = grow(buffer, needed);
+    return buffer->error;
+}
+
+/**
+ * Initializes the CborEncoder \a encoder so that it writes to a buffer that it
+ * allocates and enlarges as needed, using the functions in \a allocator (or
+ * cbor_malloc, cbor_realloc and cbor_free if \a allocator is null). The buffer
+ * is managed by \a buffer, which must remain valid while \a encoder (or any
+ * container encoder created from it) is in use. The first allocation is of \a
+ * initialCapacity bytes, or 64 bytes if that is smaller, and the capacity is
+ * doubled every time it is exhausted. The data is therefore encoded only
+ * once, unlike with the retry loop needed when encoding to a fixed buffer.
+ *
+ * Once the encoding is complete, obtain the data with
+ * cbor_growable_buffer_release(), or access it in \a buffer and then release
+ * it with cbor_growable_buffer_free().
+ *
+ * If an allocation fails, the encoding functions return CborErrorOutOfMemory,
+ * as do all further encoding calls: the encoded data is then incomplete.
+ *
+ * This function cannot be used if the library was built with
+ * CBOR_ENCODER_WRITE_FUNCTION defined.
+ *
+ * \sa cbor_encoder_init(), cbor_encoder_init_writer()
+ */
+void cbor_encoder_init_growable(CborEncoder *encoder, CborGrowableBuffer *buffer, const CborAllocator *allocator,
+                                size_t initialCapacity)
+{
+    cbor_growable_buffer_init(buffer, allocator, initialCapacity);
+    cbor_encoder_init_writer(encoder, growable_write, buffer);
+}
+
+/**
+ * Transfers the ownership of the data written into \a buffer to the caller and
+ * returns a pointer to it, storing its length in \a size. The memory must be
+ * freed with the \c deallocate function of the allocator that was passed to
+ * cbor_encoder_init_growable() (or cbor_free if that was null), passing the
+ * capacity obtained from \a buffer before this call if the allocator needs it.
+ *
+ * If an allocation failed during the encoding, this function frees the data
+ * and returns null. After this function returns, \a buffer is empty.
+ *
+ * \sa cbor_encoder_init_growable(), cbor_growable_buffer_free()
+ */
+uint8_t *cbor_growable_buffer_release(CborGrowableBuffer *buffer, size_t *size)
+{
+    uint8_t *data = buffer->data;
+    if (buffer->error) {
+        cbor_growable_buffer_free(buffer);
+        data = NULL;
+    }
+
+    *size = data ? buffer->size : 0;
+    buffer->data = NULL;
+    buffer->size = buffer->capacity = 0;
+    return data;
+}
+
+/**
+ * Frees the data written into \a buffer. After this function returns, \a
+ * buffer is empty.
+ *
+ * \sa cbor_encoder_init_growable(), cbor_growable_buffer_release()
+ */
+void cbor_growable_buffer_free(CborGrowableBuffer *buffer)
+{
+    if (buffer->data)
+        buffer->allocator->deallocate(buffer->allocator->context, buffer->data, buffer->capacity);
+    buffer->data = NULL;
+    buffer->size = buffer->capacity = 0;
+}
+
+/** @} */
@@ -66,8 +66,11 @@
  * \value CborErrorDataTooLarge         Data item size exceeds TinyCBOR's implementation limits
  * \value CborErrorNestingTooDeep       Data item nesting exceeds TinyCBOR's implementation limits
  * \omitvalue CborErrorUnsupportedType
+ * \value CborErrorUnsupportedSource    The operation requires the parser to read from a linear buffer (see cbor_parser_init())
  * \value CborErrorJsonObjectKeyIsAggregate Conversion to JSON failed because the key in a map is a CBOR map or array
  * \value CborErrorJsonObjectKeyNotString Conversion to JSON failed because the key in a map is not a text string
+ * \value CborErrorJsonSyntax           Conversion from JSON failed because the input is not valid JSON
+ * \value CborErrorJsonInvalidMetadata  Conversion from JSON failed because the metadata for a value is malformed or does not match it
  * \value CborErrorOutOfMemory          During CBOR encoding, the buffer provided is insufficient for encoding the data item;
  *                                      in other situations, TinyCBOR failed to allocate memory
  * \value CborErrorInternalError        An internal error occurred in TinyCBOR
@@ -175,12 +178,21 @@ const char *cbor_error_string(CborError error)
     case CborErrorUnimplementedValidation:
         return _("validation not implemented for the current parser state");
 
+    case CborErrorUnsupportedSource:
+        return _("operation not supported for parsers reading from an external source");
+
     case CborErrorJsonObjectKeyIsAggregate:
         return _("conversion to JSON failed: key in object is an array or map");
 
     case CborErrorJsonNotImplemented:
         return _("conversion to JSON failed: open_memstream unavailable");
 
+    case CborErrorJsonSyntax:
+        return _("conversion from JSON failed: syntax error");
+
+    case CborErrorJsonInvalidMetadata:
+        return _("conversion from JSON failed: invalid metadata");
+
     case CborErrorInternalError:
         return _("internal error");
     }
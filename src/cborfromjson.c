@@ -0,0 +1,1714 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "cborjson.h"
+#include "cborinternal_p.h"
+#include "compilersupport_p.h"
+#include "utf8_p.h"
+
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \defgroup CborFromJson Converting JSON to CBOR
+ * \brief Group of functions used to convert JSON to CBOR.
+ *
+ * This group contains functions that read one JSON value and encode the
+ * equivalent CBOR data item with a CborEncoder. The conversion happens in two
+ * stages that run interleaved, without building a tree of the document: a
+ * structural scan classifies the input 64 bytes at a time (with SSE2 or AVX2
+ * if the compiler enables them) to find where strings end and how many
+ * elements each array and object has, and the tokenizer then encodes each
+ * value as it reads it.
+ *
+ * When reading from a C standard library stream, only the data the scan needs
+ * to look ahead and the longest string or number of the input need to fit in
+ * memory, so combined with an encoder that writes to a function (see
+ * cbor_encoder_init_writer() and cbor_encoder_init_buffered_writer()), these
+ * functions can convert documents larger than the available memory. The scan
+ * keeps about one byte for every eight it looks ahead, plus a few words per
+ * container.
+ *
+ * The conversion is the following:
+ * \li JSON objects and arrays become CBOR maps and arrays of definite length.
+ *     When reading from a stream, the scan reads at most 1 MB ahead to find
+ *     the end of a container, so larger containers are encoded with
+ *     indefinite length. So are objects with a member whose name has escape
+ *     sequences or is just "$cbor" when CborConvertReadMetadata is used, as
+ *     whether that member is converted can't be known in advance.
+ * \li strings become text strings, after the escape sequences are decoded;
+ * \li \c true, \c false and \c null become the CBOR simple values of the same
+ *     name;
+ * \li numbers written without fraction or exponent that fit in 64 bits become
+ *     CBOR integers, as do other numbers whose value is an integer that fits
+ *     in int64_t (other than negative zero). All other numbers become
+ *     double-precision floating point.
+ *
+ * If the CborConvertReadMetadata flag is passed, the functions restore the
+ * information that cbor_value_to_json_advance() stores when called with
+ * CborConvertAddMetadata: for each member of an object, a member whose name
+ * is the member's name followed by "$cbor" may describe the original tag, type
+ * and value. Those members are not converted themselves. The metadata must
+ * immediately follow the member it applies to, which is how TinyCBOR writes
+ * it; to find it, the functions read ahead past each member's value, so when
+ * reading from a stream, the value of each member of an object needs to fit in
+ * memory.
+ *
+ * The functions return CborErrorJsonSyntax if the input is not valid JSON,
+ * CborErrorUnexpectedEOF if it ends before the value is complete and
+ * CborErrorGarbageAtEnd if anything other than whitespace follows the value.
+ * They return CborErrorInvalidUtf8TextString if a string contains invalid
+ * UTF-8 sequences, including unpaired surrogates written as escape
+ * sequences, and CborErrorJsonInvalidMetadata if the metadata for a value is
+ * malformed or does not match that value. Reading errors from the stream
+ * cause CborErrorIO, and containers nested more than
+ * CBOR_PARSER_MAX_RECURSIONS levels deep, CborErrorNestingTooDeep.
+ *
+ * If the encoder runs out of buffer space, the conversion continues until the
+ * end of the input and then returns CborErrorOutOfMemory, so that
+ * cbor_encoder_get_extra_bytes_needed() can be used. All other errors stop
+ * the conversion immediately.
+ *
+ * \sa CborEncoding, CborToJson
+ */
+
+/**
+ * \addtogroup CborFromJson
+ * @{
+ */
+
+enum {
+    JsonReadSize = 16384,
+    JsonIndexChunkSize = 65536,     /* scanned at a time when converting from memory */
+    JsonMaxCountAhead = 1024 * 1024,    /* read ahead in a stream to find a container's length */
+    JsonMaxNumberSize = 64,         /* longer numbers are copied to the scratch buffer */
+    JsonMaxMetadataValueSize = 24   /* "+ffffffffffffffff" and "-inf" fit */
+};
+
+#define JSON_BLOCK_SIZE         64
+#define JSON_UNKNOWN_LENGTH     SIZE_MAX
+
+/* A container found by the structural scan */
+typedef struct JsonContainer {
+    size_t offset;                  /* of the '[' or '{' in the input */
+    size_t length;                  /* elements or members; JSON_UNKNOWN_LENGTH until its end is found */
+} JsonContainer;
+
+/* The state of the structural scan for each container still open */
+typedef struct JsonScanLevel {
+    size_t container;               /* number of the entry in JsonIndex::containers */
+    size_t commas;
+    size_t metadataMembers;         /* not converted, so not counted */
+    size_t keyOffset;               /* of the opening quote of the current member's name */
+    bool isMap;
+    bool empty;
+    bool expectKey;
+    bool inKey;
+    bool keyEscaped;
+    bool uncounted;                 /* a member's name may or may not be metadata */
+} JsonScanLevel;
+
+/* Stage 1 of the conversion: the result of scanning the input read so far
+ * for strings and containers. All offsets are from the start of the input. */
+typedef struct JsonIndex {
+    CborGrowableBuffer specials;    /* one uint64_t per block: quotation marks and, in strings,
+                                     * backslashes and control characters */
+    CborGrowableBuffer containers;  /* JsonContainer, in the order they start */
+    CborGrowableBuffer levels;      /* JsonScanLevel, from the top level (which is no container) */
+    size_t scanned;                 /* offset of the first byte not scanned */
+    size_t firstBlock;              /* of the first word in specials */
+    size_t firstContainer;          /* number of the first entry in containers */
+    size_t nextContainer;           /* number of the next container the conversion will start */
+    size_t depth;                   /* containers open, including those too deep to have a level */
+    bool escapeNext;                /* the previous block ended in a backslash that escapes */
+    bool inString;                  /* the previous block ended inside a string */
+    bool finished;                  /* the whole input has been scanned */
+} JsonIndex;
+
+/* The input is the window [ptr, end), which is either the whole JSON text or
+ * the part of the stream read so far that is still needed. Reading more data
+ * may move the window, so the tokenizer works with offsets from ptr until it
+ * consumes a token. */
+typedef struct JsonInput {
+    const char *ptr;
+    const char *end;
+    const char *mark;               /* start of a lookahead, kept when reading more */
+    const char *base;               /* start of the data in memory ... */
+    size_t origin;                  /* ... and its offset in the input */
+    FILE *file;
+    CborGrowableBuffer window;      /* data read from file */
+    CborGrowableBuffer scratch;     /* unescaped strings and long numbers */
+    CborGrowableBuffer key;         /* the current member's name, to find its metadata */
+    JsonIndex index;
+    int flags;
+    bool outOfMemory;               /* the encoder ran out of buffer space */
+} JsonInput;
+
+typedef struct JsonNumber {
+    uint64_t integer;               /* absolute value, if isInteger */
+    double value;
+    bool isInteger;                 /* written without fraction or exponent and fits in 64 bits */
+    bool negative;
+} JsonNumber;
+
+typedef struct JsonMetadata {
+    CborTag tag;
+    uint64_t simpleType;
+    int type;                       /* CborInvalidType if there was no "t" */
+    bool tagged;
+    bool hasSimpleType;             /* "v" was a number */
+    char value[JsonMaxMetadataValueSize];   /* "v" if it was a string, else empty */
+} JsonMetadata;
+
+static const char metadataSuffix[] = "$cbor";
+#define METADATA_SUFFIX_LENGTH  (sizeof(metadataSuffix) - 1)
+
+static CborError value_to_cbor(JsonInput *in, CborEncoder *encoder, int nestingLevel);
+
+static inline size_t json_offset(const JsonInput *in, const char *p)
+{
+    return in->origin + (size_t)(p - in->base);
+}
+
+static inline const char *json_pointer(const JsonInput *in, size_t offset)
+{
+    return in->base + (offset - in->origin);
+}
+
+/*
+ * Stage 1: the structural scan. Like simdjson (Langdale and Lemire, "Parsing
+ * Gigabytes of JSON per Second", 2019), the input is classified 64 bytes at a
+ * time into bit masks, from which the escaped characters and then the string
+ * contents are computed without branching on each byte. The quotation marks,
+ * and the backslashes and control characters inside strings, are kept in a
+ * bitmap so the conversion can find the end of each string without reading
+ * it. The brackets, braces and commas outside strings are used to count the
+ * elements and members of each container, so that the conversion can encode
+ * them with definite length.
+ */
+typedef struct JsonBlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t control;               /* below 0x20 */
+    uint64_t structural;            /* brackets, braces and commas */
+    uint64_t blank;                 /* whitespace (and other control characters) and colons */
+} JsonBlockMasks;
+
+static void json_classify_block(const uint8_t *p, JsonBlockMasks *m)
+{
+    unsigned i;
+    memset(m, 0, sizeof(*m));
+#if defined(__AVX2__)
+    for (i = 0; i < JSON_BLOCK_SIZE; i += 32) {
+        __m256i input = _mm256_loadu_si256((const __m256i *)(p + i));
+        /* OR'ing 0x20 maps '[' to '{' and ']' to '}' */
+        __m256i folded = _mm256_or_si256(input, _mm256_set1_epi8(0x20));
+        __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(0x1f)), input);
+        __m256i structural = _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                                             _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}')));
+        __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8(' ')),
+                                        _mm256_cmpeq_epi8(input, _mm256_set1_epi8(':')));
+        structural = _mm256_or_si256(structural, _mm256_cmpeq_epi8(input, _mm256_set1_epi8(',')));
+        blank = _mm256_or_si256(blank, control);
+        m->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('"'))) << i;
+        m->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('\\'))) << i;
+        m->control |= (uint64_t)(uint32_t)_mm256_movemask_epi8(control) << i;
+        m->structural |= (uint64_t)(uint32_t)_mm256_movemask_epi8(structural) << i;
+        m->blank |= (uint64_t)(uint32_t)_mm256_movemask_epi8(blank) << i;
+    }
+#elif defined(__SSE2__)
+    for (i = 0; i < JSON_BLOCK_SIZE; i += 16) {
+        __m128i input = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i folded = _mm_or_si128(input, _mm_set1_epi8(0x20));
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(input, _mm_set1_epi8(0x1f)), input);
+        __m128i structural = _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                                          _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+        __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8(' ')),
+                                     _mm_cmpeq_epi8(input, _mm_set1_epi8(':')));
+        structural = _mm_or_si128(structural, _mm_cmpeq_epi8(input, _mm_set1_epi8(',')));
+        blank = _mm_or_si128(blank, control);
+        m->quote |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(input, _mm_set1_epi8('"'))) << i;
+        m->backslash |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(input, _mm_set1_epi8('\\'))) << i;
+        m->control |= (uint64_t)(unsigned)_mm_movemask_epi8(control) << i;
+        m->structural |= (uint64_t)(unsigned)_mm_movemask_epi8(structural) << i;
+        m->blank |= (uint64_t)(unsigned)_mm_movemask_epi8(blank) << i;
+    }
+#else
+    for (i = 0; i < JSON_BLOCK_SIZE; ++i) {
+        uint64_t bit = (uint64_t)1 << i;
+        switch (p[i]) {
+        case '"':
+            m->quote |= bit;
+            break;
+        case '\\':
+            m->backslash |= bit;
+            break;
+        case '[':
+        case ']':
+        case '{':
+        case '}':
+        case ',':
+            m->structural |= bit;
+            break;
+        case ' ':
+        case ':':
+            m->blank |= bit;
+            break;
+        default:
+            if (p[i] < 0x20) {
+                m->control |= bit;
+                m->blank |= bit;
+            }
+            break;
+        }
+    }
+#endif
+}
+
+/* Sets each bit to the XOR of itself and all the bits below it, which turns
+ * the quotation marks into a mask of the strings' contents */
+static inline uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static inline JsonScanLevel *json_scan_level(JsonIndex *index)
+{
+    size_t depth = index->depth <= CBOR_PARSER_MAX_RECURSIONS ? index->depth : CBOR_PARSER_MAX_RECURSIONS;
+    return (JsonScanLevel *)index->levels.data + depth;
+}
+
+static CborError json_scan_open(JsonInput *in, size_t offset, bool isMap)
+{
+    JsonIndex *index = &in->index;
+    JsonScanLevel *level;
+    JsonContainer *container;
+    CborError err;
+
+    json_scan_level(index)->empty = false;
+    if (index->depth++ >= CBOR_PARSER_MAX_RECURSIONS)
+        return CborNoError;     /* too deep: the conversion will fail */
+
+    err = cbor_growable_buffer_reserve(&index->containers, sizeof(JsonContainer));
+    if (!err)
+        err = cbor_growable_buffer_reserve(&index->levels, sizeof(JsonScanLevel));
+    if (err)
+        return err;
+    container = (JsonContainer *)(index->containers.data + index->containers.size);
+    container->offset = offset;
+    container->length = JSON_UNKNOWN_LENGTH;
+    index->containers.size += sizeof(JsonContainer);
+    index->levels.size += sizeof(JsonScanLevel);
+
+    level = json_scan_level(index);
+    memset(level, 0, sizeof(*level));
+    level->container = index->firstContainer + index->containers.size / sizeof(JsonContainer) - 1;
+    level->isMap = isMap;
+    level->empty = true;
+    level->expectKey = isMap;
+    return CborNoError;
+}
+
+static void json_scan_close(JsonIndex *index)
+{
+    JsonScanLevel *level;
+    size_t length;
+    if (!index->depth)
+        return;                 /* unbalanced: the conversion will fail */
+    if (index->depth-- > CBOR_PARSER_MAX_RECURSIONS)
+        return;
+
+    level = json_scan_level(index) + 1;
+    index->levels.size -= sizeof(JsonScanLevel);
+    if (level->uncounted)
+        return;
+    length = level->empty ? 0 : level->commas + 1 - level->metadataMembers;
+    if (level->container >= index->firstContainer) {
+        /* otherwise the conversion has already started it */
+        JsonContainer *container = (JsonContainer *)index->containers.data + (level->container - index->firstContainer);
+        container->length = length;
+    }
+}
+
+/* When reading metadata, a member whose name ends in "$cbor" is not converted
+ * (see map_member_to_cbor() and find_metadata()). If the name has escape
+ * sequences or is just "$cbor", that can't be told without decoding it or
+ * knowing the previous member's name, so the map's length is left unknown. */
+static void json_scan_key(JsonInput *in, JsonScanLevel *level, size_t closingQuote)
+{
+    size_t len = closingQuote - level->keyOffset - 1;
+    level->inKey = false;
+    level->expectKey = false;
+    if (!(in->flags & CborConvertReadMetadata) || len < METADATA_SUFFIX_LENGTH)
+        return;
+    if (level->keyEscaped) {
+        level->uncounted = true;
+    } else if (memcmp(json_pointer(in, closingQuote - METADATA_SUFFIX_LENGTH), metadataSuffix,
+                      METADATA_SUFFIX_LENGTH) == 0) {
+        if (len == METADATA_SUFFIX_LENGTH)
+            level->uncounted = true;
+        else
+            ++level->metadataMembers;
+    }
+}
+
+/* Scans the block at \a p, which starts at \a offset in the input. There must
+ * be room for its word in the specials buffer. */
+static CborError json_scan_block(JsonInput *in, const uint8_t *p, size_t offset)
+{
+    JsonIndex *index = &in->index;
+    JsonBlockMasks m;
+    uint64_t escaped, backslashes, quotes, inString, content, events;
+    CborError err;
+
+    json_classify_block(p, &m);
+
+    /* a backslash escapes the next character, unless it is escaped itself;
+     * backslashes are rare, so resolve them one at a time */
+    escaped = index->escapeNext;
+    index->escapeNext = false;
+    backslashes = m.backslash & ~escaped;
+    while (backslashes) {
+        unsigned i = count_trailing_zeros64(backslashes);
+        if (i == JSON_BLOCK_SIZE - 1) {
+            index->escapeNext = true;
+            break;
+        }
+        escaped |= (uint64_t)2 << i;
+        backslashes &= ~((uint64_t)3 << i);
+    }
+
+    /* inside strings, including the opening quotation mark but not the
+     * closing one; blocks in the middle of long strings have neither */
+    quotes = m.quote & ~escaped;
+    inString = (quotes ? prefix_xor(quotes) : 0) ^ (index->inString ? ~(uint64_t)0 : 0);
+    index->inString = inString >> (JSON_BLOCK_SIZE - 1);
+
+    ((uint64_t *)index->specials.data)[index->specials.size / sizeof(uint64_t)] =
+            quotes | ((m.backslash | m.control) & inString);
+    index->specials.size += sizeof(uint64_t);
+
+    /* numbers and literals, which only matter to tell empty containers */
+    content = ~(m.blank | m.structural | m.quote | inString);
+    events = quotes | (m.structural & ~inString);
+    if (in->flags & CborConvertReadMetadata)
+        events |= m.backslash & inString;
+
+    while (events) {
+        unsigned i = count_trailing_zeros64(events);
+        uint64_t bit = (uint64_t)1 << i;
+        JsonScanLevel *level = json_scan_level(index);
+        if (content & (bit - 1)) {
+            level->empty = false;
+            content &= ~(bit - 1);
+        }
+        events &= events - 1;
+
+        switch (p[i]) {
+        case '"':
+            if (inString & bit) {
+                level->empty = false;
+                if (level->expectKey) {
+                    level->inKey = true;
+                    level->keyEscaped = false;
+                    level->keyOffset = offset + i;
+                }
+            } else if (level->inKey) {
+                json_scan_key(in, level, offset + i);
+            }
+            break;
+
+        case '\\':
+            if (level->inKey)
+                level->keyEscaped = true;
+            break;
+
+        case '[':
+        case '{':
+            err = json_scan_open(in, offset + i, p[i] == '{');
+            if (err)
+                return err;
+            break;
+
+        case ']':
+        case '}':
+            json_scan_close(index);
+            break;
+
+        case ',':
+            ++level->commas;
+            level->expectKey = level->isMap;
+            break;
+        }
+    }
+    if (content)
+        json_scan_level(index)->empty = false;
+    return CborNoError;
+}
+
+/* Scans the complete blocks of data available up to \a limit, and the rest of
+ * it too if it is the end of the input */
+static CborError json_scan(JsonInput *in, size_t limit, bool atEnd)
+{
+    JsonIndex *index = &in->index;
+    size_t blocks = (limit - index->scanned) / JSON_BLOCK_SIZE + atEnd;
+    CborError err = cbor_growable_buffer_reserve(&index->specials, blocks * sizeof(uint64_t));
+    while (!err && limit - index->scanned >= JSON_BLOCK_SIZE) {
+        err = json_scan_block(in, (const uint8_t *)json_pointer(in, index->scanned), index->scanned);
+        index->scanned += JSON_BLOCK_SIZE;
+    }
+    if (!err && atEnd) {
+        /* pad the last block with spaces */
+        uint8_t block[JSON_BLOCK_SIZE];
+        memset(block, ' ', sizeof(block));
+        if (limit != index->scanned)
+            memcpy(block, json_pointer(in, index->scanned), limit - index->scanned);
+        err = json_scan_block(in, block, index->scanned);
+        index->scanned += JSON_BLOCK_SIZE;
+        index->finished = true;
+    }
+    return err;
+}
+
+/* Drops the parts of the index that the conversion no longer needs and
+ * returns the offset of the data that must be kept: from the lookahead mark or
+ * the current position, and at least the last block scanned, which the
+ * scanning of the next one may look back into. */
+static size_t json_index_compact(JsonInput *in)
+{
+    JsonIndex *index = &in->index;
+    size_t keep = in->base ? json_offset(in, in->mark ? in->mark : in->ptr) : 0;
+    size_t lastBlock = index->scanned >= JSON_BLOCK_SIZE ? index->scanned - JSON_BLOCK_SIZE : 0;
+    size_t n;
+    if (keep > lastBlock)
+        keep = lastBlock;
+    if (keep < in->origin)
+        keep = in->origin;
+
+    if (keep / JSON_BLOCK_SIZE > index->firstBlock) {
+        n = keep / JSON_BLOCK_SIZE - index->firstBlock;
+        index->specials.size -= n * sizeof(uint64_t);
+        memmove(index->specials.data, index->specials.data + n * sizeof(uint64_t), index->specials.size);
+        index->firstBlock += n;
+    }
+
+    n = index->nextContainer - index->firstContainer;
+    if (n) {
+        index->containers.size -= n * sizeof(JsonContainer);
+        memmove(index->containers.data, index->containers.data + n * sizeof(JsonContainer),
+                index->containers.size);
+        index->firstContainer += n;
+    }
+    return keep;
+}
+
+/* Reads more data from the stream and scans it, keeping everything from the
+ * lookahead mark or the current position onwards. Returns
+ * CborErrorUnexpectedEOF at the end of the input, once all of it has been
+ * scanned. */
+static CborError json_fill(JsonInput *in)
+{
+    CborGrowableBuffer *window = &in->window;
+    size_t keep, ptrOffset, markOffset;
+    size_t n;
+    CborError err;
+
+    if (!in->file)
+        return CborErrorUnexpectedEOF;
+
+    /* move the data we still need to the start of the buffer */
+    ptrOffset = in->base ? json_offset(in, in->ptr) : 0;
+    markOffset = in->mark ? json_offset(in, in->mark) : 0;
+    keep = json_index_compact(in);
+    if (window->data) {
+        window->size = (size_t)(in->end - json_pointer(in, keep));
+        memmove(window->data, json_pointer(in, keep), window->size);
+    }
+    err = cbor_growable_buffer_reserve(window, JsonReadSize);
+    if (err)
+        return err;
+
+    in->base = (const char *)window->data;
+    in->origin = keep;
+    in->ptr = json_pointer(in, ptrOffset);
+    if (in->mark)
+        in->mark = json_pointer(in, markOffset);
+    in->end = in->base + window->size;
+
+    if (in->index.finished)
+        return CborErrorUnexpectedEOF;
+    n = fread(window->data + window->size, 1, window->capacity - window->size, in->file);
+    if (n == 0 && ferror(in->file))
+        return CborErrorIO;
+    window->size += n;
+    in->end += n;
+    return json_scan(in, json_offset(in, in->end), n == 0);
+}
+
+/* Extends the index: when converting from memory, scans the next part of the
+ * input; otherwise, reads more of the stream */
+static CborError json_index_more(JsonInput *in)
+{
+    size_t limit;
+    if (in->file)
+        return json_fill(in);
+    if (in->index.finished)
+        return CborErrorUnexpectedEOF;
+
+    json_index_compact(in);
+    limit = json_offset(in, in->end);
+    if (limit - in->index.scanned > JsonIndexChunkSize)
+        return json_scan(in, in->index.scanned + JsonIndexChunkSize, false);
+    return json_scan(in, limit, true);
+}
+
+/* Finds the first quotation mark, or backslash or control character in a
+ * string, at or after *offset */
+static CborError json_find_special(JsonInput *in, size_t *offset)
+{
+    JsonIndex *index = &in->index;
+    for (;;) {
+        while (*offset < index->scanned) {
+            size_t block = *offset / JSON_BLOCK_SIZE;
+            uint64_t word = ((const uint64_t *)index->specials.data)[block - index->firstBlock];
+            word &= ~(uint64_t)0 << (*offset % JSON_BLOCK_SIZE);
+            if (word) {
+                *offset = block * JSON_BLOCK_SIZE + count_trailing_zeros64(word);
+                return *offset < json_offset(in, in->end) ? CborNoError : CborErrorUnexpectedEOF;
+            }
+            *offset = (block + 1) * JSON_BLOCK_SIZE;
+        }
+        CborError err = json_index_more(in);
+        if (err)
+            return err;
+    }
+}
+
+/* Returns the length of the container that starts at the current position,
+ * or CborIndefiniteLength if its end has not been found: when reading from a
+ * stream, only up to JsonMaxCountAhead bytes are read ahead to find it. */
+static CborError json_container_length(JsonInput *in, size_t *length)
+{
+    JsonIndex *index = &in->index;
+    size_t offset = json_offset(in, in->ptr);
+    const JsonContainer *container = NULL;
+    CborError err;
+
+    *length = CborIndefiniteLength;
+    for (;;) {
+        /* skip the containers that the conversion doesn't start, like metadata */
+        size_t count = index->containers.size / sizeof(JsonContainer);
+        while (index->nextContainer - index->firstContainer < count) {
+            container = (const JsonContainer *)index->containers.data + (index->nextContainer - index->firstContainer);
+            if (container->offset >= offset)
+                break;
+            ++index->nextContainer;
+            container = NULL;
+        }
+        if (container && container->offset != offset)
+            return CborNoError;         /* too deep for the scan */
+        if (container && container->length != JSON_UNKNOWN_LENGTH)
+            break;
+        if (index->finished || (!container && offset < index->scanned))
+            return CborNoError;
+        if (in->file && index->scanned > offset && index->scanned - offset >= JsonMaxCountAhead)
+            return CborNoError;
+
+        err = json_index_more(in);
+        if (err == CborErrorUnexpectedEOF)
+            return CborNoError;
+        if (err)
+            return err;
+        container = NULL;
+    }
+
+    ++index->nextContainer;
+    *length = container->length;
+    return CborNoError;
+}
+
+/* Returns the character at offset i from the current position, reading more
+ * data if necessary, or -1 at the end of the input or on error (which is then
+ * stored in *err). */
+static int json_char_at(JsonInput *in, size_t i, CborError *err)
+{
+    while (i >= (size_t)(in->end - in->ptr)) {
+        CborError e = json_fill(in);
+        if (e) {
+            if (e != CborErrorUnexpectedEOF)
+                *err = e;
+            return -1;
+        }
+    }
+    return (uint8_t)in->ptr[i];
+}
+
+/* Skips whitespace and returns the next character, without consuming it */
+static CborError json_peek(JsonInput *in, char *c)
+{
+    for (;;) {
+        while (in->ptr != in->end) {
+            char ch = *in->ptr;
+            if (ch != ' ' && ch != '\n' && ch != '\r' && ch != '\t') {
+                *c = ch;
+                return CborNoError;
+            }
+            ++in->ptr;
+        }
+        CborError err = json_fill(in);
+        if (err)
+            return err;
+    }
+}
+
+static CborError json_expect(JsonInput *in, char expected)
+{
+    char c;
+    CborError err = json_peek(in, &c);
+    if (err)
+        return err;
+    if (c != expected)
+        return CborErrorJsonSyntax;
+    ++in->ptr;
+    return CborNoError;
+}
+
+static CborError json_skip(JsonInput *in, size_t len)
+{
+    while ((size_t)(in->end - in->ptr) < len) {
+        CborError err;
+        len -= (size_t)(in->end - in->ptr);
+        in->ptr = in->end;
+        err = json_fill(in);
+        if (err)
+            return err;
+    }
+    in->ptr += len;
+    return CborNoError;
+}
+
+static CborError json_expect_literal(JsonInput *in, const char *literal, size_t len)
+{
+    while ((size_t)(in->end - in->ptr) < len) {
+        /* report a mismatch ahead of a premature end of input */
+        CborError err;
+        if (in->ptr != in->end && memcmp(in->ptr, literal, in->end - in->ptr) != 0)
+            return CborErrorJsonSyntax;
+        err = json_fill(in);
+        if (err)
+            return err;
+    }
+    if (memcmp(in->ptr, literal, len) != 0)
+        return CborErrorJsonSyntax;
+    in->ptr += len;
+    return CborNoError;
+}
+
+static inline bool is_json_delimiter(int c)
+{
+    return c < 0 || c == ',' || c == ':' || c == '[' || c == ']' || c == '{' || c == '}' ||
+            c == '"' || c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/* Finds the end of the string starting at the current position and sets *len
+ * to the length of its contents, still escaped; the position is not changed */
+static CborError json_scan_string(JsonInput *in, size_t *len, bool *escaped)
+{
+    size_t start = json_offset(in, in->ptr);
+    size_t pos = start + 1;
+    *escaped = false;
+    for (;;) {
+        CborError err = json_find_special(in, &pos);
+        if (err)
+            return err;
+        switch (*json_pointer(in, pos)) {
+        case '"':
+            *len = pos - start - 1;
+            return CborNoError;
+
+        case '\\':
+            *escaped = true;
+            pos += 2;
+            break;
+
+        default:
+            return CborErrorJsonSyntax;     /* control characters must be escaped */
+        }
+    }
+}
+
+static int hex_digit_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/* decodes the four hex digits of a \u escape sequence */
+static int32_t json_unescape_hex(const char *p)
+{
+    int32_t value = 0;
+    int i;
+    for (i = 0; i < 4; ++i) {
+        int digit = hex_digit_value(p[i]);
+        if (digit < 0)
+            return -1;
+        value = value << 4 | digit;
+    }
+    return value;
+}
+
+static char *write_utf8(char *out, uint32_t uc)
+{
+    if (uc < 0x80) {
+        *out++ = (char)uc;
+    } else if (uc < 0x800) {
+        *out++ = (char)(0xc0 | (uc >> 6));
+        *out++ = (char)(0x80 | (uc & 0x3f));
+    } else if (uc < 0x10000) {
+        *out++ = (char)(0xe0 | (uc >> 12));
+        *out++ = (char)(0x80 | ((uc >> 6) & 0x3f));
+        *out++ = (char)(0x80 | (uc & 0x3f));
+    } else {
+        *out++ = (char)(0xf0 | (uc >> 18));
+        *out++ = (char)(0x80 | ((uc >> 12) & 0x3f));
+        *out++ = (char)(0x80 | ((uc >> 6) & 0x3f));
+        *out++ = (char)(0x80 | (uc & 0x3f));
+    }
+    return out;
+}
+
+/* Decodes the escape sequences in the \a len characters at \a str into the
+ * scratch buffer. No escape sequence is shorter than what it decodes to, so
+ * \a len bytes are enough. */
+static CborError json_unescape(JsonInput *in, const char *str, size_t len)
+{
+    const char *end = str + len;
+    char *out;
+    CborError err;
+
+    in->scratch.size = 0;
+    err = cbor_growable_buffer_reserve(&in->scratch, len);
+    if (err)
+        return err;
+    out = (char *)in->scratch.data;
+
+    while (str != end) {
+        const char *backslash = (const char *)memchr(str, '\\', (size_t)(end - str));
+        size_t n = (backslash ? backslash : end) - str;
+        memcpy(out, str, n);
+        out += n;
+        str += n;
+        if (str == end)
+            break;
+
+        /* json_scan_string() made sure there's a character after the backslash */
+        str += 2;
+        switch (str[-1]) {
+        case '"':
+        case '\\':
+        case '/':
+            *out++ = str[-1];
+            continue;
+        case 'b':
+            *out++ = '\b';
+            continue;
+        case 'f':
+            *out++ = '\f';
+            continue;
+        case 'n':
+            *out++ = '\n';
+            continue;
+        case 'r':
+            *out++ = '\r';
+            continue;
+        case 't':
+            *out++ = '\t';
+            continue;
+        case 'u':
+            break;
+        default:
+            return CborErrorJsonSyntax;
+        }
+
+        int32_t uc = end - str >= 4 ? json_unescape_hex(str) : -1;
+        if (uc < 0)
+            return CborErrorJsonSyntax;
+        str += 4;
+        if (uc >= 0xd800 && uc < 0xe000) {
+            /* UTF-16 surrogate pair: there must be a low surrogate next */
+            int32_t low = uc < 0xdc00 && end - str >= 6 && str[0] == '\\' && str[1] == 'u' ?
+                        json_unescape_hex(str + 2) : -1;
+            if (low < 0xdc00 || low >= 0xe000)
+                return CborErrorInvalidUtf8TextString;
+            uc = 0x10000 + ((uc - 0xd800) << 10) + (low - 0xdc00);
+            str += 6;
+        }
+        out = write_utf8(out, (uint32_t)uc);
+    }
+
+    in->scratch.size = (size_t)(out - (char *)in->scratch.data);
+    return CborNoError;
+}
+
+/* Reads the string at the current position and sets *str to its decoded
+ * contents, which are valid until the next read: they are either in the input
+ * window or, if there were escape sequences, in the scratch buffer */
+static CborError json_read_string(JsonInput *in, const char **str, size_t *len)
+{
+    bool escaped;
+    CborError err = json_scan_string(in, len, &escaped);
+    if (err)
+        return err;
+
+    *str = in->ptr + 1;
+    in->ptr += *len + 2;
+    if (escaped) {
+        err = json_unescape(in, *str, *len);
+        if (err)
+            return err;
+        *str = (const char *)in->scratch.data;
+        *len = in->scratch.size;
+    }
+    if (!is_valid_utf8((const uint8_t *)*str, *len))
+        return CborErrorInvalidUtf8TextString;
+    return CborNoError;
+}
+
+/* Reads the number at the current position, which must follow the JSON
+ * grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
+static CborError json_read_number(JsonInput *in, JsonNumber *number)
+{
+    CborError err = CborNoError;
+    size_t i = 0;
+    size_t dot = 0;
+    int c = json_char_at(in, 0, &err);
+
+    number->integer = 0;
+    number->isInteger = true;
+    number->negative = c == '-';
+    if (number->negative)
+        c = json_char_at(in, ++i, &err);
+
+    if (c == '0') {
+        c = json_char_at(in, ++i, &err);
+    } else if (c >= '1' && c <= '9') {
+        do {
+            unsigned digit = (unsigned)(c - '0');
+            if (number->integer > (UINT64_MAX - digit) / 10)
+                number->isInteger = false;
+            number->integer = number->integer * 10 + digit;
+            c = json_char_at(in, ++i, &err);
+        } while (c >= '0' && c <= '9');
+    } else {
+        return err ? err : c < 0 ? CborErrorUnexpectedEOF : CborErrorJsonSyntax;
+    }
+
+    if (c == '.') {
+        number->isInteger = false;
+        dot = i;
+        c = json_char_at(in, ++i, &err);
+        if (c < '0' || c > '9')
+            return err ? err : CborErrorJsonSyntax;
+        do {
+            c = json_char_at(in, ++i, &err);
+        } while (c >= '0' && c <= '9');
+    }
+    if (c == 'e' || c == 'E') {
+        number->isInteger = false;
+        c = json_char_at(in, ++i, &err);
+        if (c == '+' || c == '-')
+            c = json_char_at(in, ++i, &err);
+        if (c < '0' || c > '9')
+            return err ? err : CborErrorJsonSyntax;
+        do {
+            c = json_char_at(in, ++i, &err);
+        } while (c >= '0' && c <= '9');
+    }
+    if (err)
+        return err;
+    if (!is_json_delimiter(c))
+        return CborErrorJsonSyntax;
+
+    if (number->isInteger) {
+        number->value = (double)number->integer;
+        if (number->negative)
+            number->value = -number->value;
+    } else {
+        /* strtod() needs a terminating NUL, and it expects the decimal
+         * point of the current locale, which isn't always '.' */
+        const char *decimalPoint = localeconv()->decimal_point;
+        size_t pointLen = strlen(decimalPoint);
+        size_t size = i + pointLen + 1;
+        char buffer[JsonMaxNumberSize];
+        char *copy = buffer;
+        if (size > sizeof(buffer)) {
+            in->scratch.size = 0;
+            err = cbor_growable_buffer_reserve(&in->scratch, size);
+            if (err)
+                return err;
+            copy = (char *)in->scratch.data;
+        }
+        if (dot) {
+            memcpy(copy, in->ptr, dot);
+            memcpy(copy + dot, decimalPoint, pointLen);
+            memcpy(copy + dot + pointLen, in->ptr + dot + 1, i - dot - 1);
+            copy[i - 1 + pointLen] = '\0';
+        } else {
+            memcpy(copy, in->ptr, i);
+            copy[i] = '\0';
+        }
+        number->value = strtod(copy, NULL);
+    }
+    in->ptr += i;
+    return CborNoError;
+}
+
+/* Errors other than running out of buffer stop the conversion */
+static inline CborError encoder_status(JsonInput *in, CborError err)
+{
+    if (err == CborErrorOutOfMemory) {
+        in->outOfMemory = true;
+        return CborNoError;
+    }
+    return err;
+}
+
+static CborError number_to_cbor(JsonInput *in, CborEncoder *encoder, const JsonNumber *number)
+{
+    CborError err;
+    double value = number->value;
+    if (number->isInteger) {
+        if (!number->negative || number->integer == 0)
+            err = cbor_encode_uint(encoder, number->integer);
+        else
+            err = cbor_encode_negative_int(encoder, number->integer);
+    } else if (value >= -9223372036854775808.0 && value < 9223372036854775808.0 &&
+               (double)(int64_t)value == value && (value != 0 || !signbit(value))) {
+        err = cbor_encode_int(encoder, (int64_t)value);
+    } else {
+        err = cbor_encode_double(encoder, value);
+    }
+    return encoder_status(in, err);
+}
+
+/* Skips over the value at the current position. This only matches brackets,
+ * as the conversion will check the syntax when it reads the value again. */
+static CborError json_skip_value(JsonInput *in)
+{
+    size_t depth = 0;
+    do {
+        CborError err;
+        size_t len;
+        bool escaped;
+        char c;
+        int next;
+
+        err = json_peek(in, &c);
+        if (err)
+            return err;
+        switch (c) {
+        case '[':
+        case '{':
+            ++depth;
+            ++in->ptr;
+            continue;
+
+        case ']':
+        case '}':
+            if (!depth)
+                return CborErrorJsonSyntax;
+            --depth;
+            ++in->ptr;
+            break;
+
+        case ',':
+        case ':':
+            if (!depth)
+                return CborErrorJsonSyntax;
+            ++in->ptr;
+            continue;
+
+        case '"':
+            err = json_scan_string(in, &len, &escaped);
+            if (err)
+                return err;
+            in->ptr += len + 2;
+            break;
+
+        default:
+            /* number or literal */
+            len = 1;
+            while (next = json_char_at(in, len, &err), !is_json_delimiter(next))
+                ++len;
+            if (err)
+                return err;
+            in->ptr += len;
+            break;
+        }
+    } while (depth);
+    return CborNoError;
+}
+
+static CborError json_discard_value(JsonInput *in, int nestingLevel)
+{
+    CborEncoder discard;
+    cbor_encoder_init_counting(&discard);
+    return value_to_cbor(in, &discard, nestingLevel);
+}
+
+static bool parse_uint64(const char *str, int base, uint64_t *result)
+{
+    *result = 0;
+    if (!*str)
+        return false;
+    for ( ; *str; ++str) {
+        int digit = hex_digit_value(*str);
+        if (digit < 0 || digit >= base || *result > (UINT64_MAX - (unsigned)digit) / (unsigned)base)
+            return false;
+        *result = *result * (unsigned)base + (unsigned)digit;
+    }
+    return true;
+}
+
+/* Reads a string that is part of the metadata into \a buffer */
+static CborError read_metadata_string(JsonInput *in, char *buffer, size_t size)
+{
+    const char *str;
+    size_t len;
+    char c;
+    CborError err = json_peek(in, &c);
+    if (!err && c != '"')
+        err = CborErrorJsonInvalidMetadata;
+    if (!err)
+        err = json_read_string(in, &str, &len);
+    if (!err && len >= size)
+        err = CborErrorJsonInvalidMetadata;
+    if (err)
+        return err;
+    memcpy(buffer, str, len);
+    buffer[len] = '\0';
+    return CborNoError;
+}
+
+/* Reads a number that is part of the metadata; only small integers are used */
+static CborError read_metadata_number(JsonInput *in, uint64_t *value)
+{
+    JsonNumber number;
+    CborError err = json_read_number(in, &number);
+    if (err)
+        return err == CborErrorJsonSyntax ? CborErrorJsonInvalidMetadata : err;
+    if (!number.isInteger || number.negative || number.integer > 0xff)
+        return CborErrorJsonInvalidMetadata;
+    *value = number.integer;
+    return CborNoError;
+}
+
+/* Parses the metadata object: {"tag":"nnn","t":nnn,"v":...}, as written by
+ * add_value_metadata() in cbortojson.c */
+static CborError parse_metadata(JsonInput *in, JsonMetadata *md)
+{
+    CborError err = json_expect(in, '{');
+    char c;
+    if (err)
+        return err == CborErrorJsonSyntax ? CborErrorJsonInvalidMetadata : err;
+    err = json_peek(in, &c);
+    if (!err && c == '}') {
+        ++in->ptr;
+        return CborNoError;
+    }
+
+    while (!err) {
+        char name[4];
+        char tag[JsonMaxMetadataValueSize];
+        uint64_t value;
+
+        err = read_metadata_string(in, name, sizeof(name));
+        if (err == CborErrorJsonInvalidMetadata)
+            name[0] = '\0';         /* some other member, ignore it */
+        else if (err)
+            return err;
+        err = json_expect(in, ':');
+        if (!err)
+            err = json_peek(in, &c);
+        if (err)
+            return err;
+
+        if (strcmp(name, "tag") == 0) {
+            err = read_metadata_string(in, tag, sizeof(tag));
+            if (!err && !parse_uint64(tag, 10, &md->tag))
+                err = CborErrorJsonInvalidMetadata;
+            md->tagged = true;
+        } else if (strcmp(name, "t") == 0) {
+            err = read_metadata_number(in, &value);
+            if (!err)
+                md->type = (int)value;
+        } else if (strcmp(name, "v") == 0) {
+            if (c == '"') {
+                err = read_metadata_string(in, md->value, sizeof(md->value));
+            } else {
+                err = read_metadata_number(in, &md->simpleType);
+                md->hasSimpleType = true;
+            }
+        } else {
+            err = json_skip_value(in);
+        }
+
+        if (!err)
+            err = json_peek(in, &c);
+        if (!err && c == '}') {
+            ++in->ptr;
+            return CborNoError;
+        }
+        if (!err && c != ',')
+            err = CborErrorJsonSyntax;
+        if (!err)
+            ++in->ptr;
+    }
+    return err;
+}
+
+/* Looks for the metadata of the value at the current position, which
+ * cbor_value_to_json_advance() writes as the next member of the object, named
+ * after the current member with "$cbor" appended. The position is restored
+ * afterwards and *skip is set to the number of characters between the end of
+ * the value and the end of the metadata. */
+static CborError find_metadata(JsonInput *in, JsonMetadata *md, size_t *skip)
+{
+    const char *str;
+    size_t len, valueEnd;
+    char c;
+    CborError err;
+
+    memset(md, 0, sizeof(*md));
+    md->type = CborInvalidType;
+    *skip = 0;
+
+    in->mark = in->ptr;
+    err = json_skip_value(in);
+    valueEnd = (size_t)(in->ptr - in->mark);
+    if (!err)
+        err = json_expect(in, ',');
+    if (!err)
+        err = json_peek(in, &c);
+    if (!err && c == '"')
+        err = json_read_string(in, &str, &len);
+    if (!err && c == '"' && len == in->key.size + METADATA_SUFFIX_LENGTH &&
+            memcmp(str, in->key.data, in->key.size) == 0 &&
+            memcmp(str + in->key.size, metadataSuffix, METADATA_SUFFIX_LENGTH) == 0) {
+        err = json_expect(in, ':');
+        if (!err)
+            err = parse_metadata(in, md);
+        if (!err)
+            *skip = (size_t)(in->ptr - in->mark) - valueEnd;
+    } else if (err == CborErrorJsonSyntax || err == CborErrorUnexpectedEOF ||
+               err == CborErrorInvalidUtf8TextString) {
+        /* no metadata; the conversion will report any errors in the value */
+        err = CborNoError;
+    }
+
+    in->ptr = in->mark;
+    in->mark = NULL;
+    return err;
+}
+
+static const int8_t base64Values[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, 62, -1, 63,     /* '+', '-' and '/' */
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, 63,     /* '_' */
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/* Decodes Base64 or Base64url, with or without padding, into \a out, which
+ * may be the same as \a in. Returns the decoded length or -1 on error. */
+static ptrdiff_t decode_base64(uint8_t *out, const char *in, size_t len)
+{
+    uint8_t *start = out;
+    const uint8_t *ptr = (const uint8_t *)in;
+    const uint8_t *end;
+    if (len % 4 == 0 && len && in[len - 1] == '=')
+        len -= in[len - 2] == '=' ? 2 : 1;
+    if (len % 4 == 1)
+        return -1;
+
+    end = ptr + len;
+    while (ptr != end) {
+        size_t n = end - ptr < 4 ? (size_t)(end - ptr) : 4;
+        uint_least32_t val = 0;
+        size_t i;
+        for (i = 0; i < 4; ++i) {
+            int8_t digit = i < n ? base64Values[ptr[i]] : 0;
+            if (digit < 0)
+                return -1;
+            val = (val << 6) | (uint_least32_t)digit;
+        }
+        ptr += n;
+
+        /* four characters make three bytes, three make two and two, one */
+        *out++ = (uint8_t)(val >> 16);
+        if (n > 2)
+            *out++ = (uint8_t)(val >> 8);
+        if (n > 3)
+            *out++ = (uint8_t)val;
+    }
+    return out - start;
+}
+
+/* Decodes Base16 into \a out, which may be the same as \a in. Returns the
+ * decoded length or -1 on error. */
+static ptrdiff_t decode_base16(uint8_t *out, const char *in, size_t len)
+{
+    size_t i;
+    if (len % 2)
+        return -1;
+    for (i = 0; i < len; i += 2) {
+        int high = hex_digit_value(in[i]);
+        int low = hex_digit_value(in[i + 1]);
+        if (high < 0 || low < 0)
+            return -1;
+        out[i / 2] = (uint8_t)(high << 4 | low);
+    }
+    return (ptrdiff_t)(len / 2);
+}
+
+static CborError byte_string_to_cbor(JsonInput *in, CborEncoder *encoder, const JsonMetadata *md)
+{
+    const char *str;
+    size_t len;
+    ptrdiff_t decoded;
+    uint8_t *out;
+    char c;
+    CborError err = json_peek(in, &c);
+    if (!err && c != '"')
+        err = CborErrorJsonInvalidMetadata;
+    if (!err)
+        err = json_read_string(in, &str, &len);
+    if (err)
+        return err;
+
+    /* decode in place if the string is already in the scratch buffer */
+    if (str != (const char *)in->scratch.data) {
+        /* reserve at least one byte so that out is not null for empty strings */
+        in->scratch.size = 0;
+        err = cbor_growable_buffer_reserve(&in->scratch, len + 1);
+        if (err)
+            return err;
+    }
+    out = in->scratch.data;
+
+    if (md->tagged && md->tag == CborExpectedBase16Tag) {
+        decoded = decode_base16(out, str, len);
+    } else {
+        /* negative bignums are prefixed with a tilde */
+        if (md->tagged && md->tag == CborNegativeBignumTag && len && *str == '~') {
+            ++str;
+            --len;
+        }
+        decoded = decode_base64(out, str, len);
+    }
+    if (decoded < 0)
+        return CborErrorJsonInvalidMetadata;
+    return encoder_status(in, cbor_encode_byte_string(encoder, out, (size_t)decoded));
+}
+
+static CborError floating_point_to_cbor(JsonInput *in, CborEncoder *encoder, const JsonMetadata *md,
+                                        int nestingLevel)
+{
+    CborError err;
+    double value;
+    if (md->value[0]) {
+        /* the JSON value is null */
+        if (strcmp(md->value, "nan") == 0)
+            value = NAN;
+        else if (strcmp(md->value, "inf") == 0)
+            value = INFINITY;
+        else if (strcmp(md->value, "-inf") == 0)
+            value = -INFINITY;
+        else
+            return CborErrorJsonInvalidMetadata;
+        err = json_discard_value(in, nestingLevel);
+    } else {
+        JsonNumber number;
+        char c;
+        err = json_peek(in, &c);
+        if (!err && c != '-' && (c < '0' || c > '9'))
+            err = CborErrorJsonInvalidMetadata;
+        if (!err)
+            err = json_read_number(in, &number);
+        if (err)
+            return err;
+        value = number.value;
+    }
+    if (err)
+        return err;
+
+    if (md->type == CborHalfFloatType) {
+        uint16_t half = encode_half(value);
+        err = cbor_encode_half_float(encoder, &half);
+    } else if (md->type == CborFloatType) {
+        err = cbor_encode_float(encoder, (float)value);
+    } else {
+        err = cbor_encode_double(encoder, value);
+    }
+    return encoder_status(in, err);
+}
+
+/* Converts the value at the current position, restoring the tag and type
+ * described by its metadata */
+static CborError metadata_value_to_cbor(JsonInput *in, CborEncoder *encoder, const JsonMetadata *md,
+                                        int nestingLevel)
+{
+    CborError err = CborNoError;
+    uint64_t value;
+    if (md->tagged) {
+        err = encoder_status(in, cbor_encode_tag(encoder, md->tag));
+        if (err)
+            return err;
+    }
+
+    switch (md->type) {
+    case CborIntegerType:
+        /* integer that has more than 53 bits of precision: "v" has the sign
+         * and the raw CBOR value in hex (for negatives, that is -1 - n) */
+        if ((md->value[0] != '+' && md->value[0] != '-') || !parse_uint64(md->value + 1, 16, &value))
+            return CborErrorJsonInvalidMetadata;
+        err = json_discard_value(in, nestingLevel);
+        if (err)
+            return err;
+        err = md->value[0] == '+' ? cbor_encode_uint(encoder, value) : cbor_encode_negative_int(encoder, value + 1);
+        return encoder_status(in, err);
+
+    case CborByteStringType:
+        return byte_string_to_cbor(in, encoder, md);
+
+    case CborSimpleType:
+        if (!md->hasSimpleType)
+            return CborErrorJsonInvalidMetadata;
+        err = json_discard_value(in, nestingLevel);
+        if (!err)
+            err = encoder_status(in, cbor_encode_simple_value(encoder, (uint8_t)md->simpleType));
+        return err;
+
+    case CborUndefinedType:
+        err = json_discard_value(in, nestingLevel);
+        if (!err)
+            err = encoder_status(in, cbor_encode_undefined(encoder));
+        return err;
+
+    case CborHalfFloatType:
+    case CborFloatType:
+    case CborDoubleType:
+        return floating_point_to_cbor(in, encoder, md, nestingLevel);
+
+    default:
+        /* only a tag, or a type that needs no conversion */
+        return value_to_cbor(in, encoder, nestingLevel);
+    }
+}
+
+static CborError array_to_cbor(JsonInput *in, CborEncoder *encoder, int nestingLevel)
+{
+    CborEncoder array;
+    size_t length;
+    char c;
+    CborError err = json_container_length(in, &length);
+    if (err)
+        return err;
+
+    ++in->ptr;      /* '[' */
+    err = encoder_status(in, cbor_encoder_create_array(encoder, &array, length));
+    if (!err)
+        err = json_peek(in, &c);
+    if (!err && c != ']') {
+        for (;;) {
+            err = value_to_cbor(in, &array, nestingLevel - 1);
+            if (!err)
+                err = json_peek(in, &c);
+            if (err || c != ',')
+                break;
+            ++in->ptr;
+        }
+    }
+    if (err)
+        return err;
+    if (c != ']')
+        return CborErrorJsonSyntax;
+    ++in->ptr;
+    return encoder_status(in, cbor_encoder_close_container(encoder, &array));
+}
+
+static CborError map_member_to_cbor(JsonInput *in, CborEncoder *map, int nestingLevel)
+{
+    JsonMetadata md;
+    const char *key;
+    size_t keyLength, skip;
+    CborError err = json_read_string(in, &key, &keyLength);
+    if (err)
+        return err;
+
+    if (in->flags & CborConvertReadMetadata) {
+        if (keyLength > METADATA_SUFFIX_LENGTH &&
+                memcmp(key + keyLength - METADATA_SUFFIX_LENGTH, metadataSuffix, METADATA_SUFFIX_LENGTH) == 0) {
+            /* metadata that isn't next to its value: drop it */
+            err = json_expect(in, ':');
+            if (!err)
+                err = json_discard_value(in, nestingLevel - 1);
+            return err;
+        }
+
+        /* keep a copy to compare with the next member's name (reserving at
+         * least one byte, so the copy isn't made to null for an empty one) */
+        in->key.size = 0;
+        err = cbor_growable_buffer_reserve(&in->key, keyLength + 1);
+        if (err)
+            return err;
+        memcpy(in->key.data, key, keyLength);
+        in->key.size = keyLength;
+    }
+
+    err = encoder_status(in, cbor_encode_text_string(map, key, keyLength));
+    if (!err)
+        err = json_expect(in, ':');
+    if (err)
+        return err;
+
+    if (!(in->flags & CborConvertReadMetadata))
+        return value_to_cbor(in, map, nestingLevel - 1);
+
+    err = find_metadata(in, &md, &skip);
+    if (!err)
+        err = metadata_value_to_cbor(in, map, &md, nestingLevel - 1);
+    if (!err && skip)
+        err = json_skip(in, skip);
+    return err;
+}
+
+static CborError map_to_cbor(JsonInput *in, CborEncoder *encoder, int nestingLevel)
+{
+    CborEncoder map;
+    size_t length;
+    char c;
+    CborError err = json_container_length(in, &length);
+    if (err)
+        return err;
+
+    ++in->ptr;      /* '{' */
+    err = encoder_status(in, cbor_encoder_create_map(encoder, &map, length));
+    if (!err)
+        err = json_peek(in, &c);
+    if (!err && c != '}') {
+        for (;;) {
+            if (c != '"')
+                return CborErrorJsonSyntax;
+            err = map_member_to_cbor(in, &map, nestingLevel);
+            if (!err)
+                err = json_peek(in, &c);
+            if (err || c != ',')
+                break;
+            ++in->ptr;
+            err = json_peek(in, &c);
+            if (err)
+                break;
+        }
+    }
+    if (err)
+        return err;
+    if (c != '}')
+        return CborErrorJsonSyntax;
+    ++in->ptr;
+    return encoder_status(in, cbor_encoder_close_container(encoder, &map));
+}
+
+static CborError value_to_cbor(JsonInput *in, CborEncoder *encoder, int nestingLevel)
+{
+    JsonNumber number;
+    const char *str;
+    size_t len;
+    char c;
+    CborError err;
+
+    if (!nestingLevel)
+        return CborErrorNestingTooDeep;
+
+    err = json_peek(in, &c);
+    if (err)
+        return err;
+    switch (c) {
+    case '[':
+        return array_to_cbor(in, encoder, nestingLevel);
+
+    case '{':
+        return map_to_cbor(in, encoder, nestingLevel);
+
+    case '"':
+        err = json_read_string(in, &str, &len);
+        if (!err)
+            err = encoder_status(in, cbor_encode_text_string(encoder, str, len));
+        return err;
+
+    case 't':
+        err = json_expect_literal(in, "true", 4);
+        if (!err)
+            err = encoder_status(in, cbor_encode_boolean(encoder, true));
+        return err;
+
+    case 'f':
+        err = json_expect_literal(in, "false", 5);
+        if (!err)
+            err = encoder_status(in, cbor_encode_boolean(encoder, false));
+        return err;
+
+    case 'n':
+        err = json_expect_literal(in, "null", 4);
+        if (!err)
+            err = encoder_status(in, cbor_encode_null(encoder));
+        return err;
+
+    default:
+        err = json_read_number(in, &number);
+        if (!err)
+            err = number_to_cbor(in, encoder, &number);
+        return err;
+    }
+}
+
+static CborError json_to_cbor(JsonInput *in, CborEncoder *encoder, int flags)
+{
+    char c;
+    CborError err;
+
+    in->mark = NULL;
+    in->flags = flags;
+    in->outOfMemory = false;
+    cbor_growable_buffer_init(&in->window, NULL, 0);
+    cbor_growable_buffer_init(&in->scratch, NULL, 0);
+    cbor_growable_buffer_init(&in->key, NULL, 0);
+
+    memset(&in->index, 0, sizeof(in->index));
+    cbor_growable_buffer_init(&in->index.specials, NULL, 0);
+    cbor_growable_buffer_init(&in->index.containers, NULL, 0);
+    cbor_growable_buffer_init(&in->index.levels, NULL, 0);
+
+    /* the top level */
+    err = cbor_growable_buffer_reserve(&in->index.levels, sizeof(JsonScanLevel));
+    if (!err) {
+        memset(in->index.levels.data, 0, sizeof(JsonScanLevel));
+        in->index.levels.size = sizeof(JsonScanLevel);
+        err = value_to_cbor(in, encoder, CBOR_PARSER_MAX_RECURSIONS);
+    }
+    if (!err) {
+        /* only whitespace may follow */
+        err = json_peek(in, &c);
+        if (err == CborErrorUnexpectedEOF)
+            err = in->outOfMemory ? CborErrorOutOfMemory : CborNoError;
+        else if (!err)
+            err = CborErrorGarbageAtEnd;
+    }
+
+    cbor_growable_buffer_free(&in->window);
+    cbor_growable_buffer_free(&in->scratch);
+    cbor_growable_buffer_free(&in->key);
+    cbor_growable_buffer_free(&in->index.specials);
+    cbor_growable_buffer_free(&in->index.containers);
+    cbor_growable_buffer_free(&in->index.levels);
+    return err;
+}
+
+/**
+ * Reads one JSON value from the C standard library stream \a in and encodes
+ * the equivalent CBOR data item with \a encoder. The \a flags parameter
+ * indicates one or more of the flags from CborFromJsonFlags.
+ *
+ * The stream is read in blocks until its end, since nothing but whitespace
+ * may follow the JSON value, and only the part of it that is still needed is
+ * kept in memory. See \ref CborFromJson for the details of the conversion and
+ * the errors this function may return.
+ *
+ * \sa cbor_encode_from_json_buffer(), cbor_encoder_init_buffered_writer()
+ */
+CborError cbor_encode_from_json(CborEncoder *encoder, FILE *in, int flags)
+{
+    JsonInput input;
+    input.ptr = input.end = input.base = NULL;
+    input.origin = 0;
+    input.file = in;
+    return json_to_cbor(&input, encoder, flags);
+}
+
+/**
+ * Reads one JSON value from the \a size bytes of text at \a json and encodes
+ * the equivalent CBOR data item with \a encoder. The text does not need to be
+ * terminated by a NUL. The \a flags parameter indicates one or more of the
+ * flags from CborFromJsonFlags.
+ *
+ * Strings without escape sequences are encoded straight from \a json. See
+ * \ref CborFromJson for the details of the conversion and the errors this
+ * function may return.
+ *
+ * \sa cbor_encode_from_json()
+ */
+CborError cbor_encode_from_json_buffer(CborEncoder *encoder, const char *json, size_t size, int flags)
+{
+    JsonInput input;
+    input.ptr = input.base = json;
+    input.end = json + size;
+    input.origin = 0;
+    input.file = NULL;
+    return json_to_cbor(&input, encoder, flags);
+}
+
+/** @} */
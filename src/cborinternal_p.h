@@ -188,6 +188,12 @@ enum {
     BreakByte               = (unsigned)Break | (SimpleTypesType << MajorTypeShift)
 };
 
+/* used to pick the RFC 8746 typed array tags matching the host byte order */
+static inline bool is_little_endian_host(void)
+{
+    return cbor_ntohs(1) != 1;
+}
+
 static inline void copy_current_position(CborValue *dst, const CborValue *src)
 {
     /* This "if" is here for pedantry only: the two branches should perform
@@ -198,6 +204,14 @@ static inline void copy_current_position(CborValue *dst, const CborValue *src)
         dst->source.ptr = src->source.ptr;
 }
 
+static inline bool uses_linear_buffer(const CborValue *it)
+{
+    /* true if it->source.ptr and it->parser->source.end are valid */
+    if (CBOR_PARSER_READER_CONTROL >= 0)
+        return CBOR_PARSER_READER_CONTROL == 0 && !(it->parser->flags & CborParserFlag_ExternalSource);
+    return true;
+}
+
 static inline bool can_read_bytes(const CborValue *it, size_t n)
 {
     if (CBOR_PARSER_READER_CONTROL >= 0) {
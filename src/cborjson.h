@@ -54,6 +54,24 @@ CBOR_INLINE_API CborError cbor_value_to_json(FILE *out, const CborValue *value,
     return cbor_value_to_json_advance(out, &copy, flags);
 }
 
+CBOR_API CborError cbor_value_to_json_buffer_advance(CborGrowableBuffer *buffer, CborValue *value, int flags);
+CBOR_INLINE_API CborError cbor_value_to_json_buffer(CborGrowableBuffer *buffer, const CborValue *value, int flags)
+{
+    CborValue copy = *value;
+    return cbor_value_to_json_buffer_advance(buffer, &copy, flags);
+}
+
+/* Conversion from JSON */
+enum CborFromJsonFlags
+{
+    CborConvertReadMetadata = 1,
+
+    CborConvertFromJsonDefaultFlags = 0
+};
+
+CBOR_API CborError cbor_encode_from_json(CborEncoder *encoder, FILE *in, int flags);
+CBOR_API CborError cbor_encode_from_json_buffer(CborEncoder *encoder, const char *json, size_t size, int flags);
+
 #ifdef __cplusplus
 }
 #endif
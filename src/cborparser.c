@@ -39,6 +39,12 @@
 
 #include <string.h>
 
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
 /**
  * \defgroup CborParsing Parsing CBOR streams
  * \brief Group of functions used to parse CBOR streams.
@@ -365,6 +371,21 @@ CborError cbor_parser_init_reader(const struct CborParserOperations *ops, CborPa
     return preparse_value(it);
 }
 
+/**
+ * \fn void cbor_parser_set_allocator(CborParser *parser, const CborAllocator *allocator)
+ *
+ * Makes the functions that allocate memory while decoding from \a parser,
+ * such as cbor_value_dup_text_string(), cbor_value_dup_byte_string() and
+ * cbor_value_to_json(), obtain it from \a allocator instead of \c malloc. Pass
+ * null to restore the default. The allocator must remain valid for as long as
+ * the parser is in use.
+ *
+ * Combined with a CborArena, this allows decoding a document without any
+ * calls to \c malloc and releasing all the memory at once afterwards.
+ *
+ * \sa cbor_parser_init(), cbor_arena_init()
+ */
+
 /**
  * \fn bool cbor_value_at_end(const CborValue *it)
  *
@@ -469,6 +490,97 @@ CborError cbor_value_advance_fixed(CborValue *it)
     return advance_internal(it);
 }
 
+static bool is_small_scalar(uint8_t byte)
+{
+    /* unsigned and negative integers and simple values whose value is in the
+     * descriptor byte: 0x00-0x17, 0x20-0x37 and 0xe0-0xf7 */
+    uint8_t majortype = byte >> MajorTypeShift;
+    return (byte & SmallValueMask) < Value8Bit &&
+            (majortype == UnsignedIntegerType || majortype == NegativeIntegerType ||
+             majortype == SimpleTypesType);
+}
+
+#if defined(__SSE2__)
+static unsigned small_scalar_mask_sse2(__m128i data)
+{
+    /* bit n is set if byte n is a small scalar (see is_small_scalar) */
+    __m128i value = _mm_and_si128(data, _mm_set1_epi8(SmallValueMask));
+    __m128i majortype = _mm_and_si128(data, _mm_set1_epi8((char)MajorTypeMask));
+    __m128i mask = _mm_or_si128(_mm_cmpeq_epi8(majortype, _mm_setzero_si128()),
+                                _mm_cmpeq_epi8(majortype, _mm_set1_epi8(NegativeIntegerType << MajorTypeShift)));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(majortype, _mm_set1_epi8((char)(SimpleTypesType << MajorTypeShift))));
+    mask = _mm_and_si128(mask, _mm_cmplt_epi8(value, _mm_set1_epi8(Value8Bit)));
+    return (unsigned)_mm_movemask_epi8(mask);
+}
+#endif
+
+#if defined(__AVX2__)
+static uint32_t small_scalar_mask_avx2(__m256i data)
+{
+    __m256i value = _mm256_and_si256(data, _mm256_set1_epi8(SmallValueMask));
+    __m256i majortype = _mm256_and_si256(data, _mm256_set1_epi8((char)MajorTypeMask));
+    __m256i mask = _mm256_or_si256(_mm256_cmpeq_epi8(majortype, _mm256_setzero_si256()),
+                                   _mm256_cmpeq_epi8(majortype, _mm256_set1_epi8(NegativeIntegerType << MajorTypeShift)));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(majortype, _mm256_set1_epi8((char)(SimpleTypesType << MajorTypeShift))));
+    mask = _mm256_and_si256(mask, _mm256_cmpgt_epi8(_mm256_set1_epi8(Value8Bit), value));
+    return (uint32_t)_mm256_movemask_epi8(mask);
+}
+#endif
+
+/* Returns the number of consecutive small scalar items (one byte each)
+ * starting at \a ptr, without going past \a end. */
+static size_t count_small_scalars(const uint8_t *ptr, const uint8_t *end)
+{
+    const uint8_t *start = ptr;
+#if defined(__AVX2__)
+    while (end - ptr >= 32) {
+        uint32_t mask = small_scalar_mask_avx2(_mm256_loadu_si256((const __m256i *)ptr));
+        if (mask != UINT32_MAX)
+            return (size_t)(ptr - start) + count_trailing_zeros32(~mask);
+        ptr += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    while (end - ptr >= 16) {
+        unsigned mask = small_scalar_mask_sse2(_mm_loadu_si128((const __m128i *)ptr));
+        if (mask != 0xffff)
+            return (size_t)(ptr - start) + count_trailing_zeros32(~mask);
+        ptr += 16;
+    }
+#endif
+    while (ptr != end && is_small_scalar(*ptr))
+        ++ptr;
+    return (size_t)(ptr - start);
+}
+
+/* Advances \a it, which points to a small scalar inside a container, past it
+ * and all the small scalars that immediately follow it in the same container,
+ * in one step. */
+static CborError skip_small_scalars(CborValue *it)
+{
+    size_t n = count_small_scalars(it->source.ptr, it->parser->source.end);
+    cbor_assert(n > 0);
+
+    if (it->remaining != UINT32_MAX) {
+        if (n > it->remaining)
+            n = it->remaining;
+        it->source.ptr += n;
+        it->remaining -= (uint32_t)n;
+        if (it->remaining == 0) {
+            it->type = CborInvalidType;
+            it->flags &= ~CborIteratorFlag_UnknownLength; /* no Break to consume */
+            return CborNoError;
+        }
+    } else {
+        it->source.ptr += n;
+    }
+
+    /* toggle the flag indicating whether this was a map key for each item skipped */
+    if (n & 1)
+        it->flags ^= CborIteratorFlag_NextIsMapKey;
+    return preparse_next_value_nodecrement(it);
+}
+
 static CborError advance_recursive(CborValue *it, int nestingLevel)
 {
     CborError err;
@@ -490,7 +602,12 @@ static CborError advance_recursive(CborValue *it, int nestingLevel)
     if (err)
         return err;
     while (!cbor_value_at_end(&recursed)) {
-        err = advance_recursive(&recursed, nestingLevel - 1);
+        /* runs of one-byte integers and simple values are common enough in
+         * arrays that it pays to skip them all at once */
+        if (uses_linear_buffer(&recursed) && is_small_scalar(*recursed.source.ptr))
+            err = skip_small_scalars(&recursed);
+        else
+            err = advance_recursive(&recursed, nestingLevel - 1);
         if (err)
             return err;
     }
@@ -1456,6 +1573,137 @@ error:
     return err;
 }
 
+/* Compares the wanted NUL-terminated key \a string with the \a len bytes at
+ * \a key, without calling strlen() on \a string. */
+static bool key_matches(const char *string, const char *key, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; ++i) {
+        if (string[i] != key[i] || string[i] == '\0')
+            return false;
+    }
+    return string[len] == '\0';
+}
+
+/* Advances \a it past the text string key it points to, storing in \a found
+ * the index of the first not yet found entry of \a strings that matches it
+ * (or \a count if none does). */
+static CborError match_key_and_advance(CborValue *it, const char *const *strings, size_t count,
+                                       const CborValue *elements, size_t *found)
+{
+    CborError err;
+    size_t i;
+    *found = count;
+
+    if (cbor_value_is_length_known(it)) {
+        /* common case: a single chunk, so compare in place */
+        const void *ptr;
+        size_t len;
+        err = _cbor_value_begin_string_iteration(it);
+        if (!err)
+            err = get_string_chunk(it, &ptr, &len);
+        if (err)
+            return err;
+        for (i = 0; i < count; ++i) {
+            if (!cbor_value_is_valid(&elements[i]) && key_matches(strings[i], (const char *)ptr, len)) {
+                *found = i;
+                break;
+            }
+        }
+        return _cbor_value_finish_string_iteration(it);
+    }
+
+    for (i = 0; i < count; ++i) {
+        bool equals;
+        size_t len = strlen(strings[i]);
+        if (cbor_value_is_valid(&elements[i]))
+            continue;
+        err = iterate_string_chunks(it, CONST_CAST(char *, strings[i]), &len, &equals, NULL, iterate_memcmp);
+        if (err)
+            return err;
+        if (equals) {
+            *found = i;
+            break;
+        }
+    }
+    return cbor_value_advance(it);
+}
+
+/**
+ * Attempts to find the values in map \a map that correspond to each of the
+ * \a count text string keys in the array \a strings, in a single pass over the
+ * map. The value corresponding to the i-th key in \a strings is stored in the
+ * i-th entry of \a elements; if no item matches that key, then that entry
+ * will contain an element of type \ref CborInvalidType. If the iterator \a
+ * map does not point to a CBOR map, the behaviour is undefined, so checking
+ * with \ref cbor_value_get_type or \ref cbor_value_is_map is recommended.
+ *
+ * This function is equivalent to calling cbor_value_map_find_value() once for
+ * each key, but it iterates over the map only once and stops as soon as all
+ * keys have been found. Each key in the map is decoded once and compared
+ * against the keys that have not been found yet, so this function is well
+ * suited for extracting a known set of fields from each message, with the
+ * keys in a constant table. If the map contains the same key more than once,
+ * the first occurrence is used.
+ *
+ * This function has a time complexity of O(n * m) comparisons for n elements
+ * in the map and m keys, but each map element is decoded and skipped only
+ * once, which dominates in practice. Like cbor_value_map_find_value(), it has
+ * an O(n) memory requirement based on the number of nested containers found as
+ * elements of this map.
+ *
+ * \sa cbor_value_map_find_value(), cbor_value_is_valid()
+ */
+CborError cbor_value_map_find_values(const CborValue *map, const char *const *strings, size_t count,
+                                     CborValue *elements)
+{
+    CborError err;
+    CborValue it;
+    size_t i, missing = count;
+    cbor_assert(cbor_value_is_map(map));
+    for (i = 0; i < count; ++i) {
+        elements[i] = *map;
+        elements[i].type = CborInvalidType;
+    }
+
+    err = cbor_value_enter_container(map, &it);
+    while (!err && missing && !cbor_value_at_end(&it)) {
+        size_t found = count;
+
+        /* find the non-tag so we can compare */
+        err = cbor_value_skip_tag(&it);
+        if (err)
+            break;
+        if (cbor_value_is_text_string(&it))
+            err = match_key_and_advance(&it, strings, count, elements, &found);
+        else
+            err = cbor_value_advance(&it);
+        if (err)
+            break;
+
+        if (found < count) {
+            /* the same key may have been requested more than once */
+            for (i = found; i < count; ++i) {
+                if (i == found || (!cbor_value_is_valid(&elements[i]) && strcmp(strings[i], strings[found]) == 0)) {
+                    elements[i] = it;
+                    --missing;
+                }
+            }
+        }
+
+        /* skip this value */
+        err = cbor_value_skip_tag(&it);
+        if (!err)
+            err = cbor_value_advance(&it);
+    }
+
+    if (err) {
+        for (i = 0; i < count; ++i)
+            elements[i].type = CborInvalidType;
+    }
+    return err;
+}
+
 /**
  * \fn bool cbor_value_is_float(const CborValue *value)
  *
@@ -0,0 +1,664 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE 1
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "cborinternal_p.h"
+#include "compilersupport_p.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+typedef enum ArrayElementType {
+    UInt64Element,
+    Int64Element,
+    UInt32Element,
+    Int32Element,
+    DoubleElement,
+    FloatElement
+} ArrayElementType;
+
+/* Converts the integer whose absolute value (minus one, if negative) is \a v
+ * and stores it in \a slot. */
+static CborError store_integer(ArrayElementType type, uint64_t v, bool negative, void *slot)
+{
+    switch (type) {
+    case UInt64Element:
+        if (negative)
+            return CborErrorDataTooLarge;
+        *(uint64_t *)slot = v;
+        return CborNoError;
+
+    case Int64Element:
+        if (v > (uint64_t)INT64_MAX)
+            return CborErrorDataTooLarge;
+        *(int64_t *)slot = negative ? -(int64_t)v - 1 : (int64_t)v;
+        return CborNoError;
+
+    case UInt32Element:
+        if (negative || v > UINT32_MAX)
+            return CborErrorDataTooLarge;
+        *(uint32_t *)slot = (uint32_t)v;
+        return CborNoError;
+
+    case Int32Element:
+        if (v > (uint64_t)INT32_MAX)
+            return CborErrorDataTooLarge;
+        *(int32_t *)slot = negative ? -(int32_t)v - 1 : (int32_t)v;
+        return CborNoError;
+
+    case DoubleElement:
+    case FloatElement:
+        break;
+    }
+    return CborErrorIllegalType;
+}
+
+#ifndef CBOR_NO_FLOATING_POINT
+/* Converts the floating point value of the encoded size given by \a
+ * descriptor (HalfPrecisionFloat, SinglePrecisionFloat or
+ * DoublePrecisionFloat) whose bits are \a v and stores it in \a slot. */
+static CborError store_floating_point(ArrayElementType type, uint8_t descriptor, uint64_t v, void *slot)
+{
+    double d;
+    float f;
+    uint32_t f32 = (uint32_t)v;
+
+    if (type == FloatElement) {
+        if (descriptor == SinglePrecisionFloat) {
+            memcpy(slot, &f32, sizeof(f32));
+            return CborNoError;
+        }
+    } else if (type == DoubleElement) {
+        if (descriptor == DoublePrecisionFloat) {
+            memcpy(slot, &v, sizeof(v));
+            return CborNoError;
+        }
+    } else {
+        return CborErrorIllegalType;
+    }
+
+    if (descriptor == SinglePrecisionFloat) {
+        memcpy(&f, &f32, sizeof(f));
+        d = f;
+    } else if (descriptor == DoublePrecisionFloat) {
+        memcpy(&d, &v, sizeof(d));
+    } else {
+#ifndef CBOR_NO_HALF_FLOAT_TYPE
+        d = decode_half((unsigned short)v);
+#else
+        return CborErrorIllegalType;
+#endif
+    }
+
+    if (type == DoubleElement) {
+        *(double *)slot = d;
+        return CborNoError;
+    }
+
+    /* narrowing a double to float is only allowed if no precision is lost */
+    f = (float)d;
+    if ((double)f != d && d == d)
+        return CborErrorDataTooLarge;
+    *(float *)slot = f;
+    return CborNoError;
+}
+#endif
+
+static CborError store_element(ArrayElementType type, const CborValue *it, void *slot)
+{
+    uint64_t v;
+    if (cbor_value_is_integer(it)) {
+        cbor_value_get_raw_integer(it, &v);
+        return store_integer(type, v, cbor_value_is_negative_integer(it), slot);
+    }
+
+#ifndef CBOR_NO_FLOATING_POINT
+    if (cbor_value_is_half_float(it)) {
+        uint16_t h;
+        cbor_value_get_half_float(it, &h);
+        return store_floating_point(type, HalfPrecisionFloat, h, slot);
+    }
+    if (cbor_value_is_float(it) || cbor_value_is_double(it)) {
+        v = _cbor_value_decode_int64_internal(it);
+        return store_floating_point(type, cbor_value_is_float(it) ? SinglePrecisionFloat : DoublePrecisionFloat,
+                                    v, slot);
+    }
+#endif
+
+    return CborErrorIllegalType;
+}
+
+/* Decodes as many elements as possible by looking at the buffer directly,
+ * bypassing the generic preparsing of each element. Returns false if it
+ * stopped at an element it could not handle (including a malformed one),
+ * in which case \a it is positioned there and the caller must reparse it. */
+static bool get_array_fast(ArrayElementType type, size_t elementSize, CborValue *it,
+                           void *buffer, size_t capacity, size_t *count, CborError *err)
+{
+    union {
+        uint64_t u64;
+        double d;
+    } scratch;
+    const uint8_t *end = it->parser->source.end;
+    const uint8_t *ptr = it->source.ptr;
+    size_t n = *count;
+    bool wantsFloatingPoint = type >= DoubleElement;
+
+    for ( ; ; ++n) {
+        uint8_t descriptor, majortype;
+        size_t bytesNeeded;
+        uint64_t v;
+        void *slot = n < capacity ? (char *)buffer + n * elementSize : (void *)&scratch;
+
+        if (it->remaining == 0 || ptr == end)
+            break;
+
+        descriptor = *ptr;
+        if (it->remaining == UINT32_MAX && descriptor == (uint8_t)BreakByte)
+            break;
+        majortype = descriptor >> MajorTypeShift;
+        descriptor &= SmallValueMask;
+        if (descriptor > Value64Bit)
+            break;
+        if (wantsFloatingPoint ? majortype != SimpleTypesType : majortype > NegativeIntegerType)
+            break;
+
+        bytesNeeded = descriptor < Value8Bit ? 0 : (size_t)(1 << (descriptor - Value8Bit));
+        if ((size_t)(end - ptr) <= bytesNeeded)
+            break;
+
+        it->source.ptr = ptr;
+        switch (bytesNeeded) {
+        case 0:
+            v = descriptor;
+            break;
+        case 1:
+            v = read_uint8(it, 1);
+            break;
+        case 2:
+            v = read_uint16(it, 1);
+            break;
+        case 4:
+            v = read_uint32(it, 1);
+            break;
+        default:
+            v = read_uint64(it, 1);
+            break;
+        }
+
+#ifndef CBOR_NO_FLOATING_POINT
+        if (majortype == SimpleTypesType) {
+            /* only floating point values get here */
+            if (descriptor < HalfPrecisionFloat)
+                break;
+            *err = store_floating_point(type, descriptor, v, slot);
+        } else
+#endif
+        {
+            *err = store_integer(type, v, majortype == NegativeIntegerType, slot);
+        }
+        if (*err)
+            break;
+
+        ptr += 1 + bytesNeeded;
+        if (it->remaining != UINT32_MAX)
+            --it->remaining;
+    }
+
+    it->source.ptr = ptr;
+    *count = n;
+    if (*err)
+        return true;
+    if (it->remaining == 0) {
+        it->type = CborInvalidType;
+        it->flags &= ~CborIteratorFlag_UnknownLength;
+        return true;
+    }
+    if (it->remaining == UINT32_MAX && ptr != end && *ptr == (uint8_t)BreakByte) {
+        it->type = CborInvalidType;
+        it->remaining = 0;
+        it->flags |= CborIteratorFlag_UnknownLength;
+        return true;
+    }
+    return false;
+}
+
+static CborError get_array(ArrayElementType type, size_t elementSize, const CborValue *value,
+                           void *buffer, size_t *count, CborValue *next)
+{
+    union {
+        uint64_t u64;
+        double d;
+    } scratch;
+    CborError err;
+    CborValue it;
+    size_t capacity = *count;
+    size_t n = 0;
+    cbor_assert(cbor_value_is_array(value));
+
+    err = cbor_value_enter_container(value, &it);
+    if (err)
+        return err;
+
+    if (uses_linear_buffer(&it) && !cbor_value_at_end(&it)) {
+        err = CborNoError;
+        if (!get_array_fast(type, elementSize, &it, buffer, capacity, &n, &err)) {
+            /* let the generic code handle the element we stopped at */
+            it.type = CborInvalidType;
+            err = cbor_value_reparse(&it);
+        }
+        if (err)
+            return err;
+    }
+
+    while (!cbor_value_at_end(&it)) {
+        void *slot = n < capacity ? (char *)buffer + n * elementSize : (void *)&scratch;
+        err = store_element(type, &it, slot);
+        if (!err)
+            err = cbor_value_advance_fixed(&it);
+        if (err)
+            return err;
+        ++n;
+    }
+
+    *count = n;
+    if (next) {
+        *next = *value;
+        err = cbor_value_leave_container(next, &it);
+        if (err)
+            return err;
+    }
+    return n > capacity ? CborErrorOutOfMemory : CborNoError;
+}
+
+/**
+ * Decodes the CBOR array that \a value points to, which must contain only
+ * unsigned integers, into the array of \c uint64_t pointed to by \a buffer.
+ * On entry, \a count must contain the number of elements that \a buffer has
+ * room for; on successful return, it contains the number of elements decoded.
+ * If \a next is not null, it is updated to point to the item that follows the
+ * array.
+ *
+ * This is equivalent to entering the array and calling
+ * cbor_value_get_uint64() and cbor_value_advance_fixed() for each element, but
+ * runs considerably faster when the parser reads from a linear buffer.
+ *
+ * If an element is not an integer, this function returns
+ * CborErrorIllegalType. If it is a negative integer, this function returns
+ * CborErrorDataTooLarge. In either case, the contents of \a buffer are
+ * unspecified and \a next is not updated.
+ *
+ * If the array has more elements than \a buffer has room for, this function
+ * still checks all of them, then returns CborErrorOutOfMemory with \a count
+ * set to the number of elements in the array. The first elements are stored
+ * in \a buffer and \a next is updated, but the caller will usually want to
+ * call the function again with a larger buffer.
+ *
+ * \sa cbor_value_get_int64_array(), cbor_value_get_uint32_array(), cbor_value_get_double_array()
+ */
+CborError cbor_value_get_uint64_array(const CborValue *value, uint64_t *buffer, size_t *count, CborValue *next)
+{
+    return get_array(UInt64Element, sizeof(*buffer), value, buffer, count, next);
+}
+
+/**
+ * Decodes the CBOR array that \a value points to, which must contain only
+ * integers, into the array of \c int64_t pointed to by \a buffer. If an
+ * element cannot be represented in an \c int64_t, this function returns
+ * CborErrorDataTooLarge. Otherwise, this function behaves like
+ * cbor_value_get_uint64_array().
+ *
+ * \sa cbor_value_get_uint64_array(), cbor_value_get_int32_array(), cbor_value_get_int64_checked()
+ */
+CborError cbor_value_get_int64_array(const CborValue *value, int64_t *buffer, size_t *count, CborValue *next)
+{
+    return get_array(Int64Element, sizeof(*buffer), value, buffer, count, next);
+}
+
+/**
+ * Decodes the CBOR array that \a value points to, which must contain only
+ * unsigned integers, into the array of \c uint32_t pointed to by \a buffer.
+ * If an element is negative or larger than \c UINT32_MAX, this function
+ * returns CborErrorDataTooLarge. Otherwise, this function behaves like
+ * cbor_value_get_uint64_array().
+ *
+ * \sa cbor_value_get_uint64_array(), cbor_value_get_int32_array()
+ */
+CborError cbor_value_get_uint32_array(const CborValue *value, uint32_t *buffer, size_t *count, CborValue *next)
+{
+    return get_array(UInt32Element, sizeof(*buffer), value, buffer, count, next);
+}
+
+/**
+ * Decodes the CBOR array that \a value points to, which must contain only
+ * integers, into the array of \c int32_t pointed to by \a buffer. If an
+ * element cannot be represented in an \c int32_t, this function returns
+ * CborErrorDataTooLarge. Otherwise, this function behaves like
+ * cbor_value_get_uint64_array().
+ *
+ * \sa cbor_value_get_uint64_array(), cbor_value_get_int64_array(), cbor_value_get_int_checked()
+ */
+CborError cbor_value_get_int32_array(const CborValue *value, int32_t *buffer, size_t *count, CborValue *next)
+{
+    return get_array(Int32Element, sizeof(*buffer), value, buffer, count, next);
+}
+
+#ifndef CBOR_NO_FLOATING_POINT
+/**
+ * Decodes the CBOR array that \a value points to, which must contain only
+ * floating point values, into the array of \c double pointed to by \a buffer.
+ * Half- and single-precision elements are converted to double precision, which
+ * is always exact. Integer elements are not converted and cause this function
+ * to return CborErrorIllegalType. Otherwise, this function behaves like
+ * cbor_value_get_uint64_array().
+ *
+ * \sa cbor_value_get_uint64_array(), cbor_value_get_float_array(), cbor_value_get_double()
+ */
+CborError cbor_value_get_double_array(const CborValue *value, double *buffer, size_t *count, CborValue *next)
+{
+    return get_array(DoubleElement, sizeof(*buffer), value, buffer, count, next);
+}
+
+/**
+ * Decodes the CBOR array that \a value points to, which must contain only
+ * floating point values, into the array of \c float pointed to by \a buffer.
+ * Half-precision elements are converted to single precision, as are double
+ * precision elements whose value can be represented exactly. Double precision
+ * elements that would lose precision cause this function to return
+ * CborErrorDataTooLarge. Otherwise, this function behaves like
+ * cbor_value_get_double_array().
+ *
+ * \sa cbor_value_get_double_array(), cbor_value_get_float()
+ */
+CborError cbor_value_get_float_array(const CborValue *value, float *buffer, size_t *count, CborValue *next)
+{
+    return get_array(FloatElement, sizeof(*buffer), value, buffer, count, next);
+}
+#endif
+
+
+static void swap_elements(void *buffer, size_t elementSize, size_t count)
+{
+    uint8_t *p = (uint8_t *)buffer;
+    for ( ; count; --count, p += elementSize) {
+        size_t i, j;
+        for (i = 0, j = elementSize - 1; i < j; ++i, --j) {
+            uint8_t t = p[i];
+            p[i] = p[j];
+            p[j] = t;
+        }
+    }
+}
+
+static CborError get_typed_array(const CborValue *value, CborTag bigEndianTag, CborTag littleEndianTag,
+                                 size_t elementSize, const void **data, size_t *count, void *buffer,
+                                 CborValue *next)
+{
+    CborError err;
+    CborValue it;
+    CborTag tag;
+    const void *ptr;
+    size_t len;
+    size_t capacity = *count;
+    bool needsSwap;
+    cbor_assert(cbor_value_is_tag(value));
+
+    cbor_value_get_tag(value, &tag);
+    if (tag != bigEndianTag && tag != littleEndianTag)
+        return CborErrorIllegalType;
+    needsSwap = elementSize > 1 && (tag == littleEndianTag) != is_little_endian_host();
+
+    it = *value;
+    err = cbor_value_advance_fixed(&it);
+    if (err)
+        return err;
+    if (!cbor_value_is_byte_string(&it))
+        return CborErrorIllegalType;
+
+    if (uses_linear_buffer(&it) && cbor_value_is_length_known(&it)) {
+        /* a single chunk: return a pointer into the buffer if we can */
+        err = _cbor_value_begin_string_iteration(&it);
+        if (!err)
+            err = _cbor_value_get_string_chunk(&it, &ptr, &len, &it);
+        if (!err)
+            err = _cbor_value_finish_string_iteration(&it);
+        if (err)
+            return err;
+        if (len % elementSize)
+            return CborErrorImproperValue;
+
+        *count = len / elementSize;
+        if (!needsSwap && ((uintptr_t)ptr & (elementSize - 1)) == 0) {
+            *data = ptr;
+        } else if (*count > capacity) {
+            err = CborErrorOutOfMemory;
+        } else {
+            memcpy(buffer, ptr, len);
+            *data = buffer;
+        }
+    } else {
+        len = capacity <= SIZE_MAX / elementSize ? capacity * elementSize : SIZE_MAX;
+        err = _cbor_value_copy_string(&it, buffer, &len, &it);
+        if (err && err != CborErrorOutOfMemory)
+            return err;
+        if (len % elementSize)
+            return CborErrorImproperValue;
+
+        *count = len / elementSize;
+        if (!err)
+            *data = buffer;
+    }
+
+    if (!err && needsSwap)
+        swap_elements(buffer, elementSize, *count);
+    if (next)
+        *next = it;
+    return err;
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be a tag of type CborTypedArrayUint8Tag or
+ * CborTypedArrayUint8ClampedTag followed by a byte string. On entry, \a count
+ * must contain the number of elements that \a buffer has room for (which may
+ * be zero, with \a buffer null). On successful return, \a data points to the
+ * elements and \a count contains their number. If \a next is not null, it is
+ * updated to point to the item that follows the typed array.
+ *
+ * When the parser reads from a linear buffer and the byte string is not
+ * chunked, \a data points directly into that buffer and nothing is copied.
+ * Otherwise, the elements are copied to \a buffer and \a data points to it. If
+ * \a buffer is too small, this function returns CborErrorOutOfMemory and sets
+ * \a count to the number of elements in the typed array.
+ *
+ * If \a value is a different tag or does not tag a byte string, this function
+ * returns CborErrorIllegalType.
+ *
+ * \sa cbor_encode_uint8_typed_array(), cbor_value_get_uint16_typed_array(), cbor_value_get_byte_string_chunk()
+ */
+CborError cbor_value_get_uint8_typed_array(const CborValue *value, const uint8_t **data, size_t *count,
+                                           uint8_t *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArrayUint8Tag, CborTypedArrayUint8ClampedTag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be a tag of type CborTypedArrayUint16BETag or
+ * CborTypedArrayUint16LETag followed by a byte string whose length is a
+ * multiple of 2 (otherwise, this function returns CborErrorImproperValue).
+ *
+ * The elements are returned without copying if, in addition to the conditions
+ * listed in cbor_value_get_uint8_typed_array(), they are stored in the host's
+ * byte order and are suitably aligned in memory. Otherwise, they are copied to
+ * \a buffer and converted to the host's byte order. In all other respects,
+ * this function behaves like cbor_value_get_uint8_typed_array().
+ *
+ * \sa cbor_encode_uint16_typed_array(), cbor_value_get_uint8_typed_array()
+ */
+CborError cbor_value_get_uint16_typed_array(const CborValue *value, const uint16_t **data, size_t *count,
+                                            uint16_t *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArrayUint16BETag, CborTypedArrayUint16LETag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be tagged with CborTypedArrayUint32BETag or
+ * CborTypedArrayUint32LETag. See cbor_value_get_uint16_typed_array() for
+ * details.
+ *
+ * \sa cbor_encode_uint32_typed_array(), cbor_value_get_uint16_typed_array()
+ */
+CborError cbor_value_get_uint32_typed_array(const CborValue *value, const uint32_t **data, size_t *count,
+                                            uint32_t *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArrayUint32BETag, CborTypedArrayUint32LETag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be tagged with CborTypedArrayUint64BETag or
+ * CborTypedArrayUint64LETag. See cbor_value_get_uint16_typed_array() for
+ * details.
+ *
+ * \sa cbor_encode_uint64_typed_array(), cbor_value_get_uint16_typed_array()
+ */
+CborError cbor_value_get_uint64_typed_array(const CborValue *value, const uint64_t **data, size_t *count,
+                                            uint64_t *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArrayUint64BETag, CborTypedArrayUint64LETag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be tagged with CborTypedArraySint8Tag. See
+ * cbor_value_get_uint8_typed_array() for details.
+ *
+ * \sa cbor_encode_int8_typed_array(), cbor_value_get_uint8_typed_array()
+ */
+CborError cbor_value_get_int8_typed_array(const CborValue *value, const int8_t **data, size_t *count,
+                                          int8_t *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArraySint8Tag, CborTypedArraySint8Tag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be tagged with CborTypedArraySint16BETag or
+ * CborTypedArraySint16LETag. See cbor_value_get_uint16_typed_array() for
+ * details.
+ *
+ * \sa cbor_encode_int16_typed_array(), cbor_value_get_uint16_typed_array()
+ */
+CborError cbor_value_get_int16_typed_array(const CborValue *value, const int16_t **data, size_t *count,
+                                           int16_t *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArraySint16BETag, CborTypedArraySint16LETag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be tagged with CborTypedArraySint32BETag or
+ * CborTypedArraySint32LETag. See cbor_value_get_uint16_typed_array() for
+ * details.
+ *
+ * \sa cbor_encode_int32_typed_array(), cbor_value_get_uint16_typed_array()
+ */
+CborError cbor_value_get_int32_typed_array(const CborValue *value, const int32_t **data, size_t *count,
+                                           int32_t *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArraySint32BETag, CborTypedArraySint32LETag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be tagged with CborTypedArraySint64BETag or
+ * CborTypedArraySint64LETag. See cbor_value_get_uint16_typed_array() for
+ * details.
+ *
+ * \sa cbor_encode_int64_typed_array(), cbor_value_get_uint16_typed_array()
+ */
+CborError cbor_value_get_int64_typed_array(const CborValue *value, const int64_t **data, size_t *count,
+                                           int64_t *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArraySint64BETag, CborTypedArraySint64LETag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+#ifndef CBOR_NO_FLOATING_POINT
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be tagged with CborTypedArrayFloat32BETag or
+ * CborTypedArrayFloat32LETag. See cbor_value_get_uint16_typed_array() for
+ * details.
+ *
+ * \sa cbor_encode_float_typed_array(), cbor_value_get_double_typed_array()
+ */
+CborError cbor_value_get_float_typed_array(const CborValue *value, const float **data, size_t *count,
+                                           float *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArrayFloat32BETag, CborTypedArrayFloat32LETag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+
+/**
+ * Obtains the contents of the RFC 8746 typed array that \a value points to,
+ * which must be tagged with CborTypedArrayFloat64BETag or
+ * CborTypedArrayFloat64LETag. See cbor_value_get_uint16_typed_array() for
+ * details.
+ *
+ * \sa cbor_encode_double_typed_array(), cbor_value_get_float_typed_array()
+ */
+CborError cbor_value_get_double_typed_array(const CborValue *value, const double **data, size_t *count,
+                                            double *buffer, CborValue *next)
+{
+    return get_typed_array(value, CborTypedArrayFloat64BETag, CborTypedArrayFloat64LETag, sizeof(*buffer),
+                           (const void **)data, count, buffer, next);
+}
+#endif
+
+/** @} */
@@ -0,0 +1,440 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "cborinternal_p.h"
+#include "compilersupport_p.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+/**
+ * \struct CborCallbacks
+ * Set of functions that cbor_parse_with_callbacks() and
+ * cbor_stream_parser_dispatch() call for each item they decode, in the order
+ * the items appear in the stream. All functions receive the \c context
+ * argument passed to those functions. Any of them can be null, in which case
+ * the corresponding items are skipped.
+ *
+ * Integers are reported by \c on_uint or by \c on_negative_int, which receives
+ * the value as encoded, like cbor_encode_negative_int(): the actual value is
+ * -1 - \c absolute_value. Tags are reported by \c on_tag before the item they
+ * apply to. Strings are reported by \c on_string_start, followed by any number
+ * of calls to \c on_string_chunk with consecutive parts of the contents and
+ * by \c on_string_end; the \c type argument is either CborTextStringType or
+ * CborByteStringType. The \c length argument of \c on_string_start, \c
+ * on_array_start and \c on_map_start is CborIndefiniteLength if it is not
+ * known; the length of maps is the number of key/value pairs.
+ *
+ * If a function returns an error, decoding stops and that error is returned.
+ * The text strings are not validated as UTF-8; use cbor_value_validate() for
+ * that.
+ */
+
+static CborError length_from_event(const CborStreamEvent *event, size_t *length)
+{
+    *length = CborIndefiniteLength;
+    if (event->flags & CborStreamFlag_IndefiniteLength)
+        return CborNoError;
+    if (event->value >= (uint64_t)CborIndefiniteLength)
+        return CborErrorDataTooLarge;
+    *length = (size_t)event->value;
+    return CborNoError;
+}
+
+static CborError dispatch_value(const CborStreamEvent *event, const CborCallbacks *callbacks, void *context)
+{
+    switch (event->type) {
+    case CborIntegerType:
+        if (event->flags & CborStreamFlag_NegativeInteger)
+            return callbacks->on_negative_int ? callbacks->on_negative_int(context, event->value) : CborNoError;
+        return callbacks->on_uint ? callbacks->on_uint(context, event->value) : CborNoError;
+    case CborTagType:
+        return callbacks->on_tag ? callbacks->on_tag(context, event->value) : CborNoError;
+    case CborSimpleType:
+        return callbacks->on_simple_type ? callbacks->on_simple_type(context, (uint8_t)event->value) : CborNoError;
+    case CborBooleanType:
+        return callbacks->on_boolean ? callbacks->on_boolean(context, event->value != 0) : CborNoError;
+    case CborNullType:
+        return callbacks->on_null ? callbacks->on_null(context) : CborNoError;
+    case CborUndefinedType:
+        return callbacks->on_undefined ? callbacks->on_undefined(context) : CborNoError;
+    case CborHalfFloatType:
+        return callbacks->on_half_float ? callbacks->on_half_float(context, (uint16_t)event->value) : CborNoError;
+    case CborFloatType:
+        if (callbacks->on_float) {
+            uint32_t bits = (uint32_t)event->value;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return callbacks->on_float(context, f);
+        }
+        return CborNoError;
+    case CborDoubleType:
+        if (callbacks->on_double) {
+            double d;
+            memcpy(&d, &event->value, sizeof(d));
+            return callbacks->on_double(context, d);
+        }
+        return CborNoError;
+    }
+    return CborErrorInternalError;      /* can't happen */
+}
+
+/**
+ * Decodes the data fed to the incremental parser \a parser and calls the
+ * function in \a callbacks that corresponds to each item, passing it \a
+ * context, until the current fragment is exhausted. This function then
+ * returns CborErrorUnexpectedEOF: call cbor_stream_parser_feed() with the next
+ * fragment and call this function again to continue. Any other error comes
+ * either from malformed data or from one of the callbacks.
+ *
+ * Strings that span fragments are reported in several calls to \c
+ * on_string_chunk.
+ *
+ * \sa CborCallbacks, cbor_parse_with_callbacks(), cbor_stream_parser_next()
+ */
+CborError cbor_stream_parser_dispatch(CborStreamParser *parser, const CborCallbacks *callbacks, void *context)
+{
+    CborStreamEvent event;
+    CborError err;
+    size_t length;
+
+    while ((err = cbor_stream_parser_next(parser, &event)) == CborNoError) {
+        switch ((CborStreamEventType)event.event) {
+        case CborStreamValue:
+            err = dispatch_value(&event, callbacks, context);
+            break;
+
+        case CborStreamContainerStart:
+            err = length_from_event(&event, &length);
+            if (!err && event.type == CborArrayType && callbacks->on_array_start)
+                err = callbacks->on_array_start(context, length);
+            else if (!err && event.type == CborMapType && callbacks->on_map_start)
+                err = callbacks->on_map_start(context, length);
+            break;
+
+        case CborStreamContainerEnd:
+            if (event.type == CborArrayType && callbacks->on_array_end)
+                err = callbacks->on_array_end(context);
+            else if (event.type == CborMapType && callbacks->on_map_end)
+                err = callbacks->on_map_end(context);
+            break;
+
+        case CborStreamStringStart:
+            err = length_from_event(&event, &length);
+            if (!err && callbacks->on_string_start)
+                err = callbacks->on_string_start(context, (CborType)event.type, length);
+            break;
+
+        case CborStreamStringData:
+            if (callbacks->on_string_chunk)
+                err = callbacks->on_string_chunk(context, (CborType)event.type, event.data, event.size);
+            break;
+
+        case CborStreamStringEnd:
+            if (callbacks->on_string_end)
+                err = callbacks->on_string_end(context, (CborType)event.type);
+            break;
+        }
+        if (err)
+            return err;
+    }
+    return err;
+}
+
+enum CallbackLevelFlags {
+    CallbackLevelIsMap              = 0x01,
+    CallbackLevelIsIndefinite       = 0x02,
+    CallbackLevelHasPendingValue    = 0x04      /* indefinite-length map with a key but no value */
+};
+
+static uint64_t read_header_value(const uint8_t *ptr, uint8_t info)
+{
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+    switch (info) {
+    case Value8Bit:
+        return *ptr;
+    case Value16Bit:
+        memcpy(&v16, ptr, sizeof(v16));
+        return cbor_ntohs(v16);
+    case Value32Bit:
+        memcpy(&v32, ptr, sizeof(v32));
+        return cbor_ntohl(v32);
+    }
+    memcpy(&v64, ptr, sizeof(v64));
+    return cbor_ntohll(v64);
+}
+
+static CborError call_simple_type(uint8_t descriptor, uint64_t value, const CborCallbacks *callbacks,
+                                  void *context)
+{
+    uint32_t bits;
+    float f;
+    double d;
+    switch (descriptor & SmallValueMask) {
+    case FalseValue:
+    case TrueValue:
+        return callbacks->on_boolean ?
+                    callbacks->on_boolean(context, (descriptor & SmallValueMask) == TrueValue) : CborNoError;
+    case NullValue:
+        return callbacks->on_null ? callbacks->on_null(context) : CborNoError;
+    case UndefinedValue:
+        return callbacks->on_undefined ? callbacks->on_undefined(context) : CborNoError;
+    case SimpleTypeInNextByte:
+#ifndef CBOR_PARSER_NO_STRICT_CHECKS
+        if (unlikely(value < 32))
+            return CborErrorIllegalSimpleType;
+#endif
+        break;
+    case HalfPrecisionFloat:
+        return callbacks->on_half_float ? callbacks->on_half_float(context, (uint16_t)value) : CborNoError;
+    case SinglePrecisionFloat:
+        if (callbacks->on_float) {
+            bits = (uint32_t)value;
+            memcpy(&f, &bits, sizeof(f));
+            return callbacks->on_float(context, f);
+        }
+        return CborNoError;
+    case DoublePrecisionFloat:
+        if (callbacks->on_double) {
+            memcpy(&d, &value, sizeof(d));
+            return callbacks->on_double(context, d);
+        }
+        return CborNoError;
+    }
+    return callbacks->on_simple_type ? callbacks->on_simple_type(context, (uint8_t)value) : CborNoError;
+}
+
+static CborError call_string(const uint8_t **ptr, const uint8_t *end, uint8_t descriptor, uint64_t value,
+                             const CborCallbacks *callbacks, void *context)
+{
+    CborType type = (CborType)(descriptor & MajorTypeMask);
+    CborError err;
+    uint8_t info;
+
+    if ((descriptor & SmallValueMask) != IndefiniteLength) {
+        /* don't report a string that isn't all there */
+        if (value >= (uint64_t)CborIndefiniteLength)
+            return CborErrorDataTooLarge;
+        if (value > (uint64_t)(end - *ptr))
+            return CborErrorUnexpectedEOF;
+        if (callbacks->on_string_start && (err = callbacks->on_string_start(context, type, (size_t)value)))
+            return err;
+        if (value && callbacks->on_string_chunk &&
+                (err = callbacks->on_string_chunk(context, type, *ptr, (size_t)value)))
+            return err;
+        *ptr += (size_t)value;
+        return callbacks->on_string_end ? callbacks->on_string_end(context, type) : CborNoError;
+    }
+
+    if (callbacks->on_string_start && (err = callbacks->on_string_start(context, type, CborIndefiniteLength)))
+        return err;
+    for (;;) {
+        /* only definite-length chunks of the same type may follow */
+        if (*ptr == end)
+            return CborErrorUnexpectedEOF;
+        descriptor = *(*ptr)++;
+        info = descriptor & SmallValueMask;
+        value = info;
+        if (info >= Value8Bit && info <= Value64Bit) {
+            if ((size_t)(end - *ptr) < (1U << (info - Value8Bit)))
+                return CborErrorUnexpectedEOF;
+            value = read_header_value(*ptr, info);
+            *ptr += 1U << (info - Value8Bit);
+        } else if (unlikely(info > Value64Bit && info != IndefiniteLength)) {
+            return (descriptor >> MajorTypeShift) == SimpleTypesType ? CborErrorUnknownType : CborErrorIllegalNumber;
+        }
+        if (descriptor == BreakByte)
+            return callbacks->on_string_end ? callbacks->on_string_end(context, type) : CborNoError;
+        if ((descriptor & MajorTypeMask) != type || info == IndefiniteLength)
+            return CborErrorIllegalType;
+        if (value > (uint64_t)(end - *ptr))
+            return CborErrorUnexpectedEOF;
+        if (value && callbacks->on_string_chunk &&
+                (err = callbacks->on_string_chunk(context, type, *ptr, (size_t)value)))
+            return err;
+        *ptr += (size_t)value;
+    }
+}
+
+static CborError call_container_end(uint8_t levelFlags, const CborCallbacks *callbacks, void *context)
+{
+    if (levelFlags & CallbackLevelIsMap)
+        return callbacks->on_map_end ? callbacks->on_map_end(context) : CborNoError;
+    return callbacks->on_array_end ? callbacks->on_array_end(context) : CborNoError;
+}
+
+/**
+ * Decodes the \a size bytes starting at \a buffer in a single pass, calling
+ * the function in \a callbacks that corresponds to each item and passing it \a
+ * context. The buffer may contain several top-level items (a CBOR sequence, as
+ * in RFC 8742); they are all decoded.
+ *
+ * Since the whole input is available, this function decodes it directly
+ * instead of going through the incremental parser: each item's initial byte
+ * selects the callback, the only state kept is the element count of each open
+ * container, and strings are passed to \c on_string_chunk directly from \a
+ * buffer, one call per chunk. This makes it cheaper than iterating with
+ * CborValue when every item is looked at only once, especially for documents
+ * with many containers or strings.
+ *
+ * Returns CborNoError if the whole buffer was decoded, CborErrorUnexpectedEOF
+ * if it ends in the middle of an item, or any error reported for malformed
+ * data or returned by a callback. Containers may be nested at most
+ * CBOR_STREAM_PARSER_MAX_DEPTH levels deep.
+ *
+ * \sa CborCallbacks, cbor_stream_parser_dispatch(), cbor_parser_init()
+ */
+CborError cbor_parse_with_callbacks(const uint8_t *buffer, size_t size, const CborCallbacks *callbacks,
+                                    void *context)
+{
+    uint64_t remaining[CBOR_STREAM_PARSER_MAX_DEPTH];
+    uint8_t levelFlags[CBOR_STREAM_PARSER_MAX_DEPTH];
+    const uint8_t *ptr = buffer;
+    const uint8_t *end = buffer + size;
+    uint32_t depth = 0;
+    bool afterTag = false;
+    CborError err;
+
+    for (;;) {
+        uint64_t value;
+        uint8_t descriptor, majortype, info;
+
+        /* close the definite-length containers that are complete */
+        while (depth && remaining[depth - 1] == 0 && !(levelFlags[depth - 1] & CallbackLevelIsIndefinite)) {
+            --depth;
+            err = call_container_end(levelFlags[depth], callbacks, context);
+            if (err)
+                return err;
+        }
+        if (ptr == end)
+            return depth || afterTag ? CborErrorUnexpectedEOF : CborNoError;
+
+        descriptor = *ptr++;
+        majortype = descriptor >> MajorTypeShift;
+        info = descriptor & SmallValueMask;
+        value = info;
+        if (info >= Value8Bit) {
+            if (info <= Value64Bit) {
+                if ((size_t)(end - ptr) < (1U << (info - Value8Bit)))
+                    return CborErrorUnexpectedEOF;
+                value = read_header_value(ptr, info);
+                ptr += 1U << (info - Value8Bit);
+            } else if (info != IndefiniteLength) {
+                return majortype == SimpleTypesType ? CborErrorUnknownType : CborErrorIllegalNumber;
+            } else if (descriptor == BreakByte) {
+                if (depth == 0 || afterTag ||
+                        (levelFlags[depth - 1] & (CallbackLevelIsIndefinite | CallbackLevelHasPendingValue)) != CallbackLevelIsIndefinite)
+                    return CborErrorUnexpectedBreak;
+                --depth;
+                err = call_container_end(levelFlags[depth], callbacks, context);
+                if (err)
+                    return err;
+                continue;
+            } else if (majortype < ByteStringType || majortype > MapType) {
+                return CborErrorIllegalNumber;
+            }
+        }
+
+        if (majortype == TagType) {
+            /* tags don't count as items: the tagged item does */
+            afterTag = true;
+            if (callbacks->on_tag && (err = callbacks->on_tag(context, value)) != CborNoError)
+                return err;
+            continue;
+        }
+
+        /* account for this item in the innermost container */
+        afterTag = false;
+        if (depth) {
+            if (levelFlags[depth - 1] & CallbackLevelIsIndefinite) {
+                if (levelFlags[depth - 1] & CallbackLevelIsMap)
+                    levelFlags[depth - 1] ^= CallbackLevelHasPendingValue;
+            } else {
+                --remaining[depth - 1];
+            }
+        }
+
+        switch ((CborMajorTypes)majortype) {
+        case UnsignedIntegerType:
+            err = callbacks->on_uint ? callbacks->on_uint(context, value) : CborNoError;
+            break;
+        case NegativeIntegerType:
+            err = callbacks->on_negative_int ? callbacks->on_negative_int(context, value) : CborNoError;
+            break;
+
+        case ByteStringType:
+        case TextStringType:
+            err = call_string(&ptr, end, descriptor, value, callbacks, context);
+            break;
+
+        case ArrayType:
+        case MapType:
+            if (depth == CBOR_STREAM_PARSER_MAX_DEPTH)
+                return CborErrorNestingTooDeep;
+            if (info == IndefiniteLength) {
+                levelFlags[depth] = CallbackLevelIsIndefinite;
+                remaining[depth] = 0;
+                value = CborIndefiniteLength;
+            } else if (value >= (uint64_t)CborIndefiniteLength || (majortype == MapType && value > UINT64_MAX / 2)) {
+                return CborErrorDataTooLarge;
+            } else {
+                levelFlags[depth] = 0;
+                remaining[depth] = majortype == MapType ? value * 2 : value;
+            }
+            if (majortype == MapType) {
+                levelFlags[depth] |= CallbackLevelIsMap;
+                err = callbacks->on_map_start ? callbacks->on_map_start(context, (size_t)value) : CborNoError;
+            } else {
+                err = callbacks->on_array_start ? callbacks->on_array_start(context, (size_t)value) : CborNoError;
+            }
+            ++depth;
+            break;
+
+        case TagType:           /* handled above */
+        case SimpleTypesType:
+            err = call_simple_type(descriptor, value, callbacks, context);
+            break;
+        }
+        if (err)
+            return err;
+    }
+}
+
+/** @} */
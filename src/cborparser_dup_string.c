@@ -55,6 +55,11 @@
  * On success, \c *buffer will contain a valid pointer that must be freed by
  * calling \c free(). This is the case even for zero-length strings.
  *
+ * If an allocator was attached to the parser with cbor_parser_set_allocator(),
+ * the memory is obtained from it instead of \c malloc and must be returned to
+ * it (the block is \c{*buflen + 1} bytes long). See CborArena for an
+ * allocator that needs no individual frees.
+ *
  * The \a next pointer, if not null, will be updated to point to the next item
  * after this string. If \a value points to the last item, then \a next will be
  * invalid.
@@ -86,6 +91,11 @@
  * On success, \c *buffer will contain a valid pointer that must be freed by
  * calling \c free(). This is the case even for zero-length strings.
  *
+ * If an allocator was attached to the parser with cbor_parser_set_allocator(),
+ * the memory is obtained from it instead of \c malloc and must be returned to
+ * it (the block is \c{*buflen + 1} bytes long). See CborArena for an
+ * allocator that needs no individual frees.
+ *
  * The \a next pointer, if not null, will be updated to point to the next item
  * after this string. If \a value points to the last item, then \a next will be
  * invalid.
@@ -99,6 +109,7 @@
 CborError _cbor_value_dup_string(const CborValue *value, void **buffer, size_t *buflen, CborValue *next)
 {
     CborError err;
+    size_t size;
     cbor_assert(buffer);
     cbor_assert(buflen);
     *buflen = SIZE_MAX;
@@ -106,15 +117,15 @@ CborError _cbor_value_dup_string(const CborValue *value, void **buffer, size_t *
     if (err)
         return err;
 
-    ++*buflen;
-    *buffer = cbor_malloc(*buflen);
+    size = ++*buflen;
+    *buffer = cbor_allocate_with(value->parser->allocator, size);
     if (!*buffer) {
         /* out of memory */
         return CborErrorOutOfMemory;
     }
     err = _cbor_value_copy_string(value, *buffer, buflen, next);
     if (err) {
-        cbor_free(*buffer);
+        cbor_deallocate_with(value->parser->allocator, *buffer, size);
         return err;
     }
     return CborNoError;
@@ -0,0 +1,508 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE 1
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "cborinternal_p.h"
+#include "compilersupport_p.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+/**
+ * \struct CborContainerIndex
+ *
+ * This structure holds a side index into a CBOR array or map, built by
+ * cbor_value_create_container_index(), allowing random access to the
+ * container's elements in constant time. The index stores the byte offset of
+ * each element relative to the first one, so it remains valid as long as the
+ * buffer the container was parsed from is valid and unmodified.
+ *
+ * For maps, the items in the index alternate between keys and values: the
+ * keys are located at even positions and the value corresponding to each key
+ * immediately follows it. Optionally, the index also stores a hash of each
+ * text string key so that cbor_container_index_map_find_value() needs to
+ * compare only the keys that are likely to match.
+ *
+ * \sa cbor_value_create_container_index(), cbor_container_index_get_item()
+ */
+
+/**
+ * \fn size_t cbor_container_index_get_count(const CborContainerIndex *index)
+ *
+ * Returns the number of items stored in the \a index. For arrays, that is the
+ * number of elements; for maps, that is twice the number of key-value pairs.
+ * This is 0 if building the index failed.
+ *
+ * \sa cbor_value_create_container_index(), cbor_container_index_get_item()
+ */
+
+/**
+ * \fn size_t cbor_container_index_get_required_count(const CborContainerIndex *index)
+ *
+ * Returns the number of entries that cbor_value_create_container_index()
+ * needed in the \a offsets array, whether or not the array it was given was
+ * large enough. After a CborErrorOutOfMemory result, call that function again
+ * with arrays of at least this size.
+ *
+ * \sa cbor_value_create_container_index(), cbor_container_index_get_count()
+ */
+
+enum {
+    /* FNV-1a, 32-bit */
+    KeyHashOffsetBasis = 2166136261U,
+    KeyHashPrime = 16777619U
+};
+
+static uint32_t hash_key_data(uint32_t hash, const char *data, size_t len)
+{
+    const uint8_t *ptr = (const uint8_t *)data;
+    const uint8_t *end = ptr + len;
+    for ( ; ptr != end; ++ptr)
+        hash = (hash ^ *ptr) * KeyHashPrime;
+    return hash;
+}
+
+/* Hashes the untagged map key \a it points to and advances \a it past it.
+ * Keys that are not text strings are skipped and get a hash of zero: a false
+ * positive in the hash comparison is acceptable, since the caller confirms
+ * the match. */
+static CborError hash_key_and_advance(CborValue *it, uint32_t *result)
+{
+    CborError err;
+    uint32_t hash = KeyHashOffsetBasis;
+    *result = 0;
+    if (!cbor_value_is_text_string(it))
+        return cbor_value_advance(it);
+
+    err = cbor_value_begin_string_iteration(it);
+    while (!err) {
+        const char *ptr;
+        size_t len;
+        err = cbor_value_get_text_string_chunk(it, &ptr, &len, it);
+        if (!err)
+            hash = hash_key_data(hash, ptr, len);
+    }
+    if (err != CborErrorNoMoreStringChunks)
+        return err;
+
+    *result = hash;
+    return cbor_value_finish_string_iteration(it);
+}
+
+/**
+ * Builds an index over the elements of the array or map that \a container
+ * points to and stores it in \a index. The offset of each element is stored
+ * in the array pointed to by \a offsets, which must have room for \a capacity
+ * entries. If \a container is a map, each key and each value occupies an entry,
+ * so the array must be twice as large as the number of key-value pairs.
+ *
+ * If \a container points to a map and \a keyHashes is not null, this function
+ * also stores a hash of each text string key in \a keyHashes, which must have
+ * room for \a capacity / 2 entries. Those hashes speed up
+ * cbor_container_index_map_find_value(). The \a keyHashes parameter is ignored
+ * for arrays.
+ *
+ * Building the index requires iterating over the entire container once, which
+ * is the same cost as a single cbor_value_advance() call. Afterwards, any
+ * element can be obtained in constant time with cbor_container_index_get_item().
+ * The \a offsets and \a keyHashes arrays must remain valid for as long as
+ * \a index is in use.
+ *
+ * If \a capacity is not large enough to hold all elements, this function
+ * returns CborErrorOutOfMemory after having iterated over the whole container
+ * and cbor_container_index_get_required_count() returns the capacity required.
+ * The index is then empty (cbor_container_index_get_count() returns 0), but the
+ * function can be called again with larger arrays.
+ *
+ * This function requires the parser to have been initialized with
+ * cbor_parser_init() and returns CborErrorUnsupportedSource if it was
+ * initialized with cbor_parser_init_reader().
+ *
+ * The \a container CborValue iterator must point to a container and is not
+ * modified by this function.
+ *
+ * \sa cbor_container_index_get_item(), cbor_container_index_map_find_value()
+ */
+CborError cbor_value_create_container_index(const CborValue *container, CborContainerIndex *index,
+                                            uint32_t *offsets, uint32_t *keyHashes, size_t capacity)
+{
+    CborError err;
+    CborValue it;
+    size_t count = 0;
+    cbor_assert(cbor_value_is_container(container));
+
+    index->offsets = offsets;
+    index->keyHashes = cbor_value_is_map(container) ? keyHashes : NULL;
+    index->count = 0;
+    index->required = 0;
+    if (!uses_linear_buffer(container))
+        return CborErrorUnsupportedSource;
+
+    err = cbor_value_enter_container(container, &index->first);
+    if (err)
+        return err;
+
+    it = index->first;
+    while (!cbor_value_at_end(&it)) {
+        size_t offset = (size_t)(it.source.ptr - index->first.source.ptr);
+        if (offset > UINT32_MAX)
+            return CborErrorDataTooLarge;
+        if (count < capacity)
+            offsets[count] = (uint32_t)offset;
+
+        /* the offset points to the first tag, if any, but the item is what comes after */
+        err = cbor_value_skip_tag(&it);
+        if (err)
+            return err;
+        if (index->keyHashes && count % 2 == 0) {
+            uint32_t hash = 0;
+            err = hash_key_and_advance(&it, &hash);
+            if (count + 1 < capacity)
+                index->keyHashes[count / 2] = hash;
+        } else {
+            err = cbor_value_advance(&it);
+        }
+        if (err)
+            return err;
+        ++count;
+    }
+
+    /* never expose more items than were stored */
+    index->required = count;
+    if (count > capacity)
+        return CborErrorOutOfMemory;
+    index->count = count;
+    return CborNoError;
+}
+
+/**
+ * Obtains the item at position \a n in the container that \a index was built
+ * for and stores it in \a item. This function runs in constant time. For
+ * arrays, \a n is the element number; for maps, the key of the i-th pair is
+ * at position 2 * i and its value is at position 2 * i + 1.
+ *
+ * The iterator \a item is equivalent to the one obtained by entering the
+ * container and advancing \a n times, so it can be used to continue
+ * iterating. If the item is tagged, \a item points to the first tag.
+ *
+ * If \a n is not smaller than the number of items in the index, this function
+ * returns CborErrorAdvancePastEOF and \a item is set to an invalid iterator.
+ *
+ * \sa cbor_value_create_container_index(), cbor_container_index_get_count()
+ */
+CborError cbor_container_index_get_item(const CborContainerIndex *index, size_t n, CborValue *item)
+{
+    *item = index->first;
+    if (n >= index->count) {
+        item->type = CborInvalidType;
+        return CborErrorAdvancePastEOF;
+    }
+
+    item->source.ptr += index->offsets[n];
+    if (item->remaining != UINT32_MAX)
+        item->remaining -= (uint32_t)n;
+    item->flags &= CborIteratorFlag_ContainerIsMap;
+    if (item->flags & CborIteratorFlag_ContainerIsMap && n & 1)
+        item->flags |= CborIteratorFlag_NextIsMapKey;
+    item->type = CborInvalidType;
+    return cbor_value_reparse(item);
+}
+
+/**
+ * Attempts to find the value in the map that \a index was built for that
+ * corresponds to the text string key given by \a string. If the item is
+ * found, it is stored in \a element. If no item is found matching the key,
+ * then \a element will contain an element of type \ref CborInvalidType.
+ * Matching is performed using byte comparison against the text string, as
+ * in cbor_value_map_find_value().
+ *
+ * If the index was built with key hashes, this function only compares the
+ * keys whose hash matches that of \a string. Otherwise, it compares each key
+ * in turn, but still does not need to skip over the values.
+ *
+ * \sa cbor_value_create_container_index(), cbor_value_map_find_value()
+ */
+CborError cbor_container_index_map_find_value(const CborContainerIndex *index, const char *string, CborValue *element)
+{
+    CborError err;
+    size_t i;
+    uint32_t hash = hash_key_data(KeyHashOffsetBasis, string, strlen(string));
+    cbor_assert(index->first.flags & CborIteratorFlag_ContainerIsMap || index->count == 0);
+
+    for (i = 0; i < index->count; i += 2) {
+        bool equals;
+        if (index->keyHashes && index->keyHashes[i / 2] != hash)
+            continue;
+
+        err = cbor_container_index_get_item(index, i, element);
+        if (!err)
+            err = cbor_value_skip_tag(element);
+        if (err)
+            goto error;
+        if (!cbor_value_is_text_string(element))
+            continue;
+
+        err = cbor_value_text_string_equals(element, string, &equals);
+        if (err)
+            goto error;
+        if (equals)
+            return cbor_container_index_get_item(index, i + 1, element);
+    }
+
+    /* not found */
+    element->type = CborInvalidType;
+    return CborNoError;
+
+error:
+    element->type = CborInvalidType;
+    return err;
+}
+
+/**
+ * \struct CborDocumentIndex
+ *
+ * This structure holds a structural index of a CBOR item and everything
+ * nested in it, built by cbor_value_validate_and_index() while validating
+ * that item. Since the item is known to be valid, the index can be used to
+ * access any of its contents without validating or parsing the stream again.
+ * The index remains valid as long as the buffer the item was parsed from is
+ * valid and unmodified.
+ *
+ * The index is an array of CborIndexEntry, one per item in the order they
+ * appear in the stream. The validated item is at position 0. If an item at
+ * position \c n is a non-empty array or map, its first element (or key) is at
+ * position \c n + 1 and each following element is at the position stored in
+ * the CborIndexEntry::next member of the previous one, until the \c next
+ * member of the container itself is reached. Maps contain the keys at even
+ * and the values at odd positions in that sequence.
+ *
+ * \sa cbor_value_validate_and_index(), cbor_document_index_get_entry(),
+ *     cbor_document_index_get_value()
+ */
+
+/**
+ * \struct CborIndexEntry
+ *
+ * This structure describes one item in a CborDocumentIndex.
+ *
+ * \var uint32_t CborIndexEntry::offset
+ * The offset of the item, from the beginning of the item that was indexed.
+ * If the item is tagged, this is the offset of its first tag.
+ *
+ * \var uint32_t CborIndexEntry::end
+ * The offset of the first byte past the end of the item.
+ *
+ * \var uint32_t CborIndexEntry::next
+ * The position in the index of the next entry that is not nested in this
+ * item. For an array or a map, that skips all of its contents.
+ *
+ * \var uint32_t CborIndexEntry::count
+ * For arrays, the number of elements. For maps, twice the number of key-value
+ * pairs. For byte and text strings, the length of the string in bytes (the
+ * sum of all chunks' lengths, if it was chunked). Zero for other types.
+ *
+ * \var uint8_t CborIndexEntry::type
+ * The CborType of the item, after any tags.
+ *
+ * \var uint8_t CborIndexEntry::flags
+ * A combination of CborIndexEntryFlags.
+ */
+
+/**
+ * \enum CborIndexEntryFlags
+ * The CborIndexEntryFlags enum contains flags that describe an item in a CborDocumentIndex.
+ *
+ * \value CborIndexEntryFlag_Tagged             The item is preceded by one or more tags.
+ * \value CborIndexEntryFlag_IndefiniteLength   The item is an array, map or string encoded with
+ *                                              indefinite length.
+ */
+
+/**
+ * \fn size_t cbor_document_index_get_count(const CborDocumentIndex *index)
+ *
+ * Returns the number of entries in the \a index, which is the number of items
+ * in the item that was indexed, including itself. This is 0 if building the
+ * index failed.
+ *
+ * \sa cbor_value_validate_and_index(), cbor_document_index_get_entry()
+ */
+
+/**
+ * \fn size_t cbor_document_index_get_required_count(const CborDocumentIndex *index)
+ *
+ * Returns the number of entries that cbor_value_validate_and_index() needed
+ * to index the item, whether or not the array it was given was large enough.
+ * After a CborErrorOutOfMemory result, call that function again with an array
+ * of at least this many entries.
+ *
+ * \sa cbor_value_validate_and_index(), cbor_document_index_get_count()
+ */
+
+/**
+ * \fn const CborIndexEntry *cbor_document_index_get_entry(const CborDocumentIndex *index, size_t n)
+ *
+ * Returns the entry at position \a n in the \a index, or null if \a n is not
+ * smaller than the number of entries.
+ *
+ * \sa cbor_document_index_get_count(), cbor_document_index_get_value()
+ */
+
+/**
+ * Obtains a CborValue iterator for the item at position \a n in \a index and
+ * stores it in \a value. This function runs in constant time. The iterator
+ * can be used with all the parsing functions, including entering the item if
+ * it is a container, but is independent of the container the item is in:
+ * advancing past the item makes it reach the end.
+ *
+ * If the item is tagged, \a value points to the first tag.
+ *
+ * If \a n is not smaller than the number of entries in the index, this
+ * function returns CborErrorAdvancePastEOF and \a value is set to an invalid
+ * iterator.
+ *
+ * \sa cbor_value_validate_and_index(), cbor_document_index_get_entry()
+ */
+CborError cbor_document_index_get_value(const CborDocumentIndex *index, size_t n, CborValue *value)
+{
+    *value = index->first;
+    if (n >= index->count) {
+        value->type = CborInvalidType;
+        return CborErrorAdvancePastEOF;
+    }
+
+    value->source.ptr += index->entries[n].offset;
+    value->remaining = 1;
+    value->flags = 0;
+    value->type = CborInvalidType;
+    return cbor_value_reparse(value);
+}
+
+/**
+ * Obtains the contents of the byte or text string at position \a n in \a
+ * index without parsing it: \a data is set to point to the string's bytes in
+ * the buffer that was parsed and \a len to its length. No copy is made.
+ *
+ * This function returns CborErrorIllegalType if the item is not a string and
+ * CborErrorUnknownLength if it was encoded in chunks, since its contents are
+ * not contiguous in that case. Use cbor_document_index_get_value() and the
+ * string functions for the latter.
+ *
+ * \sa cbor_document_index_get_value(), cbor_value_get_text_string_chunk()
+ */
+CborError cbor_document_index_get_string(const CborDocumentIndex *index, size_t n, const uint8_t **data,
+                                         size_t *len)
+{
+    const CborIndexEntry *entry;
+    *data = NULL;
+    *len = 0;
+    if (n >= index->count)
+        return CborErrorAdvancePastEOF;
+
+    entry = &index->entries[n];
+    if (entry->type != CborByteStringType && entry->type != CborTextStringType)
+        return CborErrorIllegalType;
+    if (entry->flags & CborIndexEntryFlag_IndefiniteLength)
+        return CborErrorUnknownLength;
+
+    /* the contents of a definite-length string are the last bytes of the item */
+    *data = index->first.source.ptr + entry->end - entry->count;
+    *len = entry->count;
+    return CborNoError;
+}
+
+/**
+ * Attempts to find the value in the map at position \a map in \a index that
+ * corresponds to the text string key given by \a string. If the key is found,
+ * the position of the value in the index is stored in \a position; otherwise,
+ * \a position is set to 0 (which is never the position of a map value).
+ * Matching is performed using byte comparison against the text string, as
+ * in cbor_value_map_find_value().
+ *
+ * Unlike cbor_value_map_find_value(), this function does not parse the map's
+ * contents: it skips over the values using the index and only compares the
+ * bytes of the keys whose length matches.
+ *
+ * This function returns CborErrorIllegalType if the item at position \a map
+ * is not a map.
+ *
+ * \sa cbor_value_validate_and_index(), cbor_document_index_get_value()
+ */
+CborError cbor_document_index_map_find_value(const CborDocumentIndex *index, size_t map, const char *string,
+                                             size_t *position)
+{
+    CborError err;
+    size_t i, end;
+    size_t len = strlen(string);
+    *position = 0;
+    if (map >= index->count)
+        return CborErrorAdvancePastEOF;
+    if (index->entries[map].type != CborMapType)
+        return CborErrorIllegalType;
+
+    end = index->entries[map].next;
+    for (i = map + 1; i < end; i = index->entries[index->entries[i].next].next) {
+        const CborIndexEntry *key = &index->entries[i];
+        bool equals;
+        if (key->type != CborTextStringType || key->count != len)
+            continue;
+
+        if (key->flags & CborIndexEntryFlag_IndefiniteLength) {
+            CborValue value;
+            err = cbor_document_index_get_value(index, i, &value);
+            if (!err)
+                err = cbor_value_skip_tag(&value);
+            if (!err)
+                err = cbor_value_text_string_equals(&value, string, &equals);
+            if (err)
+                return err;
+        } else {
+            equals = memcmp(index->first.source.ptr + key->end - len, string, len) == 0;
+        }
+
+        if (equals) {
+            *position = key->next;
+            return CborNoError;
+        }
+    }
+
+    /* not found */
+    return CborNoError;
+}
+
+/** @} */
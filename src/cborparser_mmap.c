@@ -0,0 +1,174 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "compilersupport_p.h"
+
+#if !defined(WITHOUT_MMAP) && defined(_WIN32)
+#  define WITHOUT_MMAP
+#endif
+
+#ifndef WITHOUT_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef O_CLOEXEC
+#  define O_CLOEXEC 0
+#endif
+#endif
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+/**
+ * \struct CborMappedFile
+ * File mapped into memory by cbor_parser_init_file(). The \c data member
+ * points to the contents of the file and \c size contains its length.
+ */
+
+#ifndef WITHOUT_MMAP
+static CborError map_file(const char *fileName, CborMappedFile *file)
+{
+    struct stat st;
+    void *data;
+    int saved_errno;
+    int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return CborErrorIO;
+
+    if (fstat(fd, &st) < 0)
+        goto io_error;
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        return CborErrorUnsupportedSource;
+    }
+    if ((uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        return CborErrorDataTooLarge;
+    }
+    if (st.st_size == 0) {
+        /* can't map an empty file, but there's nothing to map either */
+        close(fd);
+        return CborNoError;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        goto io_error;
+    close(fd);
+
+#ifdef MADV_SEQUENTIAL
+    /* the parser reads forward only: ask for aggressive read-ahead and for
+     * the pages already read to be dropped first */
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    file->data = (const uint8_t *)data;
+    file->size = (size_t)st.st_size;
+    return CborNoError;
+
+io_error:
+    saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return CborErrorIO;
+}
+#else
+static CborError map_file(const char *fileName, CborMappedFile *file)
+{
+    (void)fileName;
+    (void)file;
+    return CborErrorIO;
+}
+#endif
+
+/**
+ * Maps the file named \a fileName into memory and initializes the CBOR parser
+ * for parsing its contents as if by cbor_parser_init(), passing it \a flags.
+ * The mapping is stored in \a file and the iterator to the first element is
+ * returned in \a it.
+ *
+ * Unlike reading the file into a buffer first, this does not copy the data
+ * nor require memory for all of it: the operating system reads the pages as
+ * the parser reaches them and is told that the access is sequential.
+ *
+ * This function returns CborErrorIO if the file could not be opened or mapped
+ * (\c errno then contains the reason) and CborErrorUnsupportedSource if it is
+ * not a regular file, such as a pipe or a terminal: those must be read into a
+ * buffer instead. Otherwise, it returns the result of cbor_parser_init(),
+ * which is CborErrorUnexpectedEOF for an empty file.
+ *
+ * The data must not be accessed after \a file is released with
+ * cbor_mapped_file_close(), which must be called whatever the return value
+ * of this function. The contents are undefined if the file is modified while
+ * it is mapped.
+ *
+ * On systems without \c mmap(), or if the library was built with
+ * \c WITHOUT_MMAP, this function always returns CborErrorIO.
+ *
+ * \sa cbor_parser_init(), cbor_mapped_file_close()
+ */
+CborError cbor_parser_init_file(const char *fileName, uint32_t flags, CborMappedFile *file,
+                                CborParser *parser, CborValue *it)
+{
+    CborError err;
+    file->data = NULL;
+    file->size = 0;
+    err = map_file(fileName, file);
+    if (err)
+        return err;
+    return cbor_parser_init(file->data, file->size, flags, parser, it);
+}
+
+/**
+ * Unmaps the file that cbor_parser_init_file() mapped into \a file. It is
+ * safe to call this function even if mapping the file failed.
+ *
+ * \sa cbor_parser_init_file()
+ */
+void cbor_mapped_file_close(CborMappedFile *file)
+{
+#ifndef WITHOUT_MMAP
+    if (file->data)
+        munmap((void *)file->data, file->size);
+#endif
+    file->data = NULL;
+    file->size = 0;
+}
+
+/** @} */
@@ -0,0 +1,420 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+#define __STDC_WANT_IEC_60559_TYPES_EXT__
+
+#include "cbor.h"
+#include "cborinternal_p.h"
+#include "compilersupport_p.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+/**
+ * \struct CborStreamParser
+ * Incremental parser that decodes CBOR data fed to it in fragments of any
+ * size, such as the buffers received from a network socket, without the
+ * whole message ever being in memory at once. All members are private.
+ *
+ * Unlike CborParser and CborValue, which require random access to a complete
+ * buffer (or a CborParserOperations source that can always supply the bytes
+ * requested), this parser keeps its own position in the CBOR structure and
+ * can suspend at any byte boundary: when the current fragment is exhausted,
+ * cbor_stream_parser_next() returns CborErrorUnexpectedEOF and the next call
+ * after cbor_stream_parser_feed() resumes exactly where decoding stopped.
+ * Item headers split across fragments are saved in the parser; string
+ * contents are never copied but returned as pointers into the fragments.
+ *
+ * The parser decodes a sequence of top-level items (RFC 8742), so several
+ * messages can be decoded from one connection. Use
+ * cbor_stream_parser_at_top_level() to find out when one is complete.
+ *
+ * Containers may be nested at most CBOR_STREAM_PARSER_MAX_DEPTH levels deep
+ * (32 unless defined otherwise when compiling both TinyCBOR and the
+ * application).
+ *
+ * Example:
+ * \code
+ *      CborStreamParser parser;
+ *      CborStreamEvent event;
+ *      cbor_stream_parser_init(&parser);
+ *      while ((len = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+ *          cbor_stream_parser_feed(&parser, buffer, len);
+ *          while ((err = cbor_stream_parser_next(&parser, &event)) == CborNoError)
+ *              process_event(&event);
+ *          if (err != CborErrorUnexpectedEOF)
+ *              return err;     // malformed data
+ *      }
+ * \endcode
+ *
+ * \sa cbor_stream_parser_init(), cbor_parser_init()
+ */
+
+/**
+ * \struct CborStreamEvent
+ * One decoding event returned by cbor_stream_parser_next(). The \c event
+ * member is one of the CborStreamEventType values and \c type is the
+ * CborType of the item the event applies to.
+ *
+ * \value CborStreamValue           A complete item that is neither a string nor a container. For
+ *                                  integers, \c value contains the absolute value as encoded and
+ *                                  \c flags has CborStreamFlag_NegativeInteger set if the actual
+ *                                  value is -1 - \c value. It contains the tag number for tags,
+ *                                  the simple type, 0 or 1 for booleans and the bits of the
+ *                                  floating point value in the encoding's precision.
+ * \value CborStreamContainerStart  An array or map starts. \c value contains its number of elements
+ *                                  (pairs for maps), unless \c flags has
+ *                                  CborStreamFlag_IndefiniteLength set.
+ * \value CborStreamContainerEnd    The innermost array or map is complete.
+ * \value CborStreamStringStart     A text or byte string starts. \c value contains its length,
+ *                                  unless \c flags has CborStreamFlag_IndefiniteLength set.
+ * \value CborStreamStringData      \c size bytes of the string's contents are at \c data, which
+ *                                  points into the fragment passed to cbor_stream_parser_feed().
+ *                                  A string can be split into any number of these events.
+ * \value CborStreamStringEnd       The string is complete.
+ */
+
+/**
+ * \fn bool cbor_stream_parser_at_top_level(const CborStreamParser *parser)
+ *
+ * Returns true if \a parser is not in the middle of an item, that is, if all
+ * the top-level items it returned events for are complete. Combined with
+ * cbor_stream_parser_get_next_byte(), this allows stopping after a message.
+ */
+
+/**
+ * \fn const uint8_t *cbor_stream_parser_get_next_byte(const CborStreamParser *parser)
+ *
+ * Returns a pointer to the next byte of the current fragment that \a parser
+ * will decode.
+ */
+
+/**
+ * \fn uint64_t cbor_stream_parser_get_offset(const CborStreamParser *parser)
+ *
+ * Returns the number of bytes that \a parser consumed since it was
+ * initialized, over all fragments.
+ */
+
+enum StreamParserState {
+    StreamInString          = 0x01,
+    StreamInStringChunk     = 0x02,
+    StreamIndefiniteString  = 0x04,
+    StreamAfterTag          = 0x08
+};
+
+enum StreamLevelFlags {
+    LevelIsMap              = 0x01,
+    LevelIsIndefinite       = 0x02,
+    LevelHasPendingValue    = 0x04      /* indefinite-length map with a key but no value */
+};
+
+/* returns the size of the header starting with \a descriptor, or 0 if it's invalid */
+static size_t header_length(uint8_t descriptor)
+{
+    uint8_t info = descriptor & SmallValueMask;
+    if (info < Value8Bit || info == IndefiniteLength)
+        return 1;
+    if (info <= Value64Bit)
+        return 1 + (1U << (info - Value8Bit));
+    return 0;
+}
+
+static uint64_t header_value(const uint8_t *header)
+{
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+    switch (header[0] & SmallValueMask) {
+    case Value8Bit:
+        return header[1];
+    case Value16Bit:
+        memcpy(&v16, header + 1, sizeof(v16));
+        return cbor_ntohs(v16);
+    case Value32Bit:
+        memcpy(&v32, header + 1, sizeof(v32));
+        return cbor_ntohl(v32);
+    case Value64Bit:
+        memcpy(&v64, header + 1, sizeof(v64));
+        return cbor_ntohll(v64);
+    }
+    return header[0] & SmallValueMask;
+}
+
+/* accounts for one complete item in the innermost container */
+static void count_item(CborStreamParser *parser)
+{
+    parser->state &= ~StreamAfterTag;
+    if (parser->depth) {
+        uint32_t level = parser->depth - 1;
+        if (parser->levelFlags[level] & LevelIsIndefinite) {
+            if (parser->levelFlags[level] & LevelIsMap)
+                parser->levelFlags[level] ^= LevelHasPendingValue;
+        } else {
+            --parser->remaining[level];
+        }
+    }
+}
+
+static CborError end_string(CborStreamParser *parser, CborStreamEvent *event)
+{
+    parser->state &= ~(StreamInString | StreamInStringChunk | StreamIndefiniteString);
+    event->event = CborStreamStringEnd;
+    event->type = parser->stringType;
+    return CborNoError;
+}
+
+/**
+ * Initializes the incremental parser \a parser. Feed it data with
+ * cbor_stream_parser_feed() before decoding with cbor_stream_parser_next().
+ *
+ * \sa CborStreamParser
+ */
+void cbor_stream_parser_init(CborStreamParser *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+}
+
+/**
+ * Supplies \a parser with the next \a size bytes of the CBOR stream, starting
+ * at \a data. The previous fragment must have been fully consumed, that is,
+ * cbor_stream_parser_next() must have returned CborErrorUnexpectedEOF (unless
+ * the remaining bytes are intentionally discarded).
+ *
+ * The buffer must remain valid until the next call to this function, since
+ * the string data returned by cbor_stream_parser_next() points into it.
+ */
+void cbor_stream_parser_feed(CborStreamParser *parser, const void *data, size_t size)
+{
+    parser->consumed += (uint64_t)(parser->ptr - parser->start);
+    parser->start = parser->ptr = (const uint8_t *)data;
+    parser->end = parser->ptr + size;
+}
+
+/**
+ * Decodes the next event from the data fed to \a parser and stores it in \a
+ * event. Each call returns at most one event and consumes only the bytes
+ * needed for it.
+ *
+ * If the current fragment does not contain enough data for the next event,
+ * this function consumes what it has and returns CborErrorUnexpectedEOF:
+ * call cbor_stream_parser_feed() with the next fragment and call this
+ * function again to continue. If the stream ended, the data was truncated
+ * unless cbor_stream_parser_at_top_level() returns true.
+ *
+ * Other errors indicate malformed data; the state of \a parser is then
+ * undefined and it must be reinitialized before being used again.
+ *
+ * \sa CborStreamEvent
+ */
+CborError cbor_stream_parser_next(CborStreamParser *parser, CborStreamEvent *event)
+{
+    event->value = 0;
+    event->data = NULL;
+    event->size = 0;
+    event->flags = 0;
+
+    for (;;) {
+        const uint8_t *header;
+        size_t len;
+        size_t avail = (size_t)(parser->end - parser->ptr);
+        uint64_t value;
+        uint8_t descriptor, majortype;
+
+        if (parser->state & StreamInStringChunk) {
+            if (parser->stringRemaining) {
+                if (!avail)
+                    return CborErrorUnexpectedEOF;
+                if (avail > parser->stringRemaining)
+                    avail = (size_t)parser->stringRemaining;
+                event->event = CborStreamStringData;
+                event->type = parser->stringType;
+                event->data = parser->ptr;
+                event->size = avail;
+                parser->ptr += avail;
+                parser->stringRemaining -= avail;
+                return CborNoError;
+            }
+            parser->state &= ~StreamInStringChunk;
+            if (!(parser->state & StreamIndefiniteString))
+                return end_string(parser, event);
+        }
+
+        /* end of a definite-length container? */
+        if (parser->depth && !(parser->state & StreamInString)) {
+            uint32_t level = parser->depth - 1;
+            if (!(parser->levelFlags[level] & LevelIsIndefinite) && parser->remaining[level] == 0) {
+                --parser->depth;
+                event->event = CborStreamContainerEnd;
+                event->type = parser->levelFlags[level] & LevelIsMap ? CborMapType : CborArrayType;
+                return CborNoError;
+            }
+        }
+
+        /* read the item's header, saving it if it's split across fragments */
+        if (parser->headerLength == 0 && avail && avail >= header_length(*parser->ptr)) {
+            header = parser->ptr;
+        } else {
+            if (!avail)
+                return CborErrorUnexpectedEOF;
+            if (parser->headerLength == 0)
+                parser->header[parser->headerLength++] = *parser->ptr++;
+
+            len = header_length(parser->header[0]) - parser->headerLength;
+            if (len > (size_t)(parser->end - parser->ptr))
+                len = (size_t)(parser->end - parser->ptr);
+            memcpy(parser->header + parser->headerLength, parser->ptr, len);
+            parser->ptr += len;
+            parser->headerLength += len;
+            if (parser->headerLength < header_length(parser->header[0]))
+                return CborErrorUnexpectedEOF;
+            header = parser->header;
+        }
+
+        descriptor = header[0];
+        majortype = descriptor >> MajorTypeShift;
+        len = header_length(descriptor);
+        if (unlikely(len == 0))
+            return majortype == SimpleTypesType ? CborErrorUnknownType : CborErrorIllegalNumber;
+        value = header_value(header);
+        if (header == parser->header)
+            parser->headerLength = 0;
+        else
+            parser->ptr += len;
+
+        if (parser->state & StreamIndefiniteString) {
+            /* only definite-length chunks of the same type may follow */
+            if (descriptor == BreakByte)
+                return end_string(parser, event);
+            if ((descriptor & MajorTypeMask) != parser->stringType ||
+                    (descriptor & SmallValueMask) == IndefiniteLength)
+                return CborErrorIllegalType;
+            parser->stringRemaining = value;
+            parser->state |= StreamInStringChunk;
+            continue;
+        }
+
+        if (descriptor == BreakByte) {
+            uint32_t level = parser->depth - 1;
+            if (parser->depth == 0 || parser->state & StreamAfterTag ||
+                    (parser->levelFlags[level] & (LevelIsIndefinite | LevelHasPendingValue)) != LevelIsIndefinite)
+                return CborErrorUnexpectedBreak;
+            --parser->depth;
+            event->event = CborStreamContainerEnd;
+            event->type = parser->levelFlags[level] & LevelIsMap ? CborMapType : CborArrayType;
+            return CborNoError;
+        }
+
+        if ((descriptor & SmallValueMask) == IndefiniteLength) {
+            if (majortype < ByteStringType || majortype > MapType)
+                return CborErrorIllegalNumber;
+            event->flags = CborStreamFlag_IndefiniteLength;
+            value = 0;
+        }
+
+        event->event = CborStreamValue;
+        event->type = descriptor & MajorTypeMask;
+        event->value = value;
+        switch ((CborMajorTypes)majortype) {
+        case NegativeIntegerType:
+            event->flags = CborStreamFlag_NegativeInteger;
+            event->type = CborIntegerType;
+            /* fall through */
+        case UnsignedIntegerType:
+            break;
+
+        case ByteStringType:
+        case TextStringType:
+            count_item(parser);
+            event->event = CborStreamStringStart;
+            parser->stringType = event->type;
+            parser->state |= StreamInString;
+            if (event->flags & CborStreamFlag_IndefiniteLength) {
+                parser->state |= StreamIndefiniteString;
+            } else {
+                parser->state |= StreamInStringChunk;
+                parser->stringRemaining = value;
+            }
+            return CborNoError;
+
+        case ArrayType:
+        case MapType:
+            if (parser->depth == CBOR_STREAM_PARSER_MAX_DEPTH)
+                return CborErrorNestingTooDeep;
+            if (majortype == MapType && value > UINT64_MAX / 2)
+                return CborErrorDataTooLarge;
+            count_item(parser);
+            event->event = CborStreamContainerStart;
+            parser->levelFlags[parser->depth] = (majortype == MapType ? LevelIsMap : 0) |
+                    (event->flags & CborStreamFlag_IndefiniteLength ? LevelIsIndefinite : 0);
+            parser->remaining[parser->depth] = majortype == MapType ? value * 2 : value;
+            ++parser->depth;
+            return CborNoError;
+
+        case TagType:
+            /* tags don't count as items: the tagged item does */
+            parser->state |= StreamAfterTag;
+            return CborNoError;
+
+        case SimpleTypesType:
+            switch (descriptor & SmallValueMask) {
+            case FalseValue:
+            case TrueValue:
+                event->type = CborBooleanType;
+                event->value = (descriptor & SmallValueMask) == TrueValue;
+                break;
+            case NullValue:
+            case UndefinedValue:
+            case HalfPrecisionFloat:
+            case SinglePrecisionFloat:
+            case DoublePrecisionFloat:
+                event->type = descriptor;
+                break;
+            case SimpleTypeInNextByte:
+#ifndef CBOR_PARSER_NO_STRICT_CHECKS
+                if (unlikely(value < 32))
+                    return CborErrorIllegalSimpleType;
+#endif
+                break;
+            }
+            break;
+        }
+
+        count_item(parser);
+        return CborNoError;
+    }
+}
+
+/** @} */
@@ -35,9 +35,10 @@
 #include "cborinternal_p.h"
 #include "compilersupport_p.h"
 #include "cborinternal_p.h"
+#include "utf8_p.h"
 #include <memory.h>
 
-#include <inttypes.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -46,7 +47,7 @@
  * \defgroup CborToJson Converting CBOR to JSON
  * \brief Group of functions used to convert CBOR to JSON.
  *
- * This group contains two functions that can be used to convert a \ref
+ * This group contains functions that can be used to convert a \ref
  * CborValue object to an equivalent JSON representation. This module attempts
  * to follow the recommendations from RFC 7049 section 4.1 "Converting from
  * CBOR to JSON", though it has a few differences. They are noted below.
@@ -60,21 +61,25 @@
  * of metadata JSON values that can be used by a JSON-to-CBOR converter to
  * restore the original data types.
  *
- * The TinyCBOR library does not provide a way to convert from JSON
- * representation back to encoded form. However, it provides a tool called
- * \c json2cbor which can be used for that purpose. That tool supports the
- * metadata format that these functions may produce.
+ * The conversion back from JSON to encoded form is provided by
+ * cbor_encode_from_json() and cbor_encode_from_json_buffer() (see
+ * CborFromJson), which understand the metadata format that these functions
+ * may produce. The \c json2cbor tool is a command-line front-end to them.
  *
- * Either of the functions in this section will attempt to convert exactly one
- * CborValue object to JSON. Those functions may return any error documented
- * for the functions for CborParsing. In addition, if the C standard library
- * stream functions return with error, the text conversion will return with
- * error CborErrorIO.
+ * The functions in this section write either to a C standard library stream
+ * or, more efficiently, to a CborGrowableBuffer in memory. Each of them will
+ * attempt to convert exactly one CborValue object to JSON. Those functions may
+ * return any error documented for the functions for CborParsing. In addition,
+ * if the C standard library stream functions return with error, the text
+ * conversion will return with error CborErrorIO, and if the memory buffer
+ * cannot grow, with CborErrorOutOfMemory.
  *
  * These functions also perform UTF-8 validation in CBOR text strings. If they
  * encounter a sequence of bytes that is not permitted in UTF-8, they will return
  * CborErrorInvalidUtf8TextString. That includes encoding of surrogate points
- * in UTF-8.
+ * in UTF-8. Quotation marks, backslashes and control characters in text
+ * strings are escaped as JSON requires; all other characters are copied as
+ * they are.
  *
  * \warning The metadata produced by these functions is not guaranteed to
  * remain stable. A future update of TinyCBOR may produce different output for
@@ -131,8 +136,8 @@
  * default, if a non-string key is found, the conversion fails with error
  * CborErrorJsonObjectKeyNotString. If the CborConvertStringifyMapKeys option
  * is active, then the conversion attempts to create a string representation
- * using CborPretty. Note that the \c json2cbor tool is not able to parse this
- * back to the original form.
+ * using CborPretty. Note that the JSON-to-CBOR conversion is not able to parse
+ * this back to the original form.
  *
  * \par Duplicate keys in maps:
  * Neither JSON nor CBOR allow duplicated keys, but current TinyCBOR does not
@@ -148,8 +153,6 @@
  * the keys for the metadata clash with existing keys in the JSON map.
  */
 
-extern FILE *open_memstream(char **bufptr, size_t *sizeptr);
-
 enum ConversionStatusFlags {
     TypeWasNotNative            = 0x100,    /* anything but strings, boolean, null, arrays and maps */
     TypeWasTagged               = 0x200,
@@ -167,165 +170,717 @@ typedef struct ConversionStatus {
     int flags;
 } ConversionStatus;
 
-static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType type, ConversionStatus *status);
+/* The output goes to the window [ptr, end), which is either the free space
+ * of a CborGrowableBuffer or a staging buffer that is flushed to a FILE. */
+typedef struct JsonOutput {
+    char *ptr;
+    char *end;
+    CborGrowableBuffer *buffer;
+    FILE *file;
+    char *staging;
+} JsonOutput;
+
+enum {
+    JsonStagingBufferSize = 512,
+    MaxJsonNumberSize = 32          /* "-1.2345678901234567e-308" and 2^64 fit */
+};
+
+static CborError value_to_json(JsonOutput *out, CborValue *it, int flags, CborType type, ConversionStatus *status);
 
-static CborError dump_bytestring_base16(char **result, CborValue *it)
+static CborError json_flush(JsonOutput *out, size_t needed)
 {
-    static const char characters[] = "0123456789abcdef";
-    size_t i;
-    size_t n = 0;
-    uint8_t *buffer;
-    CborError err = cbor_value_calculate_string_length(it, &n);
-    if (err)
-        return err;
+    if (out->buffer) {
+        CborGrowableBuffer *buffer = out->buffer;
+        CborError err;
+        buffer->size = (size_t)(out->ptr - (char *)buffer->data);
+        err = cbor_growable_buffer_reserve(buffer, needed);
+        if (err)
+            return err;
+        out->ptr = (char *)buffer->data + buffer->size;
+        out->end = (char *)buffer->data + buffer->capacity;
+    } else {
+        size_t len = (size_t)(out->ptr - out->staging);
+        if (len && fwrite(out->staging, 1, len, out->file) != len)
+            return CborErrorIO;
+        out->ptr = out->staging;
+    }
+    return CborNoError;
+}
+
+/* makes room for \a len bytes at out->ptr; \a len must not exceed
+ * JsonStagingBufferSize */
+static inline CborError json_reserve(JsonOutput *out, size_t len)
+{
+    if (likely((size_t)(out->end - out->ptr) >= len))
+        return CborNoError;
+    return json_flush(out, len);
+}
 
-    /* a Base16 (hex) output is twice as big as our buffer */
-    buffer = (uint8_t *)cbor_malloc(n * 2 + 1);
-    if (buffer == NULL)
-        /* out of memory */
-        return CborErrorOutOfMemory;
+static CborError json_write(JsonOutput *out, const char *data, size_t len)
+{
+    if (unlikely((size_t)(out->end - out->ptr) < len)) {
+        CborError err = json_flush(out, len);
+        if (err)
+            return err;
+        if (!out->buffer && len > JsonStagingBufferSize)
+            return fwrite(data, 1, len, out->file) == len ? CborNoError : CborErrorIO;
+    }
+    memcpy(out->ptr, data, len);
+    out->ptr += len;
+    return CborNoError;
+}
 
-    *result = (char *)buffer;
+#define json_write_literal(out, str)    json_write(out, str, sizeof(str) - 1)
 
-    /* let cbor_value_copy_byte_string know we have an extra byte for the terminating NUL */
-    ++n;
-    err = cbor_value_copy_byte_string(it, buffer + n - 1, &n, it);
-    cbor_assert(err == CborNoError);
+static inline CborError json_put_char(JsonOutput *out, char c)
+{
+    CborError err = json_reserve(out, 1);
+    if (likely(!err))
+        *out->ptr++ = c;
+    return err;
+}
 
-    for (i = 0; i < n; ++i) {
-        uint8_t byte = buffer[n + i];
-        buffer[2*i]     = characters[byte >> 4];
-        buffer[2*i + 1] = characters[byte & 0xf];
+static char *write_escaped_char(char *p, uint8_t c)
+{
+    static const char characters[] = "0123456789ABCDEF";
+    *p++ = '\\';
+    if (c == '"' || c == '\\') {
+        *p++ = (char)c;
+    } else if (c >= '\b' && c <= '\r' && c != '\v') {
+        *p++ = "btn\0fr"[c - '\b'];
+    } else {
+        memcpy(p, "u00", 3);
+        p[3] = characters[c >> 4];
+        p[4] = characters[c & 0xf];
+        p += 5;
     }
-    return CborNoError;
+    return p;
 }
 
-static CborError generic_dump_base64(char **result, CborValue *it, const char alphabet[65])
+/* copies clean runs in bulk and escapes the bytes in between */
+static CborError json_write_escaped(JsonOutput *out, const char *str, size_t len)
 {
-    size_t n = 0, i;
-    uint8_t *buffer, *out, *in;
-    CborError err = cbor_value_calculate_string_length(it, &n);
-    if (err)
-        return err;
+    const uint8_t *ptr = (const uint8_t *)str;
+    const uint8_t *end = ptr + len;
+    for (;;) {
+        size_t n = count_json_unescaped(ptr, end);
+        CborError err = json_write(out, (const char *)ptr, n);
+        if (err)
+            return err;
+        ptr += n;
+        if (ptr == end)
+            return CborNoError;
 
-    /* a Base64 output (untruncated) has 4 bytes for every 3 in the input */
-    size_t len = (n + 5) / 3 * 4;
-    buffer = (uint8_t *)cbor_malloc(len + 1);
-    if (buffer == NULL)
-        /* out of memory */
-        return CborErrorOutOfMemory;
+        err = json_reserve(out, 6);
+        if (err)
+            return err;
+        out->ptr = write_escaped_char(out->ptr, *ptr++);
+    }
+}
 
-    out = buffer;
-    *result = (char *)buffer;
+static const char decimalDigitPairs[] =
+        "00010203040506070809" "10111213141516171819"
+        "20212223242526272829" "30313233343536373839"
+        "40414243444546474849" "50515253545556575859"
+        "60616263646566676869" "70717273747576777879"
+        "80818283848586878889" "90919293949596979899";
 
-    /* we read our byte string at the tail end of the buffer
-     * so we can do an in-place conversion while iterating forwards */
-    in = buffer + len - n;
+static char *write_decimal(char *p, uint64_t value)
+{
+    char buf[20];
+    char *q = buf + sizeof(buf);
+    size_t len;
+
+    /* two digits at a time, from the end */
+    while (value >= 100) {
+        unsigned i = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--q = decimalDigitPairs[i + 1];
+        *--q = decimalDigitPairs[i];
+    }
+    if (value >= 10) {
+        unsigned i = (unsigned)value * 2;
+        *--q = decimalDigitPairs[i + 1];
+        *--q = decimalDigitPairs[i];
+    } else {
+        *--q = (char)('0' + value);
+    }
 
-    /* let cbor_value_copy_byte_string know we have an extra byte for the terminating NUL */
-    ++n;
-    err = cbor_value_copy_byte_string(it, in, &n, it);
-    cbor_assert(err == CborNoError);
+    len = (size_t)(buf + sizeof(buf) - q);
+    memcpy(p, q, len);
+    return p + len;
+}
 
-    uint_least32_t val = 0;
-    for (i = 0; n - i >= 3; i += 3) {
-        /* read 3 bytes x 8 bits = 24 bits */
-        if (false) {
+static char *write_hex(char *p, uint64_t value)
+{
+    static const char characters[] = "0123456789abcdef";
+    int shift = 60;
+    while (shift && (value >> shift) == 0)
+        shift -= 4;
+    for ( ; shift >= 0; shift -= 4)
+        *p++ = characters[(value >> shift) & 0xf];
+    return p;
+}
+
+static CborError json_write_uint(JsonOutput *out, uint64_t value)
+{
+    CborError err = json_reserve(out, MaxJsonNumberSize);
+    if (likely(!err))
+        out->ptr = write_decimal(out->ptr, value);
+    return err;
+}
+
+#ifndef CBOR_NO_FLOATING_POINT
+/*
+ * Shortest round-trip formatting of doubles, using the Grisu2 algorithm from
+ * F. Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+ * Integers" (PLDI 2010). It produces the shortest decimal representation
+ * that reads back as the same double in the vast majority of cases, and
+ * otherwise one that is a digit longer, but always one that reads back
+ * correctly.
+ */
+typedef struct DiyFp {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+typedef struct CachedPower {
+    uint64_t f;
+    int16_t e;
+    int16_t k;
+} CachedPower;
+
+enum {
+    GrisuAlpha = -60,
+    GrisuGamma = -32,
+    CachedPowersMinDecimalExponent = -300,
+    CachedPowersDecimalStep = 8,
+    MaxGrisuDigits = 18
+};
+
+/* normalized 64-bit approximations of 10^k, for k = -300, -292, ..., 324 */
+static const CachedPower cachedPowers[] = {
+    { UINT64_C(0xAB70FE17C79AC6CA), -1060, -300 },
+    { UINT64_C(0xFF77B1FCBEBCDC4F), -1034, -292 },
+    { UINT64_C(0xBE5691EF416BD60C), -1007, -284 },
+    { UINT64_C(0x8DD01FAD907FFC3C),  -980, -276 },
+    { UINT64_C(0xD3515C2831559A83),  -954, -268 },
+    { UINT64_C(0x9D71AC8FADA6C9B5),  -927, -260 },
+    { UINT64_C(0xEA9C227723EE8BCB),  -901, -252 },
+    { UINT64_C(0xAECC49914078536D),  -874, -244 },
+    { UINT64_C(0x823C12795DB6CE57),  -847, -236 },
+    { UINT64_C(0xC21094364DFB5637),  -821, -228 },
+    { UINT64_C(0x9096EA6F3848984F),  -794, -220 },
+    { UINT64_C(0xD77485CB25823AC7),  -768, -212 },
+    { UINT64_C(0xA086CFCD97BF97F4),  -741, -204 },
+    { UINT64_C(0xEF340A98172AACE5),  -715, -196 },
+    { UINT64_C(0xB23867FB2A35B28E),  -688, -188 },
+    { UINT64_C(0x84C8D4DFD2C63F3B),  -661, -180 },
+    { UINT64_C(0xC5DD44271AD3CDBA),  -635, -172 },
+    { UINT64_C(0x936B9FCEBB25C996),  -608, -164 },
+    { UINT64_C(0xDBAC6C247D62A584),  -582, -156 },
+    { UINT64_C(0xA3AB66580D5FDAF6),  -555, -148 },
+    { UINT64_C(0xF3E2F893DEC3F126),  -529, -140 },
+    { UINT64_C(0xB5B5ADA8AAFF80B8),  -502, -132 },
+    { UINT64_C(0x87625F056C7C4A8B),  -475, -124 },
+    { UINT64_C(0xC9BCFF6034C13053),  -449, -116 },
+    { UINT64_C(0x964E858C91BA2655),  -422, -108 },
+    { UINT64_C(0xDFF9772470297EBD),  -396, -100 },
+    { UINT64_C(0xA6DFBD9FB8E5B88F),  -369,  -92 },
+    { UINT64_C(0xF8A95FCF88747D94),  -343,  -84 },
+    { UINT64_C(0xB94470938FA89BCF),  -316,  -76 },
+    { UINT64_C(0x8A08F0F8BF0F156B),  -289,  -68 },
+    { UINT64_C(0xCDB02555653131B6),  -263,  -60 },
+    { UINT64_C(0x993FE2C6D07B7FAC),  -236,  -52 },
+    { UINT64_C(0xE45C10C42A2B3B06),  -210,  -44 },
+    { UINT64_C(0xAA242499697392D3),  -183,  -36 },
+    { UINT64_C(0xFD87B5F28300CA0E),  -157,  -28 },
+    { UINT64_C(0xBCE5086492111AEB),  -130,  -20 },
+    { UINT64_C(0x8CBCCC096F5088CC),  -103,  -12 },
+    { UINT64_C(0xD1B71758E219652C),   -77,   -4 },
+    { UINT64_C(0x9C40000000000000),   -50,    4 },
+    { UINT64_C(0xE8D4A51000000000),   -24,   12 },
+    { UINT64_C(0xAD78EBC5AC620000),     3,   20 },
+    { UINT64_C(0x813F3978F8940984),    30,   28 },
+    { UINT64_C(0xC097CE7BC90715B3),    56,   36 },
+    { UINT64_C(0x8F7E32CE7BEA5C70),    83,   44 },
+    { UINT64_C(0xD5D238A4ABE98068),   109,   52 },
+    { UINT64_C(0x9F4F2726179A2245),   136,   60 },
+    { UINT64_C(0xED63A231D4C4FB27),   162,   68 },
+    { UINT64_C(0xB0DE65388CC8ADA8),   189,   76 },
+    { UINT64_C(0x83C7088E1AAB65DB),   216,   84 },
+    { UINT64_C(0xC45D1DF942711D9A),   242,   92 },
+    { UINT64_C(0x924D692CA61BE758),   269,  100 },
+    { UINT64_C(0xDA01EE641A708DEA),   295,  108 },
+    { UINT64_C(0xA26DA3999AEF774A),   322,  116 },
+    { UINT64_C(0xF209787BB47D6B85),   348,  124 },
+    { UINT64_C(0xB454E4A179DD1877),   375,  132 },
+    { UINT64_C(0x865B86925B9BC5C2),   402,  140 },
+    { UINT64_C(0xC83553C5C8965D3D),   428,  148 },
+    { UINT64_C(0x952AB45CFA97A0B3),   455,  156 },
+    { UINT64_C(0xDE469FBD99A05FE3),   481,  164 },
+    { UINT64_C(0xA59BC234DB398C25),   508,  172 },
+    { UINT64_C(0xF6C69A72A3989F5C),   534,  180 },
+    { UINT64_C(0xB7DCBF5354E9BECE),   561,  188 },
+    { UINT64_C(0x88FCF317F22241E2),   588,  196 },
+    { UINT64_C(0xCC20CE9BD35C78A5),   614,  204 },
+    { UINT64_C(0x98165AF37B2153DF),   641,  212 },
+    { UINT64_C(0xE2A0B5DC971F303A),   667,  220 },
+    { UINT64_C(0xA8D9D1535CE3B396),   694,  228 },
+    { UINT64_C(0xFB9B7CD9A4A7443C),   720,  236 },
+    { UINT64_C(0xBB764C4CA7A44410),   747,  244 },
+    { UINT64_C(0x8BAB8EEFB6409C1A),   774,  252 },
+    { UINT64_C(0xD01FEF10A657842C),   800,  260 },
+    { UINT64_C(0x9B10A4E5E9913129),   827,  268 },
+    { UINT64_C(0xE7109BFBA19C0C9D),   853,  276 },
+    { UINT64_C(0xAC2820D9623BF429),   880,  284 },
+    { UINT64_C(0x80444B5E7AA7CF85),   907,  292 },
+    { UINT64_C(0xBF21E44003ACDD2D),   933,  300 },
+    { UINT64_C(0x8E679C2F5E44FF8F),   960,  308 },
+    { UINT64_C(0xD433179D9C8CB841),   986,  316 },
+    { UINT64_C(0x9E19DB92B4E31BA9),  1013,  324 },
+};
+
+static inline DiyFp diyfp_normalize(DiyFp x)
+{
 #ifdef __GNUC__
-        } else if (i) {
-            __builtin_memcpy(&val, in + i - 1, sizeof(val));
-            val = cbor_ntohl(val);
+    int shift = __builtin_clzll(x.f);
+    x.f <<= shift;
+    x.e -= shift;
+#else
+    while ((x.f >> 63) == 0) {
+        x.f <<= 1;
+        --x.e;
+    }
 #endif
-        } else {
-            val = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    return x;
+}
+
+/* the upper 64 bits of the 128-bit product, rounded */
+static inline DiyFp diyfp_mul(DiyFp x, DiyFp y)
+{
+    const uint64_t mask = 0xffffffffU;
+    uint64_t a = x.f >> 32, b = x.f & mask;
+    uint64_t c = y.f >> 32, d = y.f & mask;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t mid = (bd >> 32) + (ad & mask) + (bc & mask) + (UINT64_C(1) << 31);
+    DiyFp r;
+    r.f = ac + (ad >> 32) + (bc >> 32) + (mid >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+static inline int largest_pow10(uint32_t n, uint32_t *pow10)
+{
+    int digits = 10;
+    uint32_t p = 1000000000U;
+    while (n < p) {
+        p /= 10;
+        --digits;
+    }
+    *pow10 = p;
+    return digits;
+}
+
+static void grisu2_round(char *digits, int len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t tenK)
+{
+    /* move the last digit towards the exact value while staying in range */
+    while (rest < dist && delta - rest >= tenK &&
+           (rest + tenK < dist || dist - rest > rest + tenK - dist)) {
+        --digits[len - 1];
+        rest += tenK;
+    }
+}
+
+/* Stores in \a digits the decimal digits of \a value, which must be finite
+ * and positive, and returns how many there are. The value is those digits
+ * multiplied by 10^*exponent. */
+static int grisu2(char *digits, int *exponent, double value)
+{
+    uint64_t bits, mantissa, delta, dist, one, p2, rest;
+    uint32_t p1, pow10;
+    int biasedExponent, shift, n, len = 0;
+    DiyFp v, w, mPlus, mMinus;
+    const CachedPower *cached;
+
+    memcpy(&bits, &value, sizeof(bits));
+    mantissa = bits & ((UINT64_C(1) << 52) - 1);
+    biasedExponent = (int)(bits >> 52);
+    if (biasedExponent == 0) {
+        v.f = mantissa;
+        v.e = 1 - 1075;
+    } else {
+        v.f = mantissa | (UINT64_C(1) << 52);
+        v.e = biasedExponent - 1075;
+    }
+
+    /* the boundaries halfway to the neighbouring doubles; the lower one is
+     * closer if the mantissa is a power of two */
+    mPlus.f = 2 * v.f + 1;
+    mPlus.e = v.e - 1;
+    if (mantissa == 0 && biasedExponent > 1) {
+        mMinus.f = 4 * v.f - 1;
+        mMinus.e = v.e - 2;
+    } else {
+        mMinus.f = 2 * v.f - 1;
+        mMinus.e = v.e - 1;
+    }
+    mPlus = diyfp_normalize(mPlus);
+    mMinus.f <<= mMinus.e - mPlus.e;
+    mMinus.e = mPlus.e;
+    v = diyfp_normalize(v);
+
+    /* scale by a cached power of ten c = 10^-k so the exponent of the
+     * boundaries ends up in [GrisuAlpha, GrisuGamma] */
+    {
+        int f = GrisuAlpha - mPlus.e - 1;
+        int k = (f * 78913) / (1 << 18) + (f > 0);     /* ceil(f * log10(2)) */
+        int index = (-CachedPowersMinDecimalExponent + k + (CachedPowersDecimalStep - 1)) /
+                CachedPowersDecimalStep;
+        DiyFp c;
+        cached = &cachedPowers[index];
+        c.f = cached->f;
+        c.e = cached->e;
+        w = diyfp_mul(v, c);
+        mPlus = diyfp_mul(mPlus, c);
+        mMinus = diyfp_mul(mMinus, c);
+        *exponent = -cached->k;
+    }
+
+    /* shrink the interval by one unit on each side to account for the
+     * imprecision of the multiplication */
+    mPlus.f -= 1;
+    mMinus.f += 1;
+
+    delta = mPlus.f - mMinus.f;
+    dist = mPlus.f - w.f;
+    shift = -mPlus.e;
+    one = UINT64_C(1) << shift;
+    p1 = (uint32_t)(mPlus.f >> shift);      /* integral part */
+    p2 = mPlus.f & (one - 1);               /* fractional part */
+
+    n = largest_pow10(p1, &pow10);
+    while (n > 0) {
+        digits[len++] = (char)('0' + p1 / pow10);
+        p1 %= pow10;
+        --n;
+        rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta) {
+            *exponent += n;
+            grisu2_round(digits, len, dist, delta, rest, (uint64_t)pow10 << shift);
+            return len;
         }
+        pow10 /= 10;
+    }
 
-        /* write 4 chars x 6 bits = 24 bits */
-        *out++ = alphabet[(val >> 18) & 0x3f];
-        *out++ = alphabet[(val >> 12) & 0x3f];
-        *out++ = alphabet[(val >> 6) & 0x3f];
-        *out++ = alphabet[val & 0x3f];
+    for (;;) {
+        p2 *= 10;
+        digits[len++] = (char)('0' + (p2 >> shift));
+        p2 &= one - 1;
+        delta *= 10;
+        dist *= 10;
+        --*exponent;
+        if (p2 <= delta)
+            break;
     }
+    grisu2_round(digits, len, dist, delta, p2, one);
+    return len;
+}
 
-    /* maybe 1 or 2 bytes left */
-    if (n - i) {
-        /* we can read in[i + 1] even if it's past the end of the string because
-         * we know (by construction) that it's a NUL byte */
-#ifdef __GNUC__
-        uint16_t val16;
-        __builtin_memcpy(&val16, in + i, sizeof(val16));
-        val = cbor_ntohs(val16);
-#else
-        val = (in[i] << 8) | in[i + 1];
-#endif
-        val <<= 8;
-
-        /* the 65th character in the alphabet is our filler: either '=' or '\0' */
-        out[4] = '\0';
-        out[3] = alphabet[64];
-        if (n - i == 2) {
-            /* write the third char in 3 chars x 6 bits = 18 bits */
-            out[2] = alphabet[(val >> 6) & 0x3f];
-        } else {
-            out[2] = alphabet[64];  /* filler */
+/* Writes \a value, which must be finite, in the shortest form that reads back
+ * as the same double. The layout is that of printf's "%.17g". */
+static char *write_double(char *p, double value)
+{
+    char digits[MaxGrisuDigits + 2];
+    int exponent, point, len, i;
+
+    if (value < 0) {
+        *p++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        *p++ = '0';
+        return p;
+    }
+
+    len = grisu2(digits, &exponent, value);
+    while (len > 1 && digits[len - 1] == '0') {
+        --len;
+        ++exponent;
+    }
+    point = len + exponent;     /* position of the decimal point in the digits */
+
+    if (point > -4 && point <= 17) {
+        if (point <= 0) {
+            *p++ = '0';
+            *p++ = '.';
+            for (i = point; i < 0; ++i)
+                *p++ = '0';
+            memcpy(p, digits, (size_t)len);
+            return p + len;
         }
-        out[1] = alphabet[(val >> 12) & 0x3f];
-        out[0] = alphabet[(val >> 18) & 0x3f];
-    } else {
-        out[0] = '\0';
+        if (point >= len) {
+            memcpy(p, digits, (size_t)len);
+            p += len;
+            for (i = len; i < point; ++i)
+                *p++ = '0';
+            return p;
+        }
+        memcpy(p, digits, (size_t)point);
+        p += point;
+        *p++ = '.';
+        memcpy(p, digits + point, (size_t)(len - point));
+        return p + len - point;
     }
 
-    return CborNoError;
+    /* scientific notation, with at least two exponent digits */
+    *p++ = digits[0];
+    if (len > 1) {
+        *p++ = '.';
+        memcpy(p, digits + 1, (size_t)(len - 1));
+        p += len - 1;
+    }
+    *p++ = 'e';
+    exponent = point - 1;
+    *p++ = exponent < 0 ? '-' : '+';
+    if (exponent < 0)
+        exponent = -exponent;
+    if (exponent < 10)
+        *p++ = '0';
+    return write_decimal(p, (uint64_t)exponent);
+}
+#endif /* !CBOR_NO_FLOATING_POINT */
+
+/* Writes \a value, which must be a non-negative integral double, in full.
+ * It may be 2^64, which does not fit in a uint64_t. */
+static char *write_integral_double(char *p, double value)
+{
+    static const char twoTo64[] = "18446744073709551616";
+    if (value >= 18446744073709551616.0) {
+        memcpy(p, twoTo64, sizeof(twoTo64) - 1);
+        return p + sizeof(twoTo64) - 1;
+    }
+    return write_decimal(p, (uint64_t)value);
+}
+
+static const char base64Alphabet[] = "ABCDEFGH" "IJKLMNOP" "QRSTUVWX" "YZabcdef"
+                                     "ghijklmn" "opqrstuv" "wxyz0123" "456789+/" "=";
+static const char base64UrlAlphabet[] = "ABCDEFGH" "IJKLMNOP" "QRSTUVWX" "YZabcdef"
+                                        "ghijklmn" "opqrstuv" "wxyz0123" "456789-_";
+
+#if defined(__SSE2__)
+/* converts 16 nibbles to lowercase hex digits */
+static inline __m128i base16_digits(__m128i nibbles)
+{
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+#endif
+
+static char *encode_base16(char *out, const uint8_t *in, size_t n)
+{
+    static const char characters[] = "0123456789abcdef";
+#if defined(__SSE2__)
+    for ( ; n >= 16; n -= 16, in += 16, out += 32) {
+        __m128i input = _mm_loadu_si128((const __m128i *)in);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(input, 4), _mm_set1_epi8(0xf));
+        __m128i low = _mm_and_si128(input, _mm_set1_epi8(0xf));
+        _mm_storeu_si128((__m128i *)out, base16_digits(_mm_unpacklo_epi8(high, low)));
+        _mm_storeu_si128((__m128i *)(out + 16), base16_digits(_mm_unpackhi_epi8(high, low)));
+    }
+#endif
+    for ( ; n; --n, ++in) {
+        *out++ = characters[*in >> 4];
+        *out++ = characters[*in & 0xf];
+    }
+    return out;
+}
+
+#if defined(__SSSE3__) || defined(CBOR_UTF8_DISPATCH)
+/* twelve bytes in, sixteen characters out, see "Faster Base64 Encoding and
+ * Decoding Using AVX2 Instructions" by Muła and Lemire. The load reads four
+ * bytes past the group, so we need sixteen available. Returns the number of
+ * bytes left for the scalar loop. */
+UTF8_TARGET_SSSE3 static size_t encode_base64_ssse3(char **outp, const uint8_t **inp, size_t n, const char alphabet[65])
+{
+    char *out = *outp;
+    const uint8_t *in = *inp;
+    const __m128i shift = _mm_setr_epi8('A', 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        (char)(alphabet[62] - 62), (char)(alphabet[63] - 63), 0, 0);
+    for ( ; n >= 16; n -= 12, in += 12, out += 16) {
+        __m128i input = _mm_loadu_si128((const __m128i *)in);
+        input = _mm_shuffle_epi8(input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+        /* split each 24 bits into four 6-bit indices, one per byte */
+        __m128i ac = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)),
+                                     _mm_set1_epi32(0x04000040));
+        __m128i bd = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003f03f0)),
+                                     _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(ac, bd);
+
+        /* 0-25 select 0, 26-51 select 1, 52-61 select 2 to 11, 62 and 63 select 12 and 13 */
+        __m128i selector = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        selector = _mm_sub_epi8(selector, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+        _mm_storeu_si128((__m128i *)out, _mm_add_epi8(indices, _mm_shuffle_epi8(shift, selector)));
+    }
+    *outp = out;
+    *inp = in;
+    return n;
+}
+#endif
+
+/* encodes the n / 3 complete groups of three bytes at \a in, without padding */
+static char *encode_base64(char *out, const uint8_t *in, size_t n, const char alphabet[65])
+{
+#if defined(__SSSE3__)
+    n = encode_base64_ssse3(&out, &in, n, alphabet);
+#elif defined(CBOR_UTF8_DISPATCH)
+    if (n >= 16 && utf8_cpu_has_ssse3())
+        n = encode_base64_ssse3(&out, &in, n, alphabet);
+#endif
+    for ( ; n >= 3; n -= 3, in += 3) {
+        uint_least32_t val = ((uint_least32_t)in[0] << 16) | (in[1] << 8) | in[2];
+        *out++ = alphabet[(val >> 18) & 0x3f];
+        *out++ = alphabet[(val >> 12) & 0x3f];
+        *out++ = alphabet[(val >> 6) & 0x3f];
+        *out++ = alphabet[val & 0x3f];
+    }
+    return out;
 }
 
-static CborError dump_bytestring_base64(char **result, CborValue *it)
+/* encodes the final one or two bytes; the 65th character in the alphabet is
+ * our filler: either '=' or '\0' */
+static char *encode_base64_tail(char *out, const uint8_t *in, size_t n, const char alphabet[65])
 {
-    static const char alphabet[] = "ABCDEFGH" "IJKLMNOP" "QRSTUVWX" "YZabcdef"
-                                   "ghijklmn" "opqrstuv" "wxyz0123" "456789+/" "=";
-    return generic_dump_base64(result, it, alphabet);
+    uint_least32_t val = (uint_least32_t)in[0] << 16;
+    if (n == 2)
+        val |= in[1] << 8;
+    *out++ = alphabet[(val >> 18) & 0x3f];
+    *out++ = alphabet[(val >> 12) & 0x3f];
+    if (n == 2)
+        *out++ = alphabet[(val >> 6) & 0x3f];
+    else if (alphabet[64])
+        *out++ = alphabet[64];
+    if (alphabet[64])
+        *out++ = alphabet[64];
+    return out;
 }
 
-static CborError dump_bytestring_base64url(char **result, CborValue *it)
+/* Writes the byte string at \a it in Base16 (if \a alphabet is null), Base64 or
+ * Base64url, without the quotes, and advances \a it. The encoding happens
+ * straight from the parser's chunks into the output, carrying the bytes of an
+ * incomplete Base64 group from one chunk to the next. */
+static CborError byte_string_to_json(JsonOutput *out, CborValue *it, const char *alphabet)
 {
-    static const char alphabet[] = "ABCDEFGH" "IJKLMNOP" "QRSTUVWX" "YZabcdef"
-                                   "ghijklmn" "opqrstuv" "wxyz0123" "456789-_";
-    return generic_dump_base64(result, it, alphabet);
+    uint8_t carry[3];
+    size_t carried = 0;
+    CborError err = cbor_value_begin_string_iteration(it);
+    while (!err) {
+        const uint8_t *chunk;
+        size_t len;
+        err = cbor_value_get_byte_string_chunk(it, &chunk, &len, it);
+        if (err == CborErrorNoMoreStringChunks) {
+            err = cbor_value_finish_string_iteration(it);
+            if (!err && carried) {
+                err = json_reserve(out, 4);
+                if (!err)
+                    out->ptr = encode_base64_tail(out->ptr, carry, carried, alphabet);
+            }
+            return err;
+        }
+        if (err)
+            return err;
+
+        if (!alphabet) {
+            while (len) {
+                /* the staging buffer limits how much we can encode at once */
+                size_t n = out->buffer || len < JsonStagingBufferSize / 2 ? len : JsonStagingBufferSize / 2;
+                err = json_reserve(out, n * 2);
+                if (err)
+                    return err;
+                out->ptr = encode_base16(out->ptr, chunk, n);
+                chunk += n;
+                len -= n;
+            }
+            continue;
+        }
+
+        /* complete the group left over from the previous chunk */
+        while (carried && carried < 3 && len) {
+            carry[carried++] = *chunk++;
+            --len;
+        }
+        if (carried == 3) {
+            err = json_reserve(out, 4);
+            if (err)
+                return err;
+            out->ptr = encode_base64(out->ptr, carry, 3, alphabet);
+            carried = 0;
+        }
+
+        while (len >= 3) {
+            size_t n = out->buffer || len < JsonStagingBufferSize / 4 * 3 ? len : JsonStagingBufferSize / 4 * 3;
+            n -= n % 3;
+            err = json_reserve(out, n / 3 * 4);
+            if (err)
+                return err;
+            out->ptr = encode_base64(out->ptr, chunk, n, alphabet);
+            chunk += n;
+            len -= n;
+        }
+        while (len--)
+            carry[carried++] = *chunk++;
+    }
+    return err;
 }
 
-static CborError add_value_metadata(FILE *out, CborType type, const ConversionStatus *status)
+static CborError add_value_metadata(JsonOutput *out, CborType type, const ConversionStatus *status)
 {
+    CborError err;
     int flags = status->flags;
     if (flags & TypeWasTagged) {
         /* extract the tagged type, which may be JSON native */
         type = flags & FinalTypeMask;
         flags &= ~(FinalTypeMask | TypeWasTagged);
 
-        if (fprintf(out, "\"tag\":\"%" PRIu64 "\"%s", status->lastTag,
-                    flags & ~TypeWasTagged ? "," : "") < 0)
-            return CborErrorIO;
+        err = json_write_literal(out, "\"tag\":\"");
+        if (!err)
+            err = json_write_uint(out, status->lastTag);
+        if (!err)
+            err = flags & ~TypeWasTagged ? json_write_literal(out, "\",") : json_put_char(out, '"');
+        if (err)
+            return err;
     }
 
     if (!flags)
         return CborNoError;
 
     /* print at least the type */
-    if (fprintf(out, "\"t\":%d", type) < 0)
-        return CborErrorIO;
-
-    if (flags & NumberWasNaN)
-        if (fprintf(out, ",\"v\":\"nan\"") < 0)
-            return CborErrorIO;
-    if (flags & NumberWasInfinite)
-        if (fprintf(out, ",\"v\":\"%sinf\"", flags & NumberWasNegative ? "-" : "") < 0)
-            return CborErrorIO;
-    if (flags & NumberPrecisionWasLost)
-        if (fprintf(out, ",\"v\":\"%c%" PRIx64 "\"", flags & NumberWasNegative ? '-' : '+',
-                    status->originalNumber) < 0)
-            return CborErrorIO;
-    if (type == CborSimpleType)
-        if (fprintf(out, ",\"v\":%d", (int)status->originalNumber) < 0)
-            return CborErrorIO;
-    return CborNoError;
+    err = json_write_literal(out, "\"t\":");
+    if (!err)
+        err = json_write_uint(out, type);
+
+    if (!err && flags & NumberWasNaN)
+        err = json_write_literal(out, ",\"v\":\"nan\"");
+    if (!err && flags & NumberWasInfinite)
+        err = flags & NumberWasNegative ? json_write_literal(out, ",\"v\":\"-inf\"") :
+                                          json_write_literal(out, ",\"v\":\"inf\"");
+    if (!err && flags & NumberPrecisionWasLost) {
+        err = json_reserve(out, MaxJsonNumberSize);
+        if (!err) {
+            memcpy(out->ptr, ",\"v\":\"", 6);
+            out->ptr[6] = flags & NumberWasNegative ? '-' : '+';
+            out->ptr = write_hex(out->ptr + 7, status->originalNumber);
+            *out->ptr++ = '"';
+        }
+    }
+    if (!err && type == CborSimpleType) {
+        err = json_write_literal(out, ",\"v\":");
+        if (!err)
+            err = json_write_uint(out, status->originalNumber);
+    }
+    return err;
 }
 
 static CborError find_tagged_type(CborValue *it, CborTag *tag, CborType *type)
@@ -343,7 +898,7 @@ static CborError find_tagged_type(CborValue *it, CborTag *tag, CborType *type)
     return err;
 }
 
-static CborError tagged_value_to_json(FILE *out, CborValue *it, int flags, ConversionStatus *status)
+static CborError tagged_value_to_json(JsonOutput *out, CborValue *it, int flags, ConversionStatus *status)
 {
     CborTag tag;
     CborError err;
@@ -354,21 +909,34 @@ static CborError tagged_value_to_json(FILE *out, CborValue *it, int flags, Conve
         if (err)
             return err;
 
-        if (fprintf(out, "{\"tag%" PRIu64 "\":", tag) < 0)
-            return CborErrorIO;
+        err = json_write_literal(out, "{\"tag");
+        if (!err)
+            err = json_write_uint(out, tag);
+        if (!err)
+            err = json_write_literal(out, "\":");
+        if (err)
+            return err;
 
         CborType type = cbor_value_get_type(it);
         err = value_to_json(out, it, flags, type, status);
         if (err)
             return err;
         if (flags & CborConvertAddMetadata && status->flags) {
-            if (fprintf(out, ",\"tag%" PRIu64 "$cbor\":{", tag) < 0 ||
-                    add_value_metadata(out, type, status) != CborNoError ||
-                    fputc('}', out) < 0)
-                return CborErrorIO;
+            err = json_write_literal(out, ",\"tag");
+            if (!err)
+                err = json_write_uint(out, tag);
+            if (!err)
+                err = json_write_literal(out, "$cbor\":{");
+            if (!err)
+                err = add_value_metadata(out, type, status);
+            if (!err)
+                err = json_put_char(out, '}');
+            if (err)
+                return err;
         }
-        if (fputc('}', out) < 0)
-            return CborErrorIO;
+        err = json_put_char(out, '}');
+        if (err)
+            return err;
         status->flags = TypeWasNotNative | CborTagType;
         return CborNoError;
     }
@@ -382,21 +950,17 @@ static CborError tagged_value_to_json(FILE *out, CborValue *it, int flags, Conve
     /* special handling of byte strings? */
     if (type == CborByteStringType && (flags & CborConvertByteStringsToBase64Url) == 0 &&
             (tag == CborNegativeBignumTag || tag == CborExpectedBase16Tag || tag == CborExpectedBase64Tag)) {
-        char *str;
-        const char *pre = "";
-
-        if (tag == CborNegativeBignumTag) {
-            pre = "~";
-            err = dump_bytestring_base64url(&str, it);
-        } else if (tag == CborExpectedBase64Tag) {
-            err = dump_bytestring_base64(&str, it);
-        } else { /* tag == CborExpectedBase16Tag */
-            err = dump_bytestring_base16(&str, it);
-        }
-        if (err)
-            return err;
-        err = fprintf(out, "\"%s%s\"", pre, str) < 0 ? CborErrorIO : CborNoError;
-        cbor_free(str);
+        const char *alphabet = NULL;       /* tag == CborExpectedBase16Tag */
+        if (tag == CborNegativeBignumTag)
+            alphabet = base64UrlAlphabet;
+        else if (tag == CborExpectedBase64Tag)
+            alphabet = base64Alphabet;
+
+        err = tag == CborNegativeBignumTag ? json_write_literal(out, "\"~") : json_put_char(out, '"');
+        if (!err)
+            err = byte_string_to_json(out, it, alphabet);
+        if (!err)
+            err = json_put_char(out, '"');
         status->flags = TypeWasNotNative | TypeWasTagged | CborByteStringType;
         return err;
     }
@@ -407,97 +971,166 @@ static CborError tagged_value_to_json(FILE *out, CborValue *it, int flags, Conve
     return err;
 }
 
-static CborError stringify_map_key(char **key, CborValue *it, int flags, CborType type)
+/* Writes the contents of the text string at \a it, escaped but without the
+ * quotes, straight from the parser's buffer, and advances \a it */
+static CborError text_string_to_json(JsonOutput *out, CborValue *it)
 {
-    (void)flags;    /* unused */
-    (void)type;     /* unused */
-#ifdef WITHOUT_OPEN_MEMSTREAM
-    (void)key;      /* unused */
-    (void)it;       /* unused */
-    return CborErrorJsonNotImplemented;
-#else
-    size_t size;
+    CborError err = cbor_value_begin_string_iteration(it);
+    while (!err) {
+        const char *chunk;
+        size_t len;
+        err = cbor_value_get_text_string_chunk(it, &chunk, &len, it);
+        if (err == CborErrorNoMoreStringChunks)
+            return cbor_value_finish_string_iteration(it);
+        if (!err && !is_valid_utf8((const uint8_t *)chunk, len))
+            err = CborErrorInvalidUtf8TextString;
+        if (!err)
+            err = json_write_escaped(out, chunk, len);
+    }
+    return err;
+}
+
+static CborError stringify_printf(void *token, const char *fmt, ...)
+{
+    CborGrowableBuffer *buffer = (CborGrowableBuffer *)token;
+    CborError err;
+    va_list list;
+    int n;
 
-    FILE *memstream = open_memstream(key, &size);
-    if (memstream == NULL)
-        return CborErrorOutOfMemory;        /* could also be EMFILE, but it's unlikely */
-    CborError err = cbor_value_to_pretty_advance(memstream, it);
+    va_start(list, fmt);
+    n = vsnprintf(NULL, 0, fmt, list);
+    va_end(list);
+    if (n < 0)
+        return CborErrorIO;
 
-    if (unlikely(fclose(memstream) < 0 || *key == NULL))
-        return CborErrorInternalError;
+    /* vsnprintf needs room for the terminating NUL too */
+    err = cbor_growable_buffer_reserve(buffer, (size_t)n + 1);
+    if (err)
+        return err;
+    va_start(list, fmt);
+    vsnprintf((char *)buffer->data + buffer->size, (size_t)n + 1, fmt, list);
+    va_end(list);
+    buffer->size += (size_t)n;
+    return CborNoError;
+}
+
+static CborError stringify_map_key(CborGrowableBuffer *key, CborValue *it)
+{
+    CborError err;
+    cbor_growable_buffer_init(key, it->parser->allocator, 0);
+    err = cbor_value_to_pretty_stream(stringify_printf, key, it, CborPrettyDefaultFlags);
+    if (err)
+        cbor_growable_buffer_free(key);
     return err;
-#endif
 }
 
-static CborError array_to_json(FILE *out, CborValue *it, int flags, ConversionStatus *status)
+static CborError array_to_json(JsonOutput *out, CborValue *it, int flags, ConversionStatus *status)
 {
-    const char *comma = "";
+    CborError err;
+    bool first = true;
     while (!cbor_value_at_end(it)) {
-        if (fprintf(out, "%s", comma) < 0)
-            return CborErrorIO;
-        comma = ",";
+        if (!first) {
+            err = json_put_char(out, ',');
+            if (err)
+                return err;
+        }
+        first = false;
 
-        CborError err = value_to_json(out, it, flags, cbor_value_get_type(it), status);
+        err = value_to_json(out, it, flags, cbor_value_get_type(it), status);
         if (err)
             return err;
     }
     return CborNoError;
 }
 
-static CborError map_to_json(FILE *out, CborValue *it, int flags, ConversionStatus *status)
+static CborError map_to_json(JsonOutput *out, CborValue *it, int flags, ConversionStatus *status)
 {
-    const char *comma = "";
     CborError err;
+    bool first = true;
     while (!cbor_value_at_end(it)) {
-        char *key;
-        if (fprintf(out, "%s", comma) < 0)
-            return CborErrorIO;
-        comma = ",";
+        CborGrowableBuffer stringifiedKey;
+        char *key = NULL;
+        size_t keyLength = 0;
+        if (!first) {
+            err = json_put_char(out, ',');
+            if (err)
+                return err;
+        }
+        first = false;
 
         CborType keyType = cbor_value_get_type(it);
-        if (likely(keyType == CborTextStringType)) {
-            size_t n = 0;
-            err = cbor_value_dup_text_string(it, &key, &n, it);
-        } else if (flags & CborConvertStringifyMapKeys) {
-            err = stringify_map_key(&key, it, flags, keyType);
-        } else {
+        if (keyType != CborTextStringType && !(flags & CborConvertStringifyMapKeys))
             return CborErrorJsonObjectKeyNotString;
-        }
-        if (err)
-            return err;
 
         /* first, print the key */
-        if (fprintf(out, "\"%s\":", key) < 0) {
-            cbor_free(key);
-            return CborErrorIO;
+        err = json_put_char(out, '"');
+        if (err)
+            return err;
+        if (likely(keyType == CborTextStringType)) {
+            if (flags & CborConvertAddMetadata) {
+                /* keep a copy, in case the metadata needs it */
+                err = cbor_value_dup_text_string(it, &key, &keyLength, it);
+                if (!err && !is_valid_utf8((const uint8_t *)key, keyLength)) {
+                    cbor_deallocate_with(it->parser->allocator, key, keyLength + 1);
+                    err = CborErrorInvalidUtf8TextString;
+                }
+                if (err)
+                    return err;
+                err = json_write_escaped(out, key, keyLength);
+            } else {
+                err = text_string_to_json(out, it);
+                if (err)
+                    return err;
+            }
+        } else {
+            err = stringify_map_key(&stringifiedKey, it);
+            if (err)
+                return err;
+            key = (char *)stringifiedKey.data;
+            keyLength = stringifiedKey.size;
+            err = json_write_escaped(out, key, keyLength);
         }
+        if (!err)
+            err = json_write_literal(out, "\":");
 
         /* then, print the value */
         CborType valueType = cbor_value_get_type(it);
-        err = value_to_json(out, it, flags, valueType, status);
+        if (!err)
+            err = value_to_json(out, it, flags, valueType, status);
 
         /* finally, print any metadata we may have */
-        if (flags & CborConvertAddMetadata) {
-            if (!err && keyType != CborTextStringType) {
-                if (fprintf(out, ",\"%s$keycbordump\":true", key) < 0)
-                    err = CborErrorIO;
+        if (!err && flags & CborConvertAddMetadata) {
+            if (keyType != CborTextStringType) {
+                err = json_write_literal(out, ",\"");
+                if (!err)
+                    err = json_write_escaped(out, key, keyLength);
+                if (!err)
+                    err = json_write_literal(out, "$keycbordump\":true");
             }
             if (!err && status->flags) {
-                if (fprintf(out, ",\"%s$cbor\":{", key) < 0 ||
-                        add_value_metadata(out, valueType, status) != CborNoError ||
-                        fputc('}', out) < 0)
-                    err = CborErrorIO;
+                err = json_write_literal(out, ",\"");
+                if (!err)
+                    err = json_write_escaped(out, key, keyLength);
+                if (!err)
+                    err = json_write_literal(out, "$cbor\":{");
+                if (!err)
+                    err = add_value_metadata(out, valueType, status);
+                if (!err)
+                    err = json_put_char(out, '}');
             }
         }
 
-        cbor_free(key);
+        if (keyType != CborTextStringType)
+            cbor_growable_buffer_free(&stringifiedKey);
+        else if (key)
+            cbor_deallocate_with(it->parser->allocator, key, keyLength + 1);
         if (err)
             return err;
     }
     return CborNoError;
 }
 
-static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType type, ConversionStatus *status)
+static CborError value_to_json(JsonOutput *out, CborValue *it, int flags, CborType type, ConversionStatus *status)
 {
     CborError err;
     status->flags = 0;
@@ -512,8 +1145,9 @@ static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType typ
             copy_current_position(it, &recursed);
             return err;       /* parse error */
         }
-        if (fputc(type == CborArrayType ? '[' : '{', out) < 0)
-            return CborErrorIO;
+        err = json_put_char(out, type == CborArrayType ? '[' : '{');
+        if (err)
+            return err;
 
         err = (type == CborArrayType) ?
                   array_to_json(out, &recursed, flags, status) :
@@ -523,8 +1157,9 @@ static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType typ
             return err;       /* parse error */
         }
 
-        if (fputc(type == CborArrayType ? ']' : '}', out) < 0)
-            return CborErrorIO;
+        err = json_put_char(out, type == CborArrayType ? ']' : '}');
+        if (err)
+            return err;
         err = cbor_value_leave_container(it, &recursed);
         if (err)
             return err;       /* parse error */
@@ -535,43 +1170,54 @@ static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType typ
 
     case CborIntegerType: {
         double num;     /* JS numbers are IEEE double precision */
+        bool exact;
         uint64_t val;
         cbor_value_get_raw_integer(it, &val);    /* can't fail */
         num = (double)val;
+        exact = num < 18446744073709551616.0 && (uint64_t)num == val;
 
+        err = json_reserve(out, MaxJsonNumberSize);
+        if (err)
+            return err;
         if (cbor_value_is_negative_integer(it)) {
-            num = -num - 1;                     /* convert to negative */
-            if ((uint64_t)(-num - 1) != val) {
-                status->flags = NumberPrecisionWasLost | NumberWasNegative;
-                status->originalNumber = val;
-            }
+            /* the value is -1 - val, so it's val + 1 that must be exact
+             * (it wraps to zero for -2^64, which only the metadata can bring
+             * back as an integer) */
+            uint64_t magnitude = val + 1;
+            num = (double)magnitude;
+            exact = magnitude != 0 && num < 18446744073709551616.0 && (uint64_t)num == magnitude;
+            num = magnitude ? -num : -18446744073709551616.0;
+            status->flags = NumberWasNegative;
+            *out->ptr++ = '-';
+        }
+        if (!exact) {
+            status->flags |= NumberPrecisionWasLost;
+            status->originalNumber = val;
         } else {
-            if ((uint64_t)num != val) {
-                status->flags = NumberPrecisionWasLost;
-                status->originalNumber = val;
-            }
+            status->flags = 0;
         }
-        if (fprintf(out, "%.0f", num) < 0)  /* this number has no fraction, so no decimal points please */
-            return CborErrorIO;
+
+        /* this number has no fraction, so no decimal points please */
+        out->ptr = write_integral_double(out->ptr, fabs(num));
         break;
     }
 
     case CborByteStringType:
-    case CborTextStringType: {
-        char *str;
-        if (type == CborByteStringType) {
-            err = dump_bytestring_base64url(&str, it);
-            status->flags = TypeWasNotNative;
-        } else {
-            size_t n = 0;
-            err = cbor_value_dup_text_string(it, &str, &n, it);
-        }
-        if (err)
-            return err;
-        err = (fprintf(out, "\"%s\"", str) < 0) ? CborErrorIO : CborNoError;
-        cbor_free(str);
+        status->flags = TypeWasNotNative;
+        err = json_put_char(out, '"');
+        if (!err)
+            err = byte_string_to_json(out, it, base64UrlAlphabet);
+        if (!err)
+            err = json_put_char(out, '"');
+        return err;
+
+    case CborTextStringType:
+        err = json_put_char(out, '"');
+        if (!err)
+            err = text_string_to_json(out, it);
+        if (!err)
+            err = json_put_char(out, '"');
         return err;
-    }
 
     case CborTagType:
         return tagged_value_to_json(out, it, flags, status);
@@ -581,27 +1227,35 @@ static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType typ
         cbor_value_get_simple_type(it, &simple_type);  /* can't fail */
         status->flags = TypeWasNotNative;
         status->originalNumber = simple_type;
-        if (fprintf(out, "\"simple(%" PRIu8 ")\"", simple_type) < 0)
-            return CborErrorIO;
+        err = json_write_literal(out, "\"simple(");
+        if (!err)
+            err = json_write_uint(out, simple_type);
+        if (!err)
+            err = json_write_literal(out, ")\"");
+        if (err)
+            return err;
         break;
     }
 
     case CborNullType:
-        if (fprintf(out, "null") < 0)
-            return CborErrorIO;
+        err = json_write_literal(out, "null");
+        if (err)
+            return err;
         break;
 
     case CborUndefinedType:
         status->flags = TypeWasNotNative;
-        if (fprintf(out, "\"undefined\"") < 0)
-            return CborErrorIO;
+        err = json_write_literal(out, "\"undefined\"");
+        if (err)
+            return err;
         break;
 
     case CborBooleanType: {
         bool val;
         cbor_value_get_boolean(it, &val);       /* can't fail */
-        if (fprintf(out, val ? "true" : "false") < 0)
-            return CborErrorIO;
+        err = val ? json_write_literal(out, "true") : json_write_literal(out, "false");
+        if (err)
+            return err;
         break;
     }
 
@@ -630,24 +1284,28 @@ static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType typ
             cbor_value_get_double(it, &val);
         }
 
+        err = json_reserve(out, MaxJsonNumberSize);
+        if (err)
+            return err;
+
         int r = fpclassify(val);
         if (r == FP_NAN || r == FP_INFINITE) {
-            if (fprintf(out, "null") < 0)
-                return CborErrorIO;
+            memcpy(out->ptr, "null", 4);
+            out->ptr += 4;
             status->flags |= r == FP_NAN ? NumberWasNaN :
                                            NumberWasInfinite | (val < 0 ? NumberWasNegative : 0);
         } else {
-            uint64_t ival = (uint64_t)fabs(val);
-            if ((double)ival == fabs(val)) {
+            double absval = fabs(val);
+            if (absval < 18446744073709551616.0 && (double)(uint64_t)absval == absval) {
                 /* print as integer so we get the full precision */
-                r = fprintf(out, "%s%" PRIu64, val < 0 ? "-" : "", ival);
+                if (val < 0)
+                    *out->ptr++ = '-';
+                out->ptr = write_decimal(out->ptr, (uint64_t)absval);
                 status->flags |= TypeWasNotNative;   /* mark this integer number as a double */
             } else {
                 /* this number is definitely not a 64-bit integer */
-                r = fprintf(out, "%." DBL_DECIMAL_DIG_STR "g", val);
+                out->ptr = write_double(out->ptr, val);
             }
-            if (r < 0)
-                return CborErrorIO;
         }
         break;
     }
@@ -688,7 +1346,7 @@ static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType typ
  * code similar to CborParsing. The \a flags parameter indicates one or more of
  * the flags from CborToJsonFlags that control the conversion.
  *
- * \sa cbor_value_to_json_advance(), cbor_value_to_pretty()
+ * \sa cbor_value_to_json_advance(), cbor_value_to_json_buffer(), cbor_value_to_pretty()
  */
 
 /**
@@ -699,12 +1357,81 @@ static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType typ
  *
  * If no error ocurred, this function advances \a value to the next element.
  *
- * \sa cbor_value_to_json(), cbor_value_to_pretty_advance()
+ * \sa cbor_value_to_json(), cbor_value_to_json_buffer_advance(), cbor_value_to_pretty_advance()
  */
 CborError cbor_value_to_json_advance(FILE *out, CborValue *value, int flags)
 {
+    char staging[JsonStagingBufferSize];
     ConversionStatus status;
-    return value_to_json(out, value, flags, cbor_value_get_type(value), &status);
+    JsonOutput output;
+    CborError err, flushErr;
+
+    output.ptr = output.staging = staging;
+    output.end = staging + sizeof(staging);
+    output.buffer = NULL;
+    output.file = out;
+
+    err = value_to_json(&output, value, flags, cbor_value_get_type(value), &status);
+    flushErr = json_flush(&output, 0);
+    return err ? err : flushErr;
+}
+
+/**
+ * \fn CborError cbor_value_to_json_buffer(CborGrowableBuffer *buffer, const CborValue *value, int flags)
+ *
+ * Converts the current CBOR type pointed to by \a value to JSON and appends
+ * that to \a buffer. If an error occurs, this function returns an error code
+ * similar to CborParsing. The \a flags parameter indicates one or more of the
+ * flags from CborToJsonFlags that control the conversion.
+ *
+ * \sa cbor_value_to_json_buffer_advance(), cbor_value_to_json()
+ */
+
+/**
+ * Converts the current CBOR type pointed to by \a value to JSON and appends
+ * that to \a buffer, which must have been initialized with
+ * cbor_growable_buffer_init() and which grows as needed. If an error occurs,
+ * this function returns an error code similar to CborParsing, or
+ * CborErrorOutOfMemory if \a buffer could not grow. The \a flags parameter
+ * indicates one or more of the flags from CborToJsonFlags that control the
+ * conversion.
+ *
+ * This function does not use the C standard library's stream functions and is
+ * faster than cbor_value_to_json_advance(). The output is not NUL-terminated:
+ * its length is the \c size member of \a buffer. Obtain it with
+ * cbor_growable_buffer_release() or free it with cbor_growable_buffer_free().
+ *
+ * If no error ocurred, this function advances \a value to the next element.
+ *
+ * \code
+ *      CborGrowableBuffer buffer;
+ *      cbor_growable_buffer_init(&buffer, NULL, 4096);
+ *      err = cbor_value_to_json_buffer_advance(&buffer, &value, CborConvertDefaultFlags);
+ *      if (!err)
+ *          send_response(buffer.data, buffer.size);
+ *      cbor_growable_buffer_free(&buffer);
+ * \endcode
+ *
+ * \sa cbor_value_to_json_buffer(), cbor_value_to_json_advance()
+ */
+CborError cbor_value_to_json_buffer_advance(CborGrowableBuffer *buffer, CborValue *value, int flags)
+{
+    ConversionStatus status;
+    JsonOutput output;
+    CborError err;
+
+    err = cbor_growable_buffer_reserve(buffer, MaxJsonNumberSize);
+    if (err)
+        return err;
+    output.ptr = (char *)buffer->data + buffer->size;
+    output.end = (char *)buffer->data + buffer->capacity;
+    output.buffer = buffer;
+    output.file = NULL;
+    output.staging = NULL;
+
+    err = value_to_json(&output, value, flags, cbor_value_get_type(value), &status);
+    buffer->size = (size_t)(output.ptr - (char *)buffer->data);
+    return err;
 }
 
 /** @} */
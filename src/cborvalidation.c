@@ -32,6 +32,7 @@
 #include "cbor.h"
 #include "cborinternal_p.h"
 #include "compilersupport_p.h"
+#include "memory.h"
 #include "utf8_p.h"
 
 #include <string.h>
@@ -46,6 +47,10 @@
 #  define CBOR_PARSER_MAX_RECURSIONS 1024
 #endif
 
+#ifndef CBOR_VALIDATION_KEY_BUFFER_SIZE
+#  define CBOR_VALIDATION_KEY_BUFFER_SIZE 256
+#endif
+
 /**
  * \addtogroup CborParsing
  * @{
@@ -73,6 +78,9 @@
  * \value CborValidateMapIsSorted           (Canonical & Strict mode) Validate that map keys appear in
  *                                          sorted order.
  * \value CborValidateMapKeysAreUnique      (Strict mode) Validate that map keys are unique.
+ * \value CborValidateMapKeysAreUniqueUnsorted Validate that map keys are unique, without requiring
+ *                                          that they be sorted. This uses a hash table for each map,
+ *                                          allocated with the parser's allocator.
  * \value CborValidateTagUse                (Strict mode) Validate that known tags are used with the
  *                                          correct types. This does not validate that the content of
  *                                          those types is syntactically correct. For example, this
@@ -217,6 +225,121 @@
     <td>UTF-8 text string</td>
     <td>MIME message</td>
   </tr>
+  <tr>
+    <td>64</td>
+    <td>byte string</td>
+    <td>uint8 typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>65</td>
+    <td>byte string</td>
+    <td>uint16 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>66</td>
+    <td>byte string</td>
+    <td>uint32 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>67</td>
+    <td>byte string</td>
+    <td>uint64 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>68</td>
+    <td>byte string</td>
+    <td>uint8 typed array, clamped arithmetic (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>69</td>
+    <td>byte string</td>
+    <td>uint16 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>70</td>
+    <td>byte string</td>
+    <td>uint32 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>71</td>
+    <td>byte string</td>
+    <td>uint64 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>72</td>
+    <td>byte string</td>
+    <td>sint8 typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>73</td>
+    <td>byte string</td>
+    <td>sint16 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>74</td>
+    <td>byte string</td>
+    <td>sint32 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>75</td>
+    <td>byte string</td>
+    <td>sint64 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>77</td>
+    <td>byte string</td>
+    <td>sint16 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>78</td>
+    <td>byte string</td>
+    <td>sint32 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>79</td>
+    <td>byte string</td>
+    <td>sint64 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>80</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary16 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>81</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary32 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>82</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary64 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>83</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary128 big endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>84</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary16 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>85</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary32 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>86</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary64 little endian typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>87</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary128 little endian typed array (RFC 8746)</td>
+  </tr>
   <tr>
     <td>96</td>
     <td>array</td>
@@ -260,24 +383,38 @@ static const struct KnownTagData knownTagData[] = {
     { 34, (uint32_t)CborTextStringType },
     { 35, (uint32_t)CborTextStringType },
     { 36, (uint32_t)CborTextStringType },
+    { 64, (uint32_t)CborByteStringType },
+    { 65, (uint32_t)CborByteStringType },
+    { 66, (uint32_t)CborByteStringType },
+    { 67, (uint32_t)CborByteStringType },
+    { 68, (uint32_t)CborByteStringType },
+    { 69, (uint32_t)CborByteStringType },
+    { 70, (uint32_t)CborByteStringType },
+    { 71, (uint32_t)CborByteStringType },
+    { 72, (uint32_t)CborByteStringType },
+    { 73, (uint32_t)CborByteStringType },
+    { 74, (uint32_t)CborByteStringType },
+    { 75, (uint32_t)CborByteStringType },
+    { 77, (uint32_t)CborByteStringType },
+    { 78, (uint32_t)CborByteStringType },
+    { 79, (uint32_t)CborByteStringType },
+    { 80, (uint32_t)CborByteStringType },
+    { 81, (uint32_t)CborByteStringType },
+    { 82, (uint32_t)CborByteStringType },
+    { 83, (uint32_t)CborByteStringType },
+    { 84, (uint32_t)CborByteStringType },
+    { 85, (uint32_t)CborByteStringType },
+    { 86, (uint32_t)CborByteStringType },
+    { 87, (uint32_t)CborByteStringType },
     { 96, (uint32_t)CborArrayType },
     { 97, (uint32_t)CborArrayType },
     { 98, (uint32_t)CborArrayType },
     { 55799, 0U }
 };
 
-static CborError validate_value(CborValue *it, uint32_t flags, int recursionLeft);
-
 static inline CborError validate_utf8_string(const void *ptr, size_t n)
 {
-    const uint8_t *buffer = (const uint8_t *)ptr;
-    const uint8_t * const end = buffer + n;
-    while (buffer < end) {
-        uint32_t uc = get_utf8(&buffer, end);
-        if (uc == ~0U)
-            return CborErrorInvalidUtf8TextString;
-    }
-    return CborNoError;
+    return is_valid_utf8((const uint8_t *)ptr, n) ? CborNoError : CborErrorInvalidUtf8TextString;
 }
 
 static inline CborError validate_simple_type(uint8_t simple_type, uint32_t flags)
@@ -291,10 +428,26 @@ static inline CborError validate_simple_type(uint8_t simple_type, uint32_t flags
                 CborErrorUnknownSimpleType : CborNoError;
 }
 
+static inline CborError validate_number_encoding(uint64_t value, size_t bytesUsed)
+{
+    size_t bytesNeeded = 0;
+    if (value >= Value8Bit)
+        ++bytesNeeded;
+    if (value > 0xffU)
+        ++bytesNeeded;
+    if (value > 0xffffU)
+        bytesNeeded += 2;
+    if (value > 0xffffffffU)
+        bytesNeeded += 4;
+    if (bytesNeeded < bytesUsed)
+        return CborErrorOverlongEncoding;
+    return CborNoError;
+}
+
 static inline CborError validate_number(const CborValue *it, CborType type, uint32_t flags)
 {
     CborError err = CborNoError;
-    size_t bytesUsed, bytesNeeded;
+    size_t bytesUsed;
     uint64_t value;
 
     if ((flags & CborValidateShortestIntegrals) == 0)
@@ -305,30 +458,16 @@ static inline CborError validate_number(const CborValue *it, CborType type, uint
     err = extract_number_checked(it, &value, &bytesUsed);
     if (err)
         return err;
-
-    bytesNeeded = 0;
-    if (value >= Value8Bit)
-        ++bytesNeeded;
-    if (value > 0xffU)
-        ++bytesNeeded;
-    if (value > 0xffffU)
-        bytesNeeded += 2;
-    if (value > 0xffffffffU)
-        bytesNeeded += 4;
-    if (bytesNeeded < bytesUsed)
-        return CborErrorOverlongEncoding;
-    return CborNoError;
+    return validate_number_encoding(value, bytesUsed);
 }
 
-static inline CborError validate_tag(CborValue *it, CborTag tag, uint32_t flags, int recursionLeft)
+static inline CborError validate_tag(const CborValue *it, CborTag tag, uint32_t flags)
 {
     CborType type = cbor_value_get_type(it);
     const size_t knownTagCount = sizeof(knownTagData) / sizeof(knownTagData[0]);
     const struct KnownTagData *tagData = knownTagData;
     const struct KnownTagData * const knownTagDataEnd = knownTagData + knownTagCount;
 
-    if (!recursionLeft)
-        return CborErrorNestingTooDeep;
     if (flags & CborValidateNoTags)
         return CborErrorExcludedType;
 
@@ -369,7 +508,7 @@ static inline CborError validate_tag(CborValue *it, CborTag tag, uint32_t flags,
             return CborErrorInappropriateTagForType;
     }
 
-    return validate_value(it, flags, recursionLeft);
+    return CborNoError;
 }
 
 #ifndef CBOR_NO_FLOATING_POINT
@@ -436,158 +575,290 @@ static inline CborError validate_floating_point(CborValue *it, CborType type, ui
 }
 #endif
 
-static CborError validate_container(CborValue *it, int containerType, uint32_t flags, int recursionLeft)
+static CborError validate_map_key(const CborValue *it)
 {
-    CborError err;
-    const uint8_t *previous = NULL;
-    const uint8_t *previous_end = NULL;
-
-    if (!recursionLeft)
-        return CborErrorNestingTooDeep;
-
-    while (!cbor_value_at_end(it)) {
-        const uint8_t *current = cbor_value_get_next_byte(it);
-
-        if (containerType == CborMapType) {
-            if (flags & CborValidateMapKeysAreString) {
-                CborType type = cbor_value_get_type(it);
-                if (type == CborTagType) {
-                    /* skip the tags */
-                    CborValue copy = *it;
-                    err = cbor_value_skip_tag(&copy);
-                    if (err)
-                        return err;
-                    type = cbor_value_get_type(&copy);
-                }
-                if (type != CborTextStringType)
-                    return CborErrorMapKeyNotString;
-            }
-        }
-
-        err = validate_value(it, flags, recursionLeft);
+    CborType type = cbor_value_get_type(it);
+    if (type == CborTagType) {
+        /* skip the tags */
+        CborValue copy = *it;
+        CborError err = cbor_value_skip_tag(&copy);
         if (err)
             return err;
+        type = cbor_value_get_type(&copy);
+    }
+    return type == CborTextStringType ? CborNoError : CborErrorMapKeyNotString;
+}
 
-        if (containerType != CborMapType)
-            continue;
+static CborError validate_map_order(CborValidationFrame *frame, const uint8_t *keyEnd, uint32_t flags)
+{
+    if (frame->previousKey) {
+        size_t bytelen1 = (size_t)(frame->previousKeyEnd - frame->previousKey);
+        size_t bytelen2 = (size_t)(keyEnd - frame->currentKey);
+        int r = memcmp(frame->previousKey, frame->currentKey, bytelen1 <= bytelen2 ? bytelen1 : bytelen2);
 
-        if (flags & CborValidateMapIsSorted) {
-            if (it->parser->flags & CborParserFlag_ExternalSource)
-                return CborErrorUnimplementedValidation;
-            if (previous) {
-                size_t bytelen1 = (size_t)(previous_end - previous);
-                size_t bytelen2 = (size_t)(cbor_value_get_next_byte(it) - current);
-                int r = memcmp(previous, current, bytelen1 <= bytelen2 ? bytelen1 : bytelen2);
-
-                if (r == 0 && bytelen1 != bytelen2)
-                    r = bytelen1 < bytelen2 ? -1 : +1;
-                if (r > 0)
-                    return CborErrorMapNotSorted;
-                if (r == 0 && (flags & CborValidateMapKeysAreUnique) == CborValidateMapKeysAreUnique)
-                    return CborErrorMapKeysNotUnique;
-            }
+        if (r == 0 && bytelen1 != bytelen2)
+            r = bytelen1 < bytelen2 ? -1 : +1;
+        if (r > 0)
+            return CborErrorMapNotSorted;
+        if (r == 0 && (flags & CborValidateMapKeysAreUnique) == CborValidateMapKeysAreUnique)
+            return CborErrorMapKeysNotUnique;
+    }
 
-            previous = current;
-            previous_end = cbor_value_get_next_byte(it);
-        }
+    frame->previousKey = frame->currentKey;
+    frame->previousKeyEnd = keyEnd;
+    return CborNoError;
+}
 
-        /* map: that was the key, so get the value */
-        err = validate_value(it, flags, recursionLeft);
-        if (err)
-            return err;
-    }
+/*
+ * Parsers that read from an external source don't provide a pointer to the
+ * encoded map keys, so sorting and uniqueness are checked on copies of the
+ * keys in this buffer. It is used as a stack: each map being validated keeps
+ * its previous key in it, followed by the key being read, if any.
+ */
+struct KeyBuffer
+{
+    size_t used;
+    uint8_t data[CBOR_VALIDATION_KEY_BUFFER_SIZE];
+};
+typedef struct KeyBuffer KeyBuffer;
+
+static CborError key_buffer_append(KeyBuffer *keys, const void *data, size_t len)
+{
+    if (len > sizeof(keys->data) - keys->used)
+        return CborErrorDataTooLarge;
+    memcpy(keys->data + keys->used, data, len);
+    keys->used += len;
     return CborNoError;
 }
 
-static CborError validate_value(CborValue *it, uint32_t flags, int recursionLeft)
+/* reads the initial byte and the argument of the item \a it points to */
+static CborError read_item_header(const CborValue *it, uint8_t *header, size_t *len)
 {
-    CborError err;
-    CborType type = cbor_value_get_type(it);
+    uint8_t additional;
+    *len = 1;
+    if (!read_bytes(it, header, 0, 1))
+        return CborErrorUnexpectedEOF;
 
-    if (cbor_value_is_length_known(it)) {
-        err = validate_number(it, type, flags);
-        if (err)
-            return err;
-    } else {
-        if (flags & CborValidateNoIndeterminateLength)
-            return CborErrorUnknownLength;
+    additional = header[0] & SmallValueMask;
+    if (additional >= Value8Bit && additional <= Value64Bit) {
+        *len += 1U << (additional - Value8Bit);
+        if (!read_bytes(it, header + 1, 1, *len - 1))
+            return CborErrorUnexpectedEOF;
     }
+    return CborNoError;
+}
 
-    switch (type) {
-    case CborArrayType:
-    case CborMapType: {
-        /* recursive type */
-        CborValue recursed;
-        err = cbor_value_enter_container(it, &recursed);
-        if (!err)
-            err = validate_container(&recursed, type, flags, recursionLeft - 1);
-        if (err) {
-            copy_current_position(it, &recursed);
-            return err;
-        }
-        err = cbor_value_leave_container(it, &recursed);
-        if (err)
-            return err;
-        return CborNoError;
+/* appends the initial byte and the argument of the item \a it points to */
+static CborError key_buffer_append_header(KeyBuffer *keys, const CborValue *it)
+{
+    uint8_t header[9];
+    size_t len;
+    CborError err = read_item_header(it, header, &len);
+    if (err)
+        return err;
+    return key_buffer_append(keys, header, len);
+}
+
+enum {
+    KeySetMinimumCapacity = 16,
+    KeySetMaximumInitialCapacity = 1024,
+
+    /* FNV-1a, 32-bit */
+    KeySetHashOffsetBasis = 2166136261U,
+    KeySetHashPrime = 16777619U
+};
+
+/* an open-addressing hash table of the encoded keys seen in a map */
+struct KeySetEntry
+{
+    const uint8_t *key;
+    size_t length;
+    uint32_t hash;
+};
+typedef struct KeySetEntry KeySetEntry;
+
+static uint32_t key_set_hash(const uint8_t *key, size_t length)
+{
+    uint32_t hash = KeySetHashOffsetBasis;
+    const uint8_t *end = key + length;
+    for ( ; key != end; ++key)
+        hash = (hash ^ *key) * KeySetHashPrime;
+    return hash;
+}
+
+static void key_set_free(const CborAllocator *allocator, CborValidationFrame *frame)
+{
+    if (frame->keySet)
+        cbor_deallocate_with(allocator, frame->keySet, frame->keySetCapacity * sizeof(KeySetEntry));
+    frame->keySet = NULL;
+}
+
+static CborError key_set_allocate(const CborAllocator *allocator, CborValidationFrame *frame, size_t capacity)
+{
+    KeySetEntry *entries = (KeySetEntry *)cbor_allocate_with(allocator, capacity * sizeof(KeySetEntry));
+    if (!entries)
+        return CborErrorOutOfMemory;
+    memset(entries, 0, capacity * sizeof(KeySetEntry));
+    frame->keySet = entries;
+    frame->keySetCapacity = capacity;
+    return CborNoError;
+}
+
+/* \a map points to the map, before entering it */
+static CborError key_set_init(const CborAllocator *allocator, CborValidationFrame *frame, const CborValue *map)
+{
+    size_t pairs = 0;
+    size_t capacity = KeySetMinimumCapacity;
+
+    /* don't trust the length to be honest: the table grows as needed */
+    if (cbor_value_is_length_known(map)) {
+        cbor_value_get_map_length(map, &pairs);
+        if (pairs == 0)
+            return CborNoError;
     }
+    while (capacity < 2 * pairs && capacity < KeySetMaximumInitialCapacity)
+        capacity *= 2;
+    return key_set_allocate(allocator, frame, capacity);
+}
 
-    case CborIntegerType: {
-        uint64_t val;
-        err = cbor_value_get_raw_integer(it, &val);
-        cbor_assert(err == CborNoError);         /* can't fail */
+static void key_set_add(KeySetEntry *entries, size_t capacity, const KeySetEntry *entry)
+{
+    size_t mask = capacity - 1;
+    size_t i = entry->hash & mask;
+    while (entries[i].key)
+        i = (i + 1) & mask;
+    entries[i] = *entry;
+}
 
-        break;
+static CborError key_set_insert(const CborAllocator *allocator, CborValidationFrame *frame,
+                                const uint8_t *key, const uint8_t *keyEnd)
+{
+    KeySetEntry *entries = (KeySetEntry *)frame->keySet;
+    KeySetEntry entry;
+    size_t capacity = frame->keySetCapacity;
+    size_t i;
+
+    entry.key = key;
+    entry.length = (size_t)(keyEnd - key);
+    entry.hash = key_set_hash(key, entry.length);
+    for (i = entry.hash & (capacity - 1); entries[i].key; i = (i + 1) & (capacity - 1)) {
+        if (entries[i].hash == entry.hash && entries[i].length == entry.length &&
+                memcmp(entries[i].key, key, entry.length) == 0)
+            return CborErrorMapKeysNotUnique;
     }
+    entries[i] = entry;
 
-    case CborByteStringType:
-    case CborTextStringType: {
-        size_t n = 0;
-        const void *ptr;
+    /* keep the table at most half full (frame->items counts keys and values) */
+    if ((frame->items + 1) > capacity) {
+        CborError err = key_set_allocate(allocator, frame, 2 * capacity);
+        if (err)
+            return err;
+        for (i = 0; i < capacity; ++i) {
+            if (entries[i].key)
+                key_set_add((KeySetEntry *)frame->keySet, frame->keySetCapacity, &entries[i]);
+        }
+        cbor_deallocate_with(allocator, entries, capacity * sizeof(KeySetEntry));
+    }
+    return CborNoError;
+}
+
+/* if \a keys is not null, the encoded string is appended to it */
+static CborError validate_string(CborValue *it, CborType type, uint32_t flags, size_t *length, KeyBuffer *keys)
+{
+    CborError err;
+    size_t n = 0;
+    const void *ptr;
 
-        err = cbor_value_begin_string_iteration(it);
+    if (keys && !cbor_value_is_length_known(it)) {
+        err = key_buffer_append_header(keys, it);
         if (err)
             return err;
+    }
+    err = cbor_value_begin_string_iteration(it);
+    if (err)
+        return err;
 
-        while (1) {
-            CborValue next;
-            err = _cbor_value_get_string_chunk(it, &ptr, &n, &next);
-            if (!err) {
-                err = validate_number(it, type, flags);
+    while (1) {
+        CborValue next;
+        uint8_t header[9];
+        size_t headerLength = 0;
+        if ((keys || flags & CborValidateShortestIntegrals) &&
+                (!cbor_value_is_length_known(it) || it->flags & CborIteratorFlag_BeforeFirstStringChunk)) {
+            /* The chunk's header or the Break: read it now because an
+             * external source can't go back to it once the chunk is read. */
+            err = read_item_header(it, header, &headerLength);
+            if (err)
+                return err;
+            if (keys) {
+                err = key_buffer_append(keys, header, headerLength);
                 if (err)
                     return err;
             }
-
-            *it = next;
-            if (err == CborErrorNoMoreStringChunks)
-                return cbor_value_finish_string_iteration(it);
+        }
+        err = _cbor_value_get_string_chunk(it, &ptr, &n, &next);
+        if (!err && headerLength && flags & CborValidateShortestIntegrals) {
+            uint64_t value = header[0] & SmallValueMask;
+            size_t i;
+            if (headerLength > 1)
+                value = 0;
+            for (i = 1; i < headerLength; ++i)
+                value = (value << 8) | header[i];
+            err = validate_number_encoding(value, headerLength - 1);
             if (err)
                 return err;
+        }
 
-            if (type == CborTextStringType && flags & CborValidateUtf8) {
-                err = validate_utf8_string(ptr, n);
-                if (err)
-                    return err;
-            }
+        *it = next;
+        if (err == CborErrorNoMoreStringChunks)
+            return cbor_value_finish_string_iteration(it);
+        if (err)
+            return err;
+        *length += n;
+        if (keys) {
+            err = key_buffer_append(keys, ptr, n);
+            if (err)
+                return err;
         }
 
-        return CborNoError;
+        if (type == CborTextStringType && flags & CborValidateUtf8) {
+            err = validate_utf8_string(ptr, n);
+            if (err)
+                return err;
+        }
     }
+}
 
-    case CborTagType: {
-        CborTag tag;
-        err = cbor_value_get_tag(it, &tag);
-        cbor_assert(err == CborNoError);     /* can't fail */
+/* validates an item that is not a container nor a tag and advances past it;
+ * for strings, \a length is incremented by the string's length. If \a keys
+ * is not null, the item's encoding is appended to it. */
+static CborError validate_scalar(CborValue *it, CborType type, uint32_t flags, size_t *length, KeyBuffer *keys)
+{
+    CborError err;
 
-        err = cbor_value_advance_fixed(it);
-        if (err)
-            return err;
-        err = validate_tag(it, tag, flags, recursionLeft - 1);
+    if (keys && type != CborByteStringType && type != CborTextStringType) {
+        err = key_buffer_append_header(keys, it);
         if (err)
             return err;
+    }
 
-        return CborNoError;
+    switch (type) {
+    case CborArrayType:
+    case CborMapType:
+    case CborTagType:
+        break;          /* handled by our caller */
+
+    case CborIntegerType: {
+        uint64_t val;
+        err = cbor_value_get_raw_integer(it, &val);
+        cbor_assert(err == CborNoError);         /* can't fail */
+
+        break;
     }
 
+    case CborByteStringType:
+    case CborTextStringType:
+        return validate_string(it, type, flags, length, keys);
+
     case CborSimpleType: {
         uint8_t simple_type;
         err = cbor_value_get_simple_type(it, &simple_type);
@@ -624,10 +895,263 @@ static CborError validate_value(CborValue *it, uint32_t flags, int recursionLeft
         return CborErrorUnknownType;
     }
 
-    err = cbor_value_advance_fixed(it);
+    return cbor_value_advance_fixed(it);
+}
+
+struct IndexBuilder
+{
+    CborIndexEntry *entries;
+    size_t capacity;
+    size_t count;
+    const uint8_t *base;
+};
+typedef struct IndexBuilder IndexBuilder;
+
+static CborError index_begin_entry(IndexBuilder *builder, const uint8_t *start, CborType type, uint8_t flags,
+                                   uint32_t *entry)
+{
+    CborIndexEntry *e;
+    size_t offset = (size_t)(start - builder->base);
+    if (offset > UINT32_MAX || builder->count >= UINT32_MAX)
+        return CborErrorDataTooLarge;
+
+    *entry = (uint32_t)builder->count++;
+    if (*entry >= builder->capacity)
+        return CborNoError;     /* keep counting */
+    e = &builder->entries[*entry];
+    e->offset = (uint32_t)offset;
+    e->type = type;
+    e->flags = flags;
+    return CborNoError;
+}
+
+static CborError index_end_entry(IndexBuilder *builder, uint32_t entry, const uint8_t *end, size_t count)
+{
+    CborIndexEntry *e;
+    size_t offset = (size_t)(end - builder->base);
+    if (offset > UINT32_MAX || count > UINT32_MAX)
+        return CborErrorDataTooLarge;
+    if (entry >= builder->capacity)
+        return CborNoError;
+    e = &builder->entries[entry];
+    e->end = (uint32_t)offset;
+    e->next = (uint32_t)builder->count;
+    e->count = (uint32_t)count;
+    return CborNoError;
+}
+
+static CborError validate_value_recursive(CborValue *it, uint32_t flags, size_t levelsLeft, IndexBuilder *builder);
+
+/*
+ * Validates the item \a it points to, including everything nested in it,
+ * and advances past it. Instead of recursing, the iterators of the
+ * containers being validated are kept in \a stack, which has room for \a
+ * stackSize levels. If that is not enough, the function calls itself (via
+ * validate_value_recursive) with a new stack as long as \a levelsLeft allows.
+ *
+ * If \a builder is not null, each item (other than tags) is also recorded in
+ * the index, in the order it is found.
+ */
+static CborError validate_value(CborValue *it, uint32_t flags, CborValidationFrame *stack, size_t stackSize,
+                                size_t levelsLeft, IndexBuilder *builder)
+{
+    CborError err;
+    CborValue *current = it;
+    CborValidationFrame *frame = NULL;
+    const CborAllocator *allocator = it->parser->allocator;
+    const uint8_t *itemStart = NULL;
+    size_t depth = 0;
+    bool afterTag = false;
+    bool copyKeys = (flags & CborValidateMapIsSorted) && !uses_linear_buffer(it);
+    bool hashKeys = (flags & CborValidateMapKeysAreUniqueUnsorted) &&
+            (flags & CborValidateMapKeysAreUnique) != CborValidateMapKeysAreUnique;
+    KeyBuffer keyBuffer;
+    keyBuffer.used = 0;
+
+    for (;;) {
+        bool itemComplete = true;
+        bool isMapKey = frame && frame->isMap && !frame->expectingValue;
+        KeyBuffer *keys = copyKeys && isMapKey ? &keyBuffer : NULL;
+
+        if (frame && cbor_value_at_end(current)) {
+            /* leave the container, which completes an item in the parent */
+            CborValue *parent = depth > 1 ? &stack[depth - 2].container : it;
+            err = cbor_value_leave_container(parent, current);
+            if (err)
+                goto error;
+            current = parent;
+            if (builder) {
+                err = index_end_entry(builder, frame->entry, cbor_value_get_next_byte(current), frame->items);
+                if (err)
+                    goto error;
+            }
+            if (copyKeys && frame->previousKey)
+                keyBuffer.used = (size_t)(frame->previousKey - keyBuffer.data);
+            key_set_free(allocator, frame);
+            frame = --depth ? &stack[depth - 1] : NULL;
+        } else {
+            CborType type = cbor_value_get_type(current);
+            bool tagged = afterTag;
+            uint8_t entryFlags = tagged ? CborIndexEntryFlag_Tagged : 0;
+            uint32_t entry = 0;
+            size_t length = 0;
+
+            if (!afterTag) {
+                itemStart = cbor_value_get_next_byte(current);
+                if (isMapKey) {
+                    frame->currentKey = keys ? keyBuffer.data + keyBuffer.used : itemStart;
+                    if (flags & CborValidateMapKeysAreString) {
+                        err = validate_map_key(current);
+                        if (err)
+                            goto error;
+                    }
+                }
+            }
+            afterTag = false;
+
+            if (keys && (type == CborArrayType || type == CborMapType)) {
+                /* we'd need to copy the whole container */
+                err = CborErrorUnimplementedValidation;
+                goto error;
+            }
+
+            if ((type == CborArrayType || type == CborMapType) && depth == stackSize) {
+                /* out of stack */
+                if (levelsLeft == 0) {
+                    err = CborErrorNestingTooDeep;
+                    goto error;
+                }
+                entry = builder ? (uint32_t)builder->count : 0;
+                err = validate_value_recursive(current, flags, levelsLeft, builder);
+                if (err)
+                    goto error;
+                if (builder && tagged && entry < builder->capacity) {
+                    /* the recursive call didn't see the tags */
+                    builder->entries[entry].offset = (uint32_t)(itemStart - builder->base);
+                    builder->entries[entry].flags |= CborIndexEntryFlag_Tagged;
+                }
+            } else {
+                if (cbor_value_is_length_known(current)) {
+                    err = validate_number(current, type, flags);
+                    if (err)
+                        goto error;
+                } else {
+                    if (flags & CborValidateNoIndeterminateLength) {
+                        err = CborErrorUnknownLength;
+                        goto error;
+                    }
+                    entryFlags |= CborIndexEntryFlag_IndefiniteLength;
+                }
+
+                if (builder && type != CborTagType) {
+                    err = index_begin_entry(builder, itemStart, type, entryFlags, &entry);
+                    if (err)
+                        goto error;
+                }
+
+                if (type == CborArrayType || type == CborMapType) {
+                    CborValidationFrame *newFrame = &stack[depth];
+                    newFrame->keySet = NULL;
+                    if (hashKeys && type == CborMapType) {
+                        if (!uses_linear_buffer(current)) {
+                            err = CborErrorUnimplementedValidation;
+                            goto error;
+                        }
+                        err = key_set_init(allocator, newFrame, current);
+                        if (err)
+                            goto error;
+                    }
+                    ++depth;
+                    err = cbor_value_enter_container(current, &newFrame->container);
+                    if (err)
+                        goto error;
+                    newFrame->previousKey = NULL;
+                    newFrame->entry = entry;
+                    newFrame->items = 0;
+                    newFrame->isMap = type == CborMapType;
+                    newFrame->expectingValue = false;
+                    frame = newFrame;
+                    current = &frame->container;
+                    itemComplete = false;
+                } else if (type == CborTagType) {
+                    CborTag tag;
+                    err = cbor_value_get_tag(current, &tag);
+                    cbor_assert(err == CborNoError);     /* can't fail */
+
+                    if (keys) {
+                        err = key_buffer_append_header(keys, current);
+                        if (err)
+                            goto error;
+                    }
+                    err = cbor_value_advance_fixed(current);
+                    if (err)
+                        goto error;
+                    err = validate_tag(current, tag, flags);
+                    if (err)
+                        goto error;
+
+                    /* tags don't count as items: the tagged item does */
+                    afterTag = true;
+                    itemComplete = false;
+                } else {
+                    err = validate_scalar(current, type, flags, &length, keys);
+                    if (!err && builder)
+                        err = index_end_entry(builder, entry, cbor_value_get_next_byte(current), length);
+                    if (err)
+                        goto error;
+                }
+            }
+        }
+
+        if (!itemComplete)
+            continue;
+        if (!frame)
+            return CborNoError;     /* done with the item we were asked for */
+        ++frame->items;
+        if (!frame->isMap)
+            continue;
+        if (!frame->expectingValue) {
+            /* that was a key (containers are never copied into keyBuffer) */
+            const uint8_t *keyEnd = copyKeys ? keyBuffer.data + keyBuffer.used : cbor_value_get_next_byte(current);
+            const uint8_t *areaStart = frame->previousKey ? frame->previousKey : frame->currentKey;
+            if (frame->keySet) {
+                err = key_set_insert(allocator, frame, frame->currentKey, keyEnd);
+                if (err)
+                    goto error;
+            }
+            if (flags & CborValidateMapIsSorted) {
+                err = validate_map_order(frame, keyEnd, flags);
+                if (err)
+                    goto error;
+            }
+            if (copyKeys) {
+                /* keep only this key, at the start of this map's area */
+                uint8_t *keyStart = keyBuffer.data + (areaStart - keyBuffer.data);
+                size_t len = (size_t)(keyEnd - frame->currentKey);
+                memmove(keyStart, frame->currentKey, len);
+                frame->previousKey = keyStart;
+                frame->previousKeyEnd = keyStart + len;
+                keyBuffer.used = (size_t)(keyStart - keyBuffer.data) + len;
+            }
+        }
+        frame->expectingValue = !frame->expectingValue;
+    }
+
+error:
+    while (depth)
+        key_set_free(allocator, &stack[--depth]);
     return err;
 }
 
+enum { ValidationStackChunk = 16 };
+
+static CborError validate_value_recursive(CborValue *it, uint32_t flags, size_t levelsLeft, IndexBuilder *builder)
+{
+    CborValidationFrame stack[ValidationStackChunk];
+    size_t stackSize = levelsLeft < ValidationStackChunk ? levelsLeft : (size_t)ValidationStackChunk;
+    return validate_value(it, flags, stack, stackSize, levelsLeft - stackSize, builder);
+}
+
 /**
  * Performs a full validation, controlled by the \a flags options, of the CBOR
  * stream pointed by \a it and returns the error it found. If no error was
@@ -638,18 +1162,126 @@ static CborError validate_value(CborValue *it, uint32_t flags, int recursionLeft
  * cbor_value_validate_basic().
  *
  * This function has the same timing and memory requirements as
- * cbor_value_advance() and cbor_value_validate_basic().
+ * cbor_value_advance() and cbor_value_validate_basic(), except for
+ * CborValidateMapKeysAreUniqueUnsorted, which allocates one hash table per
+ * map being validated, using the parser's allocator.
+ *
+ * When the parser reads from an external source (see
+ * cbor_parser_init_reader()), the keys of the map being checked for
+ * CborValidateMapIsSorted or CborValidateMapKeysAreUnique are copied into a
+ * scratch buffer of CBOR_VALIDATION_KEY_BUFFER_SIZE bytes (256 by default).
+ * Keys that do not fit make this function return CborErrorDataTooLarge and
+ * keys that are arrays or maps make it return CborErrorUnimplementedValidation.
+ * CborValidateMapKeysAreUniqueUnsorted is not supported with such parsers.
  *
  * \sa CborValidationFlags, cbor_value_validate_basic(), cbor_value_advance()
  */
 CborError cbor_value_validate(const CborValue *it, uint32_t flags)
 {
     CborValue value = *it;
-    CborError err = validate_value(&value, flags, CBOR_PARSER_MAX_RECURSIONS);
+    CborError err = validate_value_recursive(&value, flags, CBOR_PARSER_MAX_RECURSIONS, NULL);
+    if (err)
+        return err;
+    if (flags & CborValidateCompleteData && can_read_bytes(&value, 1))
+        return CborErrorGarbageAtEnd;
+    return CborNoError;
+}
+
+/**
+ * \struct CborValidationFrame
+ *
+ * Holds the state of one level of nesting during a call to
+ * cbor_value_validate_with_stack(). The caller only provides the storage;
+ * the members are private and should not be accessed.
+ */
+
+/**
+ * Performs the same validation as cbor_value_validate(), but without
+ * recursion: the state of each array or map being validated is kept in \a
+ * stack, an array of \a stackSize elements supplied by the caller, so the
+ * amount of the C stack used is small and does not depend on the input.
+ * Containers may be nested at most \a stackSize levels deep; deeper input
+ * makes this function return CborErrorNestingTooDeep. Tags do not count
+ * towards the nesting.
+ *
+ * This allows validating untrusted input on threads with small stacks, and
+ * with a nesting limit different from CBOR_PARSER_MAX_RECURSIONS (the limit
+ * that cbor_value_validate() uses, 1024 by default). Note that
+ * cbor_value_advance() and other functions that skip over containers are
+ * still bound by that limit.
+ *
+ * \sa CborValidationFlags, cbor_value_validate()
+ */
+CborError cbor_value_validate_with_stack(const CborValue *it, uint32_t flags, CborValidationFrame *stack,
+                                         size_t stackSize)
+{
+    CborValue value = *it;
+    CborError err = validate_value(&value, flags, stack, stackSize, 0, NULL);
+    if (err)
+        return err;
+    if (flags & CborValidateCompleteData && can_read_bytes(&value, 1))
+        return CborErrorGarbageAtEnd;
+    return CborNoError;
+}
+
+/**
+ * Performs the same validation as cbor_value_validate() and, in the same pass,
+ * builds a structural index of the item that \a it points to, so that the
+ * application can access its contents afterwards without validating or
+ * parsing them again. The index is stored in \a index and its entries in the
+ * array pointed to by \a entries, which must have room for \a capacity
+ * entries and must remain valid for as long as \a index is in use.
+ *
+ * The index contains one entry for each item (tags are not items, but are
+ * recorded as a flag in the entry of the item they apply to), in the order
+ * they appear in the stream: the validated item itself is at position 0 and
+ * the contents of arrays and maps immediately follow the container's entry.
+ * See CborIndexEntry for the information that each entry contains.
+ *
+ * If \a capacity is not large enough to hold all the entries, this function
+ * returns CborErrorOutOfMemory after having validated the whole item and
+ * cbor_document_index_get_required_count() returns the capacity required. The
+ * index is then empty (cbor_document_index_get_count() returns 0), but the
+ * function can be called again with a larger array. Validation errors take
+ * precedence over this condition.
+ *
+ * This function requires the parser to have been initialized with
+ * cbor_parser_init() and returns CborErrorUnsupportedSource if it was
+ * initialized with cbor_parser_init_reader(). Input whose size exceeds 4 GB
+ * causes CborErrorDataTooLarge.
+ *
+ * \sa cbor_value_validate(), cbor_document_index_get_value(),
+ *     cbor_document_index_map_find_value()
+ */
+CborError cbor_value_validate_and_index(const CborValue *it, uint32_t flags, CborDocumentIndex *index,
+                                        CborIndexEntry *entries, size_t capacity)
+{
+    CborValue value = *it;
+    IndexBuilder builder;
+    CborError err;
+
+    index->first = *it;
+    index->entries = entries;
+    index->count = 0;
+    index->required = 0;
+    if (!uses_linear_buffer(it))
+        return CborErrorUnsupportedSource;
+
+    builder.entries = entries;
+    builder.capacity = capacity;
+    builder.count = 0;
+    builder.base = it->source.ptr;
+    err = validate_value_recursive(&value, flags, CBOR_PARSER_MAX_RECURSIONS, &builder);
     if (err)
         return err;
     if (flags & CborValidateCompleteData && can_read_bytes(&value, 1))
         return CborErrorGarbageAtEnd;
+
+    /* never expose more entries than were stored */
+    index->required = builder.count;
+    if (builder.count > capacity)
+        return CborErrorOutOfMemory;
+    index->count = builder.count;
     return CborNoError;
 }
 
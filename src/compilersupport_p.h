@@ -121,6 +121,7 @@
 #  include <sys/byteorder.h>
 #elif defined(_MSC_VER)
 /* MSVC, which implies Windows, which implies little-endian and sizeof(long) == 4 */
+#  include <intrin.h>
 #  include <stdlib.h>
 #  define cbor_ntohll       _byteswap_uint64
 #  define cbor_htonll       _byteswap_uint64
@@ -218,4 +219,42 @@ static inline bool add_check_overflow(size_t v1, size_t v2, size_t *r)
 #endif
 }
 
+/* v must not be zero */
+static inline unsigned count_trailing_zeros32(uint32_t v)
+{
+#if defined(__GNUC__) || __has_builtin(__builtin_ctz)
+    return (unsigned)__builtin_ctz(v);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, v);
+    return (unsigned)index;
+#else
+    unsigned n = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+/* v must not be zero */
+static inline unsigned count_trailing_zeros64(uint64_t v)
+{
+#if defined(__GNUC__) || __has_builtin(__builtin_ctzll)
+    return (unsigned)__builtin_ctzll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return (unsigned)index;
+#else
+    unsigned n = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
 #endif /* COMPILERSUPPORT_H */
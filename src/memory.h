@@ -27,5 +27,13 @@
 #else
 #  include <stdlib.h>
 #  define cbor_malloc malloc
+#  define cbor_realloc realloc
 #  define cbor_free   free
 #endif
+
+/* Allocate and free through a CborAllocator, falling back to the functions
+ * above if none was provided */
+#define cbor_allocate_with(allocator, size) \
+    ((allocator) ? (allocator)->allocate((allocator)->context, (size)) : cbor_malloc(size))
+#define cbor_deallocate_with(allocator, ptr, size) \
+    ((allocator) ? (allocator)->deallocate((allocator)->context, (ptr), (size)) : cbor_free(ptr))
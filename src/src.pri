@@ -2,10 +2,20 @@ SOURCES += \
     $$PWD/cborencoder.c \
     $$PWD/cborencoder_close_container_checked.c \
     $$PWD/cborencoder_float.c \
+    $$PWD/cborencoder_array.c \
+    $$PWD/cborencoder_buffered_writer.c \
+    $$PWD/cborencoder_growable_buffer.c \
+    $$PWD/cborarena.c \
     $$PWD/cborerrorstrings.c \
+    $$PWD/cborfromjson.c \
     $$PWD/cborparser.c \
     $$PWD/cborparser_dup_string.c \
     $$PWD/cborparser_float.c \
+    $$PWD/cborparser_array.c \
+    $$PWD/cborparser_stream.c \
+    $$PWD/cborparser_callbacks.c \
+    $$PWD/cborparser_index.c \
+    $$PWD/cborparser_mmap.c \
     $$PWD/cborpretty.c \
     $$PWD/cborpretty_stdio.c \
     $$PWD/cbortojson.c \
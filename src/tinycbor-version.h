@@ -1,3 +1,3 @@
 #define TINYCBOR_VERSION_MAJOR      0
-#define TINYCBOR_VERSION_MINOR      6
+#define TINYCBOR_VERSION_MINOR      7
 #define TINYCBOR_VERSION_PATCH      0
@@ -28,6 +28,47 @@
 #include "compilersupport_p.h"
 
 #include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(CBOR_NO_UTF8_DISPATCH)
+/* build the SSSE3 and AVX2 kernels anyway and pick one at run time */
+#  define CBOR_UTF8_DISPATCH    1
+#  include <immintrin.h>
+#elif defined(__SSSE3__)
+#  include <tmmintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+#ifdef CBOR_UTF8_DISPATCH
+#  define UTF8_TARGET_SSSE3     __attribute__((target("ssse3")))
+#  define UTF8_TARGET_AVX2      __attribute__((target("avx2")))
+
+static inline bool utf8_cpu_has_avx2(void)
+{
+    static int cached;
+    if (unlikely(!cached)) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("avx2") ? 1 : -1;
+    }
+    return cached > 0;
+}
+
+static inline bool utf8_cpu_has_ssse3(void)
+{
+    static int cached;
+    if (unlikely(!cached)) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("ssse3") ? 1 : -1;
+    }
+    return cached > 0;
+}
+#else
+#  define UTF8_TARGET_SSSE3
+#  define UTF8_TARGET_AVX2
+#endif
 
 static inline uint32_t get_utf8(const uint8_t **buffer, const uint8_t *end)
 {
@@ -101,4 +142,320 @@ static inline uint32_t get_utf8(const uint8_t **buffer, const uint8_t *end)
     return uc;
 }
 
+#if defined(__AVX2__) || defined(CBOR_UTF8_DISPATCH)
+/* Returns the first non-ASCII byte or the start of the last incomplete block */
+UTF8_TARGET_AVX2 static inline const uint8_t *skip_ascii_avx2(const uint8_t *ptr, const uint8_t *end)
+{
+    while (end - ptr >= 32) {
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)ptr));
+        if (mask)
+            return ptr + count_trailing_zeros32(mask);
+        ptr += 32;
+    }
+    return ptr;
+}
+#endif
+
+/* Returns the number of bytes at the start of the buffer that are ASCII */
+static inline size_t count_ascii(const uint8_t *ptr, const uint8_t *end)
+{
+    const uint8_t *start = ptr;
+#if defined(__AVX2__)
+    ptr = skip_ascii_avx2(ptr, end);
+#elif defined(CBOR_UTF8_DISPATCH)
+    /* not worth a function call for short runs */
+    if (end - ptr >= 64 && utf8_cpu_has_avx2())
+        ptr = skip_ascii_avx2(ptr, end);
+#endif
+#if defined(__SSE2__)
+    while (end - ptr >= 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ptr));
+        if (mask)
+            return (size_t)(ptr - start) + count_trailing_zeros32(mask);
+        ptr += 16;
+    }
+#else
+    while (end - ptr >= 8) {
+        uint64_t word;
+        memcpy(&word, ptr, sizeof(word));
+        if (word & UINT64_C(0x8080808080808080))
+            break;
+        ptr += 8;
+    }
+#endif
+    while (ptr != end && *ptr < 0x80)
+        ++ptr;
+    return (size_t)(ptr - start);
+}
+
+/* Returns the number of bytes at the start of the buffer that can be copied to
+ * a JSON string as they are: anything but quotation marks, backslashes and
+ * control characters */
+static inline size_t count_json_unescaped(const uint8_t *ptr, const uint8_t *end)
+{
+    const uint8_t *start = ptr;
+#if defined(__AVX2__)
+    while (end - ptr >= 32) {
+        __m256i input = _mm256_loadu_si256((const __m256i *)ptr);
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('"')),
+                                          _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\\')));
+        /* unsigned input <= 0x1f */
+        special = _mm256_or_si256(special,
+                                  _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(0x1f)), input));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+        if (mask)
+            return (size_t)(ptr - start) + count_trailing_zeros32(mask);
+        ptr += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    while (end - ptr >= 16) {
+        __m128i input = _mm_loadu_si128((const __m128i *)ptr);
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8('"')),
+                                       _mm_cmpeq_epi8(input, _mm_set1_epi8('\\')));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(input, _mm_set1_epi8(0x1f)), input));
+        unsigned mask = (unsigned)_mm_movemask_epi8(special);
+        if (mask)
+            return (size_t)(ptr - start) + count_trailing_zeros32(mask);
+        ptr += 16;
+    }
+#else
+    /* eight bytes at a time: a byte is zero after the XOR with the character
+     * it matches, and any byte below 0x20 borrows when 0x20 is subtracted */
+    while (end - ptr >= 8) {
+        const uint64_t ones = UINT64_C(0x0101010101010101);
+        uint64_t word, quote, backslash;
+        memcpy(&word, ptr, sizeof(word));
+        quote = word ^ (ones * '"');
+        backslash = word ^ (ones * '\\');
+        if ((((quote - ones) & ~quote) | ((backslash - ones) & ~backslash) |
+             ((word - ones * 0x20) & ~word)) & (ones * 0x80))
+            break;
+        ptr += 8;
+    }
+#endif
+    while (ptr != end && *ptr >= 0x20 && *ptr != '"' && *ptr != '\\')
+        ++ptr;
+    return (size_t)(ptr - start);
+}
+
+static inline bool is_valid_utf8_scalar(const uint8_t *ptr, size_t n)
+{
+    const uint8_t *end = ptr + n;
+    for (;;) {
+        ptr += count_ascii(ptr, end);
+        if (ptr == end)
+            return true;
+        if (get_utf8(&ptr, end) == ~0U)
+            return false;
+    }
+}
+
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(CBOR_UTF8_DISPATCH)
+/*
+ * Vectorized UTF-8 validation, using the lookup algorithm by John Keiser and
+ * Daniel Lemire ("Validating UTF-8 In Less Than One Instruction Per Byte",
+ * 2020). Each byte is classified by the high nibble of the previous byte, the
+ * low nibble of the previous byte and the high nibble of the byte itself; the
+ * three lookups have a bit in common only if the pair of bytes is invalid.
+ * Sequences longer than two bytes are checked by requiring that the bytes two
+ * and three positions after 3- and 4-byte leaders be continuation bytes.
+ */
+enum Utf8ErrorBits {
+    Utf8TooShort        = 1 << 0,   /* 11______ 0_______ or 11______ 11______ */
+    Utf8TooLong         = 1 << 1,   /* 0_______ 10______ */
+    Utf8Overlong3       = 1 << 2,   /* 11100000 100_____ */
+    Utf8TooLarge        = 1 << 3,   /* 11110100 1001____ and larger */
+    Utf8Surrogate       = 1 << 4,   /* 11101101 101_____ */
+    Utf8Overlong2       = 1 << 5,   /* 1100000_ 10______ */
+    Utf8TooLarge1000    = 1 << 6,   /* 11110101 1000____ and larger */
+    Utf8Overlong4       = 1 << 6,   /* 11110000 1000____ */
+    Utf8TwoConts        = 1 << 7,   /* 10______ 10______ */
+    Utf8Carry           = Utf8TooShort | Utf8TooLong | Utf8TwoConts
+};
+
+#define UTF8_BYTE1_HIGH_TABLE \
+    Utf8TooLong, Utf8TooLong, Utf8TooLong, Utf8TooLong, \
+    Utf8TooLong, Utf8TooLong, Utf8TooLong, Utf8TooLong, \
+    (char)Utf8TwoConts, (char)Utf8TwoConts, (char)Utf8TwoConts, (char)Utf8TwoConts, \
+    Utf8TooShort | Utf8Overlong2, \
+    Utf8TooShort, \
+    Utf8TooShort | Utf8Overlong3 | Utf8Surrogate, \
+    Utf8TooShort | Utf8TooLarge | Utf8TooLarge1000 | Utf8Overlong4
+#define UTF8_BYTE1_LOW_TABLE \
+    (char)(Utf8Carry | Utf8Overlong3 | Utf8Overlong2 | Utf8Overlong4), \
+    (char)(Utf8Carry | Utf8Overlong2), \
+    (char)Utf8Carry, (char)Utf8Carry, \
+    (char)(Utf8Carry | Utf8TooLarge), \
+    (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), \
+    (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), \
+    (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), \
+    (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), \
+    (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), \
+    (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000 | Utf8Surrogate), \
+    (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000), (char)(Utf8Carry | Utf8TooLarge | Utf8TooLarge1000)
+#define UTF8_BYTE2_HIGH_TABLE \
+    Utf8TooShort, Utf8TooShort, Utf8TooShort, Utf8TooShort, \
+    Utf8TooShort, Utf8TooShort, Utf8TooShort, Utf8TooShort, \
+    (char)(Utf8TooLong | Utf8Overlong2 | Utf8TwoConts | Utf8Overlong3 | Utf8TooLarge1000 | Utf8Overlong4), \
+    (char)(Utf8TooLong | Utf8Overlong2 | Utf8TwoConts | Utf8Overlong3 | Utf8TooLarge), \
+    (char)(Utf8TooLong | Utf8Overlong2 | Utf8TwoConts | Utf8Surrogate | Utf8TooLarge), \
+    (char)(Utf8TooLong | Utf8Overlong2 | Utf8TwoConts | Utf8Surrogate | Utf8TooLarge), \
+    Utf8TooShort, Utf8TooShort, Utf8TooShort, Utf8TooShort
+/* a sequence is incomplete at the end of a block if one of its last three
+ * bytes starts a sequence longer than the bytes left */
+#define UTF8_INCOMPLETE_MAX_16 \
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1)
+#endif
+
+#if defined(__AVX2__) || defined(CBOR_UTF8_DISPATCH)
+UTF8_TARGET_AVX2 static inline __m256i check_utf8_block_avx2(__m256i input, __m256i previous)
+{
+    const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+    __m256i shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+    __m256i byte1High = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE1_HIGH_TABLE, UTF8_BYTE1_HIGH_TABLE),
+                                            _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibbleMask));
+    __m256i byte1Low = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE1_LOW_TABLE, UTF8_BYTE1_LOW_TABLE),
+                                           _mm256_and_si256(prev1, nibbleMask));
+    __m256i byte2High = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE2_HIGH_TABLE, UTF8_BYTE2_HIGH_TABLE),
+                                            _mm256_and_si256(_mm256_srli_epi16(input, 4), nibbleMask));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+
+    /* only 111_____ and 1111____ respectively will be >= 0x80 */
+    __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+                                     _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+    must23 = _mm256_and_si256(must23, _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must23, special);
+}
+
+UTF8_TARGET_AVX2 static inline bool is_valid_utf8_avx2(const uint8_t *ptr, size_t n)
+{
+    const uint8_t *end = ptr + n;
+    const __m256i incompleteMax = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                   UTF8_INCOMPLETE_MAX_16);
+    __m256i error = _mm256_setzero_si256();
+    __m256i previous = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+
+    while (end - ptr >= 32) {
+        __m256i input = _mm256_loadu_si256((const __m256i *)ptr);
+        if (_mm256_movemask_epi8(input) == 0) {
+            /* ASCII block: only need to check that the previous one didn't end mid-sequence */
+            error = _mm256_or_si256(error, incomplete);
+        } else {
+            error = _mm256_or_si256(error, check_utf8_block_avx2(input, previous));
+            incomplete = _mm256_subs_epu8(input, incompleteMax);
+        }
+        previous = input;
+        ptr += 32;
+    }
+
+    if (ptr != end) {
+        /* pad the tail with zeroes, which makes any incomplete sequence fail */
+        uint8_t block[32] = { 0 };
+        memcpy(block, ptr, (size_t)(end - ptr));
+        error = _mm256_or_si256(error, check_utf8_block_avx2(_mm256_loadu_si256((const __m256i *)block), previous));
+    } else {
+        error = _mm256_or_si256(error, incomplete);
+    }
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+#if (defined(__SSSE3__) && !defined(__AVX2__)) || defined(CBOR_UTF8_DISPATCH)
+UTF8_TARGET_SSSE3 static inline __m128i check_utf8_block_ssse3(__m128i input, __m128i previous)
+{
+    const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+    __m128i byte1High = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE1_HIGH_TABLE),
+                                         _mm_and_si128(_mm_srli_epi16(prev1, 4), nibbleMask));
+    __m128i byte1Low = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE1_LOW_TABLE), _mm_and_si128(prev1, nibbleMask));
+    __m128i byte2High = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE2_HIGH_TABLE),
+                                         _mm_and_si128(_mm_srli_epi16(input, 4), nibbleMask));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+    /* only 111_____ and 1111____ respectively will be >= 0x80 */
+    __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                                  _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80)));
+    must23 = _mm_and_si128(must23, _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(must23, special);
+}
+
+UTF8_TARGET_SSSE3 static inline bool is_valid_utf8_ssse3(const uint8_t *ptr, size_t n)
+{
+    const uint8_t *end = ptr + n;
+    const __m128i incompleteMax = _mm_setr_epi8(UTF8_INCOMPLETE_MAX_16);
+    __m128i error = _mm_setzero_si128();
+    __m128i previous = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+
+    while (end - ptr >= 16) {
+        __m128i input = _mm_loadu_si128((const __m128i *)ptr);
+        if (_mm_movemask_epi8(input) == 0) {
+            /* ASCII block: only need to check that the previous one didn't end mid-sequence */
+            error = _mm_or_si128(error, incomplete);
+        } else {
+            error = _mm_or_si128(error, check_utf8_block_ssse3(input, previous));
+            incomplete = _mm_subs_epu8(input, incompleteMax);
+        }
+        previous = input;
+        ptr += 16;
+    }
+
+    if (ptr != end) {
+        /* pad the tail with zeroes, which makes any incomplete sequence fail */
+        uint8_t block[16] = { 0 };
+        memcpy(block, ptr, (size_t)(end - ptr));
+        error = _mm_or_si128(error, check_utf8_block_ssse3(_mm_loadu_si128((const __m128i *)block), previous));
+    } else {
+        error = _mm_or_si128(error, incomplete);
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+}
+#endif
+
+#if defined(__AVX2__)
+static inline bool is_valid_utf8(const uint8_t *ptr, size_t n)
+{
+    return is_valid_utf8_avx2(ptr, n);
+}
+#elif defined(CBOR_UTF8_DISPATCH)
+typedef bool (*Utf8ValidatorFunction)(const uint8_t *ptr, size_t n);
+
+static inline Utf8ValidatorFunction select_utf8_validator(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return is_valid_utf8_avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        return is_valid_utf8_ssse3;
+    return is_valid_utf8_scalar;
+}
+
+static inline bool is_valid_utf8(const uint8_t *ptr, size_t n)
+{
+    static Utf8ValidatorFunction validator;
+    if (n < 16)
+        return is_valid_utf8_scalar(ptr, n);    /* not worth an indirect call */
+    if (unlikely(!validator))
+        validator = select_utf8_validator();
+    return validator(ptr, n);
+}
+#elif defined(__SSSE3__)
+static inline bool is_valid_utf8(const uint8_t *ptr, size_t n)
+{
+    return is_valid_utf8_ssse3(ptr, n);
+}
+#else
+static inline bool is_valid_utf8(const uint8_t *ptr, size_t n)
+{
+    return is_valid_utf8_scalar(ptr, n);
+}
+#endif
+
 #endif /* CBOR_UTF8_H */
@@ -0,0 +1,716 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#include "cbor.h"
+#include "cborjson.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Throughput benchmark for the TinyCBOR hot paths. Each corpus is generated
+ * in memory with the encoder, then every operation is repeated over it until
+ * at least the minimum measuring time has elapsed. Results are printed as
+ * one line per (operation, corpus) pair, in MB/s of CBOR data and items/s.
+ */
+
+typedef struct Corpus Corpus;
+typedef CborError (*GeneratorFunction)(CborEncoder *encoder);
+typedef CborError (*BenchmarkFunction)(const Corpus *corpus, size_t *items);
+
+struct Corpus
+{
+    const char *name;
+    GeneratorFunction generate;
+    uint8_t *data;
+    size_t size;
+    size_t itemCount;       /* number of data items, including containers and tags */
+    bool canonical;         /* whether the corpus passes strict validation */
+};
+
+static double minimumTime = 0.5;
+static FILE *devnull;
+
+static void *xmalloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (ptr == NULL) {
+        fprintf(stderr, "cborbench: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void check(CborError err, const char *what)
+{
+    if (err) {
+        fprintf(stderr, "cborbench: %s: %s\n", what, cbor_error_string(err));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Corpora
+ */
+
+/* An array of telemetry-like records, each a map containing a chain of
+ * nested maps several levels deep. */
+enum { NestedRecordCount = 4096, NestedDepth = 12 };
+static const uint8_t payload[16] = { 0xde, 0xad, 0xbe, 0xef };
+
+static CborError generate_nested_level(CborEncoder *encoder, int level, unsigned seed)
+{
+    /* keys are in canonical order, so the corpus passes strict validation */
+    CborEncoder map, array;
+    CborError err = cbor_encoder_create_map(encoder, &map, level ? 4 : 8);
+    if (!level) {
+        err |= cbor_encode_text_stringz(&map, "id");
+        err |= cbor_encode_uint(&map, seed);
+        err |= cbor_encode_text_stringz(&map, "name");
+        err |= cbor_encode_text_stringz(&map, "sensor-telemetry-record");
+    }
+    err |= cbor_encode_text_stringz(&map, "next");
+    if (level < NestedDepth)
+        err |= generate_nested_level(&map, level + 1, seed);
+    else
+        err |= cbor_encode_null(&map);
+    err |= cbor_encode_text_stringz(&map, "ratio");
+    err |= cbor_encode_double(&map, seed / 7.0);
+    if (!level) {
+        err |= cbor_encode_text_stringz(&map, "enabled");
+        err |= cbor_encode_boolean(&map, seed & 1);
+    }
+    err |= cbor_encode_text_stringz(&map, "payload");
+    err |= cbor_encode_byte_string(&map, payload, sizeof(payload));
+    err |= cbor_encode_text_stringz(&map, "samples");
+    err |= cbor_encoder_create_array(&map, &array, 8);
+    for (int i = 0; i < 8; ++i)
+        err |= cbor_encode_int(&array, (int)(seed * 31 + i * 1000) - 4000);
+    err |= cbor_encoder_close_container(&map, &array);
+    if (!level) {
+        err |= cbor_encode_text_stringz(&map, "timestamp");
+        err |= cbor_encode_tag(&map, CborUnixTime_tTag);
+        err |= cbor_encode_uint(&map, 1600000000U + seed);
+    }
+    return err | cbor_encoder_close_container(encoder, &map);
+}
+
+static CborError generate_nested(CborEncoder *encoder)
+{
+    CborEncoder array;
+    CborError err = cbor_encoder_create_array(encoder, &array, NestedRecordCount);
+    for (unsigned i = 0; i < NestedRecordCount; ++i)
+        err |= generate_nested_level(&array, 0, i);
+    return err | cbor_encoder_close_container(encoder, &array);
+}
+
+/* A few large byte strings, as found in firmware or media payloads. */
+enum { ByteStringCount = 64, ByteStringSize = 64 * 1024 };
+static CborError generate_bytestrings(CborEncoder *encoder)
+{
+    static uint8_t blob[ByteStringSize];
+    if (blob[1] == 0) {
+        for (size_t i = 0; i < sizeof(blob); ++i)
+            blob[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+
+    CborEncoder array;
+    CborError err = cbor_encoder_create_array(encoder, &array, ByteStringCount);
+    for (int i = 0; i < ByteStringCount; ++i)
+        err |= cbor_encode_byte_string(&array, blob, sizeof(blob));
+    return err | cbor_encoder_close_container(encoder, &array);
+}
+
+/* A long array of mostly small integers of both signs. */
+enum { IntegerCount = 1024 * 1024 };
+static CborError generate_integers(CborEncoder *encoder)
+{
+    CborEncoder array;
+    CborError err = cbor_encoder_create_array(encoder, &array, IntegerCount);
+    for (int i = 0; i < IntegerCount; ++i) {
+        int64_t v = i % 24;
+        if (i % 8 == 7)
+            v = (int64_t)i * 37;
+        if (i % 3 == 2)
+            v = -v - 1;
+        err |= cbor_encode_int(&array, v);
+    }
+    return err | cbor_encoder_close_container(encoder, &array);
+}
+
+/* A long array of integers that all fit in the initial byte, like the
+ * readings of a low-resolution sensor. */
+static CborError generate_tiny_integers(CborEncoder *encoder)
+{
+    CborEncoder array;
+    CborError err = cbor_encoder_create_array(encoder, &array, IntegerCount);
+    for (int i = 0; i < IntegerCount; ++i) {
+        int64_t v = (i * 7) % 24;
+        if (i % 5 == 4)
+            v = -v - 1;
+        err |= cbor_encode_int(&array, v);
+    }
+    return err | cbor_encoder_close_container(encoder, &array);
+}
+
+/* Indefinite-length arrays of chunked (indefinite-length) text strings. The
+ * encoder API has no support for chunked strings, so they're written raw. */
+enum { ChunkedStringCount = 16384, ChunksPerString = 16, ChunkSize = 16 };
+static CborError generate_chunked(CborEncoder *encoder)
+{
+    static const char chunk[ChunkSize + 1] = "0123456789abcdef";
+    uint8_t buf[1 + ChunksPerString * (1 + ChunkSize) + 1];
+    uint8_t *ptr = buf;
+    *ptr++ = 0x7f;              /* text string, indefinite length */
+    for (int i = 0; i < ChunksPerString; ++i) {
+        *ptr++ = 0x60 + ChunkSize;
+        memcpy(ptr, chunk, ChunkSize);
+        ptr += ChunkSize;
+    }
+    *ptr++ = 0xff;              /* break */
+
+    CborEncoder array;
+    CborError err = cbor_encoder_create_array(encoder, &array, CborIndefiniteLength);
+    for (int i = 0; i < ChunkedStringCount; ++i) {
+        /* encode a placeholder and overwrite it with the chunked string */
+        uint8_t *where = array.data.ptr;
+        err |= cbor_encode_byte_string(&array, buf, sizeof(buf) - 3);
+        if (!err)
+            memcpy(where, buf, sizeof(buf));
+    }
+    return err | cbor_encoder_close_container(encoder, &array);
+}
+
+static Corpus corpora[] = {
+    { "nested-maps", generate_nested, NULL, 0, 0, true },
+    { "bytestrings", generate_bytestrings, NULL, 0, 0, true },
+    { "small-integers", generate_integers, NULL, 0, 0, true },
+    { "tiny-integers", generate_tiny_integers, NULL, 0, 0, true },
+    { "chunked-strings", generate_chunked, NULL, 0, 0, false },
+};
+
+static size_t count_items(CborValue *it)
+{
+    size_t count = 0;
+    while (!cbor_value_at_end(it)) {
+        ++count;
+        if (cbor_value_is_container(it)) {
+            CborValue recursed;
+            check(cbor_value_enter_container(it, &recursed), "enter_container");
+            count += count_items(&recursed);
+            check(cbor_value_leave_container(it, &recursed), "leave_container");
+        } else {
+            check(cbor_value_advance(it), "advance");
+        }
+    }
+    return count;
+}
+
+static void prepare_corpus(Corpus *corpus)
+{
+    /* first pass: calculate the size; second pass: encode for real */
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, NULL, 0, 0);
+    CborError err = corpus->generate(&encoder);
+    if (err != CborErrorOutOfMemory)
+        check(err, corpus->name);
+
+    corpus->size = cbor_encoder_get_extra_bytes_needed(&encoder);
+    corpus->data = xmalloc(corpus->size);
+    cbor_encoder_init(&encoder, corpus->data, corpus->size, 0);
+    check(corpus->generate(&encoder), corpus->name);
+
+    CborParser parser;
+    CborValue it;
+    check(cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it), corpus->name);
+    CborValue element;
+    check(cbor_value_enter_container(&it, &element), corpus->name);
+    corpus->itemCount = 1 + count_items(&element);
+}
+
+/*
+ * Benchmarks
+ */
+
+static CborError bench_advance(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it, element;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_enter_container(&it, &element);
+    while (!err && !cbor_value_at_end(&element))
+        err = cbor_value_advance(&element);
+    *items = corpus->itemCount;
+    return err;
+}
+
+static CborError bench_skip(const Corpus *corpus, size_t *items)
+{
+    /* skip over the top-level item in one call, as when ignoring a field */
+    CborParser parser;
+    CborValue it;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_advance(&it);
+    *items = corpus->itemCount;
+    return err;
+}
+
+static CborError bench_walk(const Corpus *corpus, size_t *items)
+{
+    /* visit every item by hand, as the pretty printer and JSON converter do */
+    CborParser parser;
+    CborValue it;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        *items = count_items(&it);
+    return err;
+}
+
+static CborError count_value(void *context)
+{
+    ++*(size_t *)context;
+    return CborNoError;
+}
+static CborError count_uint(void *context, uint64_t value)
+{
+    (void)value;
+    return count_value(context);
+}
+static CborError count_length(void *context, size_t length)
+{
+    (void)length;
+    return count_value(context);
+}
+static CborError count_string(void *context, CborType type, size_t length)
+{
+    (void)type;
+    (void)length;
+    return count_value(context);
+}
+
+static CborError bench_callbacks(const Corpus *corpus, size_t *items)
+{
+    static const CborCallbacks callbacks = {
+        .on_uint = count_uint,
+        .on_negative_int = count_uint,
+        .on_tag = count_uint,
+        .on_null = count_value,
+        .on_string_start = count_string,
+        .on_array_start = count_length,
+        .on_map_start = count_length,
+    };
+    *items = 0;
+    return cbor_parse_with_callbacks(corpus->data, corpus->size, &callbacks, items);
+}
+
+static int64_t integerBuffer[IntegerCount];
+
+static CborError bench_get_int64(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it, element;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_enter_container(&it, &element);
+
+    *items = 0;
+    if (!err && !cbor_value_is_integer(&element))
+        return CborNoError;
+    while (!err && !cbor_value_at_end(&element) && *items < IntegerCount) {
+        err = cbor_value_get_int64_checked(&element, &integerBuffer[*items]);
+        if (!err)
+            err = cbor_value_advance_fixed(&element);
+        ++*items;
+    }
+    return err;
+}
+
+static CborError bench_get_int64_array(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it, element;
+    size_t count = IntegerCount;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_enter_container(&it, &element);
+
+    *items = 0;
+    if (err || !cbor_value_is_integer(&element))
+        return err;
+    err = cbor_value_get_int64_array(&it, integerBuffer, &count, NULL);
+    *items = count;
+    return err;
+}
+
+static CborError bench_map_find_value(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it, element;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_enter_container(&it, &element);
+
+    *items = 0;
+    if (!err && !cbor_value_is_map(&element))
+        return CborNoError;
+    while (!err && !cbor_value_at_end(&element)) {
+        if (cbor_value_is_map(&element)) {
+            /* look up a key at the start, the middle and the end */
+            CborValue value;
+            err = cbor_value_map_find_value(&element, "id", &value);
+            if (!err)
+                err = cbor_value_map_find_value(&element, "enabled", &value);
+            if (!err)
+                err = cbor_value_map_find_value(&element, "timestamp", &value);
+            *items += 3;
+        }
+        if (!err)
+            err = cbor_value_advance(&element);
+    }
+    return err;
+}
+
+static CborError bench_map_find_values(const Corpus *corpus, size_t *items)
+{
+    static const char *const keys[] = { "id", "enabled", "timestamp" };
+    CborParser parser;
+    CborValue it, element;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_enter_container(&it, &element);
+
+    *items = 0;
+    if (!err && !cbor_value_is_map(&element))
+        return CborNoError;
+    while (!err && !cbor_value_at_end(&element)) {
+        CborValue values[sizeof(keys) / sizeof(keys[0])];
+        err = cbor_value_map_find_values(&element, keys, sizeof(keys) / sizeof(keys[0]), values);
+        *items += sizeof(keys) / sizeof(keys[0]);
+        if (!err)
+            err = cbor_value_advance(&element);
+    }
+    return err;
+}
+
+static CborError bench_validate(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_validate(&it, CborValidateBasic);
+    *items = corpus->itemCount;
+    return err;
+}
+
+static CborError bench_validate_strict(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it;
+    *items = 0;
+    if (!corpus->canonical)
+        return CborNoError;
+
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_validate(&it, CborValidateStrictMode | CborValidateCompleteData);
+    *items = corpus->itemCount;
+    return err;
+}
+
+static CborError bench_validate_then_find(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_validate(&it, CborValidateBasic);
+    if (err)
+        return err;
+    return bench_map_find_value(corpus, items);
+}
+
+static CborIndexEntry *indexEntries;
+static size_t indexCapacity;
+
+static CborError bench_validate_and_index(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it, first;
+    CborDocumentIndex index;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    *items = 0;
+    if (!err)
+        err = cbor_value_enter_container(&it, &first);
+    if (err || !cbor_value_is_map(&first))
+        return err;
+
+    if (indexCapacity < corpus->itemCount) {
+        free(indexEntries);
+        indexCapacity = corpus->itemCount;
+        indexEntries = xmalloc(indexCapacity * sizeof(CborIndexEntry));
+    }
+    err = cbor_value_validate_and_index(&it, CborValidateBasic, &index, indexEntries, indexCapacity);
+
+    /* the elements of the top-level array start at position 1 */
+    for (size_t i = 1; !err && i < index.count; i = indexEntries[i].next) {
+        if (indexEntries[i].type == CborMapType) {
+            size_t value;
+            err = cbor_document_index_map_find_value(&index, i, "id", &value);
+            if (!err)
+                err = cbor_document_index_map_find_value(&index, i, "enabled", &value);
+            if (!err)
+                err = cbor_document_index_map_find_value(&index, i, "timestamp", &value);
+            *items += 3;
+        }
+    }
+    return err;
+}
+
+static CborError bench_encode(const Corpus *corpus, size_t *items)
+{
+    static uint8_t *buffer;
+    static size_t buffersize;
+    if (buffersize < corpus->size) {
+        free(buffer);
+        buffer = xmalloc(corpus->size);
+        buffersize = corpus->size;
+    }
+
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, buffer, buffersize, 0);
+    *items = corpus->itemCount;
+    return corpus->generate(&encoder);
+}
+
+/* Re-encodes the integers of an integer corpus, which are decoded once and
+ * cached, with one cbor_encode_int_array() call. */
+static CborError bench_encode_int_array(const Corpus *corpus, size_t *items)
+{
+    static int64_t values[IntegerCount];
+    static const Corpus *decoded;
+    static size_t count;
+    static uint8_t *buffer;
+    static size_t buffersize;
+    CborEncoder encoder, array;
+    CborError err;
+
+    *items = 0;
+    if (decoded != corpus) {
+        CborParser parser;
+        CborValue it;
+        decoded = corpus;
+        count = IntegerCount;
+        if (cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it) != CborNoError ||
+                !cbor_value_is_array(&it) ||
+                cbor_value_get_int64_array(&it, values, &count, NULL) != CborNoError)
+            count = 0;
+    }
+    if (count == 0)
+        return CborNoError;
+    if (buffersize < corpus->size) {
+        free(buffer);
+        buffer = xmalloc(corpus->size);
+        buffersize = corpus->size;
+    }
+
+    cbor_encoder_init(&encoder, buffer, buffersize, 0);
+    err = cbor_encoder_create_array(&encoder, &array, count);
+    if (!err)
+        err = cbor_encode_int_array(&array, values, count);
+    if (!err)
+        err = cbor_encoder_close_container(&encoder, &array);
+    *items = count + 1;
+    return err;
+}
+
+static CborError bench_to_json(const Corpus *corpus, size_t *items)
+{
+    CborParser parser;
+    CborValue it;
+    CborError err = cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it);
+    if (!err)
+        err = cbor_value_to_json_advance(devnull, &it, CborConvertDefaultFlags);
+    *items = corpus->itemCount;
+    return err;
+}
+
+/* Converts the JSON equivalent of the corpus, which is generated once and
+ * cached, back to CBOR with a counting encoder. */
+static CborError bench_from_json(const Corpus *corpus, size_t *items)
+{
+    static CborGrowableBuffer json;
+    static const Corpus *converted;
+    CborEncoder encoder;
+
+    *items = 0;
+    if (converted != corpus) {
+        CborParser parser;
+        CborValue it;
+        converted = corpus;
+        cbor_growable_buffer_free(&json);
+        cbor_growable_buffer_init(&json, NULL, 0);
+        if (cbor_parser_init(corpus->data, corpus->size, 0, &parser, &it) != CborNoError ||
+                cbor_value_to_json_buffer_advance(&json, &it, CborConvertDefaultFlags) != CborNoError)
+            json.size = 0;
+    }
+    if (json.size == 0)
+        return CborNoError;
+
+    cbor_encoder_init_counting(&encoder);
+    *items = corpus->itemCount;
+    return cbor_encode_from_json_buffer(&encoder, (const char *)json.data, json.size,
+                                        CborConvertFromJsonDefaultFlags);
+}
+
+static const struct Benchmark
+{
+    const char *name;
+    BenchmarkFunction run;
+} benchmarks[] = {
+    { "advance", bench_advance },
+    { "skip", bench_skip },
+    { "walk", bench_walk },
+    { "callbacks", bench_callbacks },
+    { "get_int64", bench_get_int64 },
+    { "get_int64_array", bench_get_int64_array },
+    { "map_find_value", bench_map_find_value },
+    { "map_find_values", bench_map_find_values },
+    { "validate", bench_validate },
+    { "validate_strict", bench_validate_strict },
+    { "validate_then_find", bench_validate_then_find },
+    { "validate_and_index", bench_validate_and_index },
+    { "encode", bench_encode },
+    { "encode_int_array", bench_encode_int_array },
+    { "to_json_advance", bench_to_json },
+    { "from_json", bench_from_json },
+};
+
+static void run_benchmark(const struct Benchmark *bench, const Corpus *corpus)
+{
+    size_t iterations = 0, items = 0, totalItems = 0;
+    double elapsed, start = now();
+    do {
+        check(bench->run(corpus, &items), bench->name);
+        if (items == 0)
+            return;     /* operation not applicable to this corpus */
+        totalItems += items;
+        ++iterations;
+        elapsed = now() - start;
+    } while (elapsed < minimumTime);
+
+    printf("%-18s %-16s %10.1f MB/s %12.0f items/s %8zu iterations\n",
+           bench->name, corpus->name,
+           (double)corpus->size * iterations / elapsed / (1024 * 1024),
+           totalItems / elapsed, iterations);
+}
+
+static void usage(void)
+{
+    printf("Usage: cborbench [OPTION]... [FILTER]...\n"
+           "Measures the throughput of the TinyCBOR parser, encoder, validator and JSON\n"
+           "converter. If FILTERs are given, only the benchmarks or corpora whose name\n"
+           "contains one of them are run.\n"
+           "\n"
+           "Options:\n"
+           " -t SECONDS   Minimum time to run each benchmark for (default %g)\n"
+           " -l           List the benchmarks and corpora and exit\n"
+           " -h           Print this help message and exit\n",
+           minimumTime);
+}
+
+static bool matches(int argc, char **argv, const char *benchname, const char *corpusname)
+{
+    if (argc == 0)
+        return true;
+    for (int i = 0; i < argc; ++i) {
+        if (strstr(benchname, argv[i]) || strstr(corpusname, argv[i]))
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t benchCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    const size_t corpusCount = sizeof(corpora) / sizeof(corpora[0]);
+    int c;
+    while ((c = getopt(argc, argv, "t:lh")) != -1) {
+        switch (c) {
+        case 't':
+            minimumTime = strtod(optarg, NULL);
+            break;
+
+        case 'l':
+            for (size_t i = 0; i < benchCount; ++i)
+                printf("benchmark: %s\n", benchmarks[i].name);
+            for (size_t i = 0; i < corpusCount; ++i)
+                printf("corpus: %s\n", corpora[i].name);
+            return EXIT_SUCCESS;
+
+        case '?':
+            fprintf(stderr, "Unknown option -%c.\n", optopt);
+            /* fall through */
+        case 'h':
+            usage();
+            return c == '?' ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    devnull = fopen("/dev/null", "w");
+    if (!devnull) {
+        fprintf(stderr, "cborbench: /dev/null: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < corpusCount; ++i) {
+        Corpus *corpus = &corpora[i];
+        prepare_corpus(corpus);
+        printf("# corpus %s: %zu bytes, %zu items\n", corpus->name, corpus->size, corpus->itemCount);
+        for (size_t j = 0; j < benchCount; ++j) {
+            if (matches(argc, argv, benchmarks[j].name, corpus->name))
+                run_benchmark(&benchmarks[j], corpus);
+        }
+        free(corpus->data);
+        fflush(stdout);
+    }
+
+    fclose(devnull);
+    return EXIT_SUCCESS;
+}
@@ -24,10 +24,19 @@
 
 #include "../../src/cborencoder.c"
 #include "../../src/cborencoder_float.c"
+#include "../../src/cborencoder_array.c"
+#include "../../src/cborencoder_buffered_writer.c"
+#include "../../src/cborencoder_growable_buffer.c"
+#include "../../src/cborarena.c"
 #include "../../src/cborerrorstrings.c"
+#include "../../src/cborfromjson.c"
 #include "../../src/cborparser.c"
 #include "../../src/cborparser_dup_string.c"
 #include "../../src/cborparser_float.c"
+#include "../../src/cborparser_array.c"
+#include "../../src/cborparser_stream.c"
+#include "../../src/cborparser_callbacks.c"
+#include "../../src/cborparser_index.c"
 #include "../../src/cborvalidation.c"
 
 #include <QtTest>
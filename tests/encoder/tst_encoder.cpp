@@ -61,6 +61,8 @@ private slots:
     void floatAsHalfFloatCloseToZero_data();
     void floatAsHalfFloatCloseToZero();
     void floatAsHalfFloatNaN();
+    void doubleShortest_data();
+    void doubleShortest();
     void fixed_data();
     void fixed();
     void strings_data();
@@ -73,9 +75,19 @@ private slots:
     void arrays();
     void maps_data() { tags_data(); }
     void maps();
+    void sortedMaps_data();
+    void sortedMaps();
+    void sortedMapsWriter();
 
     void writerApi_data() { tags_data(); }
     void writerApi();
+    void bufferedWriter_data() { tags_data(); }
+    void bufferedWriter();
+    void growableBuffer_data() { tags_data(); }
+    void growableBuffer();
+    void counting_data() { tags_data(); }
+    void counting();
+    void encodedSizes();
     void writerApiFail_data() { tags_data(); }
     void writerApiFail();
     void shortBuffer_data() { tags_data(); }
@@ -90,6 +102,8 @@ private slots:
     void tooBigMaps();
     void illegalSimpleType_data();
     void illegalSimpleType();
+    void numberArrays();
+    void typedArrays();
 };
 
 #include "tst_encoder.moc"
@@ -319,6 +333,73 @@ void tst_Encoder::floatAsHalfFloatNaN()
     QVERIFY((manth | mantl) != 0);
 }
 
+void tst_Encoder::doubleShortest_data()
+{
+    QTest::addColumn<QByteArray>("output");
+    QTest::addColumn<double>("input");
+    QTest::addColumn<int>("flags");
+
+    auto fromBits = [](quint64 bits) {
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return d;
+    };
+    const int ints = CborShortestFloatAllowIntegers;
+
+    QTest::newRow("0.") << raw("\xf9\0\0") << 0.0 << 0;
+    QTest::newRow("0.-int") << raw("\0") << 0.0 << ints;
+    QTest::newRow("-0.") << raw("\xf9\x80\0") << -0.0 << 0;
+    QTest::newRow("-0.-int") << raw("\xf9\x80\0") << -0.0 << ints;
+    QTest::newRow("1.") << raw("\xf9\x3c\0") << 1.0 << 0;
+    QTest::newRow("1.-int") << raw("\1") << 1.0 << ints;
+    QTest::newRow("-25.") << raw("\xf9\xce\x40") << -25.0 << 0;
+    QTest::newRow("-25.-int") << raw("\x38\x18") << -25.0 << ints;
+    QTest::newRow("255.-int") << raw("\x18\xff") << 255.0 << ints;
+    QTest::newRow("256.-int") << raw("\x19\1\0") << 256.0 << ints;
+    QTest::newRow("1.5") << raw("\xf9\x3e\0") << 1.5 << 0;
+    QTest::newRow("1.5-int") << raw("\xf9\x3e\0") << 1.5 << ints;
+    QTest::newRow("65504.") << raw("\xf9\x7b\xff") << 65504.0 << 0;
+    QTest::newRow("65504.-int") << raw("\x19\xff\xe0") << 65504.0 << ints;
+    QTest::newRow("65536.") << raw("\xfa\x47\x80\0\0") << 65536.0 << 0;
+    QTest::newRow("65536.-int") << raw("\x1a\0\1\0\0") << 65536.0 << ints;
+    QTest::newRow("1e15") << raw("\xfb\x43\x0c\x6b\xf5\x26\x34\0\0") << 1e15 << 0;
+    QTest::newRow("1e15-int") << raw("\x1b\0\3\x8d\x7e\xa4\xc6\x80\0") << 1e15 << ints;
+    QTest::newRow("2^60-int") << raw("\xfa\x5d\x80\0\0") << ldexp(1.0, 60) << ints;
+    QTest::newRow("2^64-int") << raw("\xfa\x5f\x80\0\0") << ldexp(1.0, 64) << ints;
+    QTest::newRow("1/3f") << raw("\xfa\x3e\xaa\xaa\xab") << double(1.0f / 3) << 0;
+    QTest::newRow("0.1") << raw("\xfb\x3f\xb9\x99\x99\x99\x99\x99\x9a") << 0.1 << ints;
+    QTest::newRow("1e300") << raw("\xfb\x7e\x37\xe4\x3c\x88\0\x75\x9c") << 1e300 << 0;
+
+    // subnormals of each format
+    QTest::newRow("2^-24") << raw("\xf9\0\1") << ldexp(1.0, -24) << 0;
+    QTest::newRow("2^-25") << raw("\xfa\x33\0\0\0") << ldexp(1.0, -25) << 0;
+    QTest::newRow("2^-149") << raw("\xfa\0\0\0\1") << ldexp(1.0, -149) << 0;
+    QTest::newRow("2^-150") << raw("\xfb\x36\x90\0\0\0\0\0\0") << ldexp(1.0, -150) << 0;
+
+    QTest::newRow("inf") << raw("\xf9\x7c\0") << fromBits(Q_UINT64_C(0x7ff0000000000000)) << ints;
+    QTest::newRow("-inf") << raw("\xf9\xfc\0") << fromBits(Q_UINT64_C(0xfff0000000000000)) << ints;
+    QTest::newRow("nan") << raw("\xf9\x7e\0") << fromBits(Q_UINT64_C(0x7ff8000000000000)) << ints;
+    QTest::newRow("nan-float-payload") << raw("\xfa\x7f\x80\0\1") << fromBits(Q_UINT64_C(0x7ff0000020000000)) << 0;
+    QTest::newRow("nan-double-payload") << raw("\xfb\x7f\xf8\0\0\0\0\0\1") << fromBits(Q_UINT64_C(0x7ff8000000000001)) << 0;
+}
+
+void tst_Encoder::doubleShortest()
+{
+    QFETCH(QByteArray, output);
+    QFETCH(double, input);
+    QFETCH(int, flags);
+
+    compare(input, [flags](CborEncoder *encoder, double value) {
+        return cbor_encode_double_shortest(encoder, value, flags);
+    }, output);
+    if (QTest::currentTestFailed())
+        return;
+
+    compare(input, [flags](CborEncoder *encoder, double value) {
+        return cbor_encode_double_array_shortest(encoder, &value, 1, flags);
+    }, output);
+}
+
 void tst_Encoder::fixed_data()
 {
     addColumns();
@@ -482,6 +563,99 @@ void tst_Encoder::maps()
     if (QTest::currentTestFailed()) return;
 }
 
+void tst_Encoder::sortedMaps_data()
+{
+    addColumns();
+
+    QTest::newRow("emptymap") << raw("\xa0") << make_map({});
+    QTest::newRow("map-0:0-1:1") << raw("\xa2\0\0\1\1") << make_map({{0,0}, {1,1}});
+    QTest::newRow("map-1:1-0:0") << raw("\xa2\0\0\1\1") << make_map({{1,1}, {0,0}});
+    QTest::newRow("map-(-1):0-0:1") << raw("\xa2\0\1\x20\0") << make_map({{-1,0}, {0,1}});
+    QTest::newRow("map-\"b\":0-24:1-1:2") << raw("\xa3\1\2\x18\x18\1\x61\x62\0")
+                                          << make_map({{"b",0}, {24,1}, {1,2}});
+    QTest::newRow("map-\"aa\":0-\"b\":1") << raw("\xa2\x61\x62\1\x62\x61\x61\0") << make_map({{"aa",0}, {"b",1}});
+    QTest::newRow("map-1(0):0-0:0") << raw("\xa2\0\0\xc1\0\0") << make_map({{QVariant::fromValue(Tag{1, 0}),0}, {0,0}});
+    QTest::newRow("map-1:{map-1:0-0:0}-0:0") << raw("\xa2\0\0\1\xa2\0\0\1\0")
+                                              << make_map({{1, make_map({{1,0}, {0,0}})}, {0,0}});
+    QTest::newRow("array-map2") << raw("\x82\xa2\0\0\1\1\xa2\2\0\3\0")
+                                << make_list(make_map({{1,1}, {0,0}}), make_map({{3,0}, {2,0}}));
+    QTest::newRow("_map-1:1-0:0") << raw("\xbf\0\0\1\1\xff") << make_ilmap({{1,1}, {0,0}});
+
+    // too many entries to be sorted in place
+    Map map;
+    QByteArray output = "\xb8\x64";
+    for (int i = 0; i < 100; ++i) {
+        map.prepend(qMakePair(QVariant(i), QVariant(0)));
+        if (i >= 24)
+            output += '\x18';
+        output += char(i);
+        output += '\0';
+    }
+    QTest::newRow("map-100") << output << QVariant::fromValue(map);
+}
+
+void tst_Encoder::sortedMaps()
+{
+    QFETCH(QVariant, input);
+    QFETCH(QByteArray, output);
+
+    // with plenty of room and with the exact size, which may not leave
+    // enough room for the sorting and require a second attempt
+    for (int extra : {8192, 0}) {
+        QByteArray buffer(output.length() + extra, Qt::Uninitialized);
+        uint8_t *bufptr = reinterpret_cast<quint8 *>(buffer.data());
+        CborEncoder encoder;
+        cbor_encoder_init(&encoder, bufptr, buffer.length(), CborEncoderFlag_SortMapKeys);
+        CborError err = encodeVariant(&encoder, input);
+        if (err == CborErrorOutOfMemory) {
+            QCOMPARE(extra, 0);
+            buffer.resize(buffer.length() + int(cbor_encoder_get_extra_bytes_needed(&encoder)));
+            bufptr = reinterpret_cast<quint8 *>(buffer.data());
+            cbor_encoder_init(&encoder, bufptr, buffer.length(), CborEncoderFlag_SortMapKeys);
+            err = encodeVariant(&encoder, input);
+        }
+        QCOMPARE(err, CborNoError);
+        QCOMPARE(cbor_encoder_get_extra_bytes_needed(&encoder), size_t(0));
+        buffer.resize(int(cbor_encoder_get_buffer_size(&encoder, bufptr)));
+        QCOMPARE(buffer, output);
+
+        CborParser parser;
+        CborValue first;
+        QCOMPARE(cbor_parser_init(bufptr, buffer.length(), 0, &parser, &first), CborNoError);
+        QCOMPARE(cbor_value_validate(&first, CborValidateMapIsSorted & ~CborValidateNoIndeterminateLength),
+                 CborNoError);
+    }
+}
+
+void tst_Encoder::sortedMapsWriter()
+{
+    // the data has already been written when the map is closed
+    QByteArray output;
+    auto callback = [](void *token, const void *data, size_t len, CborEncoderAppendType) {
+        static_cast<QByteArray *>(token)->append(static_cast<const char *>(data), len);
+        return CborNoError;
+    };
+
+    CborEncoder encoder, container;
+    cbor_encoder_init_writer(&encoder, callback, &output);
+    encoder.flags |= CborEncoderFlag_SortMapKeys;
+    QCOMPARE(cbor_encoder_create_map(&encoder, &container, 1), CborErrorUnsupportedType);
+    QCOMPARE(cbor_encoder_create_map(&encoder, &container, CborIndefiniteLength), CborErrorUnsupportedType);
+    QVERIFY(output.isEmpty());
+
+    // arrays are not affected
+    QCOMPARE(cbor_encoder_create_array(&encoder, &container, 1), CborNoError);
+    QCOMPARE(cbor_encode_int(&container, 1), CborNoError);
+    QCOMPARE(cbor_encoder_close_container(&encoder, &container), CborNoError);
+    QCOMPARE(output, raw("\x81\1"));
+
+    CborGrowableBuffer buffer;
+    cbor_encoder_init_growable(&encoder, &buffer, nullptr, 0);
+    encoder.flags |= CborEncoderFlag_SortMapKeys;
+    QCOMPARE(cbor_encoder_create_map(&encoder, &container, 1), CborErrorUnsupportedType);
+    cbor_growable_buffer_free(&buffer);
+}
+
 void tst_Encoder::writerApi()
 {
     QFETCH(QVariant, input);
@@ -504,6 +678,165 @@ void tst_Encoder::writerApi()
     QCOMPARE(buffer.readAll(), output);
 }
 
+void tst_Encoder::bufferedWriter()
+{
+    QFETCH(QVariant, input);
+    QFETCH(QByteArray, output);
+
+    // use a buffer smaller than some of the strings, so both the buffered
+    // and the pass-through paths are exercised
+    QByteArray result;
+    int calls = 0;
+    struct Sink { QByteArray *result; int *calls; } sink = { &result, &calls };
+    auto callback = [](void *token, const void *data, size_t len, CborEncoderAppendType) {
+        auto sink = static_cast<Sink *>(token);
+        sink->result->append(static_cast<const char *>(data), len);
+        ++*sink->calls;
+        return CborNoError;
+    };
+
+    uint8_t buffer[8];
+    CborBufferedWriter bufferedWriter;
+    CborEncoder encoder;
+    cbor_encoder_init_buffered_writer(&encoder, &bufferedWriter, buffer, sizeof(buffer), callback, &sink);
+    QCOMPARE(encodeVariant(&encoder, input), CborNoError);
+    QVERIFY(result.size() + int(bufferedWriter.used) == output.size());
+    QCOMPARE(cbor_buffered_writer_flush(&bufferedWriter), CborNoError);
+    QCOMPARE(bufferedWriter.used, size_t(0));
+    QCOMPARE(result, output);
+
+    // flushing an empty buffer does not call the writer
+    int callsBefore = calls;
+    QCOMPARE(cbor_buffered_writer_flush(&bufferedWriter), CborNoError);
+    QCOMPARE(calls, callsBefore);
+}
+
+void tst_Encoder::growableBuffer()
+{
+    QFETCH(QVariant, input);
+    QFETCH(QByteArray, output);
+
+    // start with the smallest buffer, so it must grow for the longer outputs
+    CborGrowableBuffer buffer;
+    CborEncoder encoder;
+    cbor_encoder_init_growable(&encoder, &buffer, nullptr, 0);
+    QCOMPARE(encodeVariant(&encoder, input), CborNoError);
+    QVERIFY(buffer.capacity >= buffer.size);
+
+    size_t size;
+    uint8_t *data = cbor_growable_buffer_release(&buffer, &size);
+    QVERIFY(data);
+    QCOMPARE(QByteArray(reinterpret_cast<char *>(data), int(size)), output);
+    QVERIFY(!buffer.data);
+    free(data);
+
+    // allocation failures are reported and are sticky
+    static const CborAllocator failingAllocator = {
+        [](void *, size_t) -> void * { return nullptr; },
+        [](void *, void *, size_t, size_t) -> void * { return nullptr; },
+        [](void *, void *, size_t) {},
+        nullptr
+    };
+    cbor_encoder_init_growable(&encoder, &buffer, &failingAllocator, 0);
+    QCOMPARE(encodeVariant(&encoder, input), CborErrorOutOfMemory);
+    QCOMPARE(cbor_encode_uint(&encoder, 0), CborErrorOutOfMemory);
+    QVERIFY(!cbor_growable_buffer_release(&buffer, &size));
+    QCOMPARE(size, size_t(0));
+}
+
+void tst_Encoder::counting()
+{
+    QFETCH(QVariant, input);
+    QFETCH(QByteArray, output);
+
+    CborEncoder encoder;
+    cbor_encoder_init_counting(&encoder);
+    QCOMPARE(encodeVariant(&encoder, input), CborNoError);
+    QCOMPARE(cbor_encoder_get_counted_size(&encoder), size_t(output.length()));
+
+    // and the count is enough for the real encoding
+    QByteArray buffer(output.length(), Qt::Uninitialized);
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(buffer.data()), buffer.length(), 0);
+    QCOMPARE(encodeVariant(&encoder, input), CborNoError);
+    QCOMPARE(buffer, output);
+}
+
+void tst_Encoder::encodedSizes()
+{
+    static const uint64_t values[] = {
+        0, 1, 23, 24, 255, 256, 65535, 65536, 0xffffffffU, 0x100000000ULL, UINT64_MAX
+    };
+    uint8_t buffer[16];
+    CborEncoder encoder;
+    auto encodedLength = [&]() { return cbor_encoder_get_buffer_size(&encoder, buffer); };
+
+    for (uint64_t v : values) {
+        cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+        QCOMPARE(cbor_encode_uint(&encoder, v), CborNoError);
+        QCOMPARE(cbor_encoded_size_uint(v), encodedLength());
+
+        cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+        QCOMPARE(cbor_encode_tag(&encoder, v), CborNoError);
+        QCOMPARE(cbor_encoded_size_tag(v), encodedLength());
+
+        if (v) {
+            cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+            QCOMPARE(cbor_encode_negative_int(&encoder, v), CborNoError);
+            QCOMPARE(cbor_encoded_size_negative_int(v), encodedLength());
+        }
+
+        int64_t i = int64_t(v);
+        cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+        QCOMPARE(cbor_encode_int(&encoder, i), CborNoError);
+        QCOMPARE(cbor_encoded_size_int(i), encodedLength());
+        cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+        QCOMPARE(cbor_encode_int(&encoder, ~i), CborNoError);
+        QCOMPARE(cbor_encoded_size_int(~i), encodedLength());
+    }
+
+    for (size_t len : { 0, 1, 23, 24, 255, 256 }) {
+        QByteArray data(int(len), 'a');
+        QByteArray out(int(len) + 16, Qt::Uninitialized);
+        CborEncoder container;
+
+        cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(out.data()), out.length(), 0);
+        QCOMPARE(cbor_encode_text_string(&encoder, data.constData(), len), CborNoError);
+        QCOMPARE(cbor_encoded_size_text_string(len),
+                 cbor_encoder_get_buffer_size(&encoder, reinterpret_cast<quint8 *>(out.data())));
+        QCOMPARE(cbor_encoded_size_byte_string(len), cbor_encoded_size_string_header(len) + len);
+
+        cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+        QCOMPARE(cbor_encoder_create_map(&encoder, &container, len), CborNoError);
+        container.remaining = 1;    // pretend the contents were encoded
+        QCOMPARE(cbor_encoder_close_container(&encoder, &container), CborNoError);
+        QCOMPARE(cbor_encoded_size_container(len), encodedLength());
+    }
+
+    CborEncoder container;
+    cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &container, CborIndefiniteLength), CborNoError);
+    QCOMPARE(cbor_encoder_close_container(&encoder, &container), CborNoError);
+    QCOMPARE(cbor_encoded_size_container(CborIndefiniteLength), encodedLength());
+
+    for (uint8_t v : { 0, 19, 23, 32, 255 }) {
+        cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+        QCOMPARE(cbor_encode_simple_value(&encoder, v), CborNoError);
+        QCOMPARE(cbor_encoded_size_simple_value(v), encodedLength());
+    }
+
+    QCOMPARE(cbor_encoded_size_floating_point(CborHalfFloatType), size_t(3));
+    QCOMPARE(cbor_encoded_size_floating_point(CborFloatType), size_t(5));
+    QCOMPARE(cbor_encoded_size_floating_point(CborDoubleType), size_t(9));
+
+    for (double d : { 0., 1., 1.5, 65504., 1e300, -0.5, 100000. }) {
+        for (int flags : { int(CborShortestFloatDefaultFlags), int(CborShortestFloatAllowIntegers) }) {
+            cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+            QCOMPARE(cbor_encode_double_shortest(&encoder, d, flags), CborNoError);
+            QCOMPARE(cbor_encoded_size_double_shortest(d, flags), encodedLength());
+        }
+    }
+}
+
 void tst_Encoder::writerApiFail()
 {
     QFETCH(QVariant, input);
@@ -619,4 +952,96 @@ void tst_Encoder::illegalSimpleType()
     QCOMPARE(cbor_encode_simple_value(&encoder, type), CborErrorIllegalSimpleType);
 }
 
+void tst_Encoder::numberArrays()
+{
+    static const int64_t ints[] = { 0, -1, 23, -24, 24, 255, 256, -65536, 65536, INT32_MAX, INT32_MIN,
+                                    int64_t(UINT32_MAX) + 1, INT64_MAX, INT64_MIN };
+    static const uint64_t uints[] = { 0, 23, 24, 255, 256, 65535, 65536, UINT32_MAX, UINT64_MAX };
+    static const double doubles[] = { 0., -1.5, 1e300, double(INFINITY) };
+    const size_t intCount = sizeof(ints) / sizeof(ints[0]);
+    const size_t uintCount = sizeof(uints) / sizeof(uints[0]);
+    const size_t doubleCount = sizeof(doubles) / sizeof(doubles[0]);
+
+    // compare to encoding each element individually
+    QByteArray expected(256, Qt::Uninitialized), buffer(256, Qt::Uninitialized);
+    CborEncoder encoder, array;
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(expected.data()), expected.size(), 0);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &array, intCount + uintCount + doubleCount), CborNoError);
+    for (int64_t v : ints)
+        QCOMPARE(cbor_encode_int(&array, v), CborNoError);
+    for (uint64_t v : uints)
+        QCOMPARE(cbor_encode_uint(&array, v), CborNoError);
+    for (double v : doubles)
+        QCOMPARE(cbor_encode_double(&array, v), CborNoError);
+    QCOMPARE(cbor_encoder_close_container_checked(&encoder, &array), CborNoError);
+    expected.resize(int(cbor_encoder_get_buffer_size(&encoder, reinterpret_cast<quint8 *>(expected.data()))));
+
+    auto encodeArrays = [&](CborEncoder *encoder) {
+        CborEncoder array;
+        CborError err = cbor_encoder_create_array(encoder, &array, intCount + uintCount + doubleCount);
+        err = CborError(err | cbor_encode_int_array(&array, ints, intCount));
+        err = CborError(err | cbor_encode_uint_array(&array, uints, uintCount));
+        err = CborError(err | cbor_encode_double_array(&array, doubles, doubleCount));
+        return CborError(err | cbor_encoder_close_container_checked(encoder, &array));
+    };
+
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(buffer.data()), buffer.size(), 0);
+    QCOMPARE(encodeArrays(&encoder), CborNoError);
+    buffer.resize(int(cbor_encoder_get_buffer_size(&encoder, reinterpret_cast<quint8 *>(buffer.data()))));
+    QCOMPARE(buffer, expected);
+
+    // too small a buffer: the missing size is reported
+    for (int len = 0; len < expected.size(); ++len) {
+        cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(buffer.data()), len, 0);
+        QCOMPARE(encodeArrays(&encoder), CborErrorOutOfMemory);
+        QCOMPARE(cbor_encoder_get_extra_bytes_needed(&encoder), size_t(expected.size() - len));
+    }
+
+    // writer API
+    buffer.clear();
+    auto callback = [](void *token, const void *data, size_t len, CborEncoderAppendType) {
+        static_cast<QByteArray *>(token)->append(static_cast<const char *>(data), len);
+        return CborNoError;
+    };
+    cbor_encoder_init_writer(&encoder, callback, &buffer);
+    QCOMPARE(encodeArrays(&encoder), CborNoError);
+    QCOMPARE(buffer, expected);
+
+    // the elements count towards the container size
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(buffer.data()), buffer.size(), 0);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &array, 2), CborNoError);
+    QCOMPARE(cbor_encode_uint_array(&array, uints, 3), CborNoError);
+    QCOMPARE(cbor_encoder_close_container_checked(&encoder, &array), CborErrorTooManyItems);
+}
+
+void tst_Encoder::typedArrays()
+{
+    static const uint16_t words[] = { 0x102, 0x304 };
+    static const float floats[] = { 1.5f };
+    bool isLittleEndian = QSysInfo::ByteOrder == QSysInfo::LittleEndian;
+
+    compare(words, [](CborEncoder *encoder, const uint16_t *data) {
+                return cbor_encode_uint16_typed_array(encoder, data, 2);
+            }, isLittleEndian ? raw("\xd8\x45\x44\2\1\4\3") : raw("\xd8\x41\x44\1\2\3\4"));
+    compare(floats, [](CborEncoder *encoder, const float *data) {
+                return cbor_encode_float_typed_array(encoder, data, 1);
+            }, isLittleEndian ? raw("\xd8\x55\x44\0\0\xc0\x3f") : raw("\xd8\x51\x44\x3f\xc0\0\0"));
+    compare(words, [](CborEncoder *encoder, const uint16_t *data) {
+                return cbor_encode_uint8_typed_array(encoder, reinterpret_cast<const uint8_t *>(data), 0);
+            }, raw("\xd8\x40\x40"));
+
+    // the typed array counts as a single element
+    uint8_t buf[16];
+    CborEncoder encoder, container;
+    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &container, 1), CborNoError);
+    QCOMPARE(cbor_encode_uint16_typed_array(&container, words, 2), CborNoError);
+    QCOMPARE(cbor_encoder_close_container_checked(&encoder, &container), CborNoError);
+
+    // too small a buffer
+    cbor_encoder_init(&encoder, buf, 4, 0);
+    QCOMPARE(cbor_encode_uint16_typed_array(&encoder, words, 2), CborErrorOutOfMemory);
+    QCOMPARE(cbor_encoder_get_extra_bytes_needed(&encoder), size_t(3));
+}
+
 QTEST_MAIN(tst_Encoder)
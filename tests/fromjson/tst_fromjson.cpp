@@ -0,0 +1,437 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include <QtTest>
+#include "cbor.h"
+#include "cborjson.h"
+#include <locale.h>
+#include <stdio.h>
+
+Q_DECLARE_METATYPE(CborError)
+namespace QTest {
+template<> char *toString<CborError>(const CborError &err)
+{
+    return qstrdup(cbor_error_string(err));
+}
+}
+
+class tst_FromJson : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+
+    void fixed_data();
+    void fixed();
+    void textstrings_data();
+    void textstrings() { fixed(); }
+    void containers_data();
+    void containers() { fixed(); }
+    void errors_data();
+    void errors();
+    void decimalPointLocale();
+
+    void metaData_data();
+    void metaData();
+    void metaDataNotRequested();
+    void metaDataErrors_data();
+    void metaDataErrors();
+    void metaDataRoundTrip_data();
+    void metaDataRoundTrip();
+
+    void outOfMemory_data();
+    void outOfMemory();
+    void largeStream();
+    void largeContainer();
+};
+#include "tst_fromjson.moc"
+
+template <size_t N> QByteArray raw(const char (&data)[N])
+{
+    return QByteArray::fromRawData(data, N - 1);
+}
+
+void addColumns()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<QByteArray>("expected");
+}
+
+void addErrorColumns()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<CborError>("expectedError");
+}
+
+void addFixedData()
+{
+    QTest::newRow("0") << QByteArray("0") << raw("\x00");
+    QTest::newRow("1") << QByteArray("1") << raw("\x01");
+    QTest::newRow("23") << QByteArray("23") << raw("\x17");
+    QTest::newRow("24") << QByteArray("24") << raw("\x18\x18");
+    QTest::newRow("2^32") << QByteArray("4294967296") << raw("\x1b\x00\x00\x00\x01\x00\x00\x00" "\x00");
+    QTest::newRow("2^64-1") << QByteArray("18446744073709551615") << raw("\x1b\xff\xff\xff\xff\xff\xff\xff" "\xff");
+    QTest::newRow("-1") << QByteArray("-1") << raw("\x20");
+    QTest::newRow("-0") << QByteArray("-0") << raw("\x00");
+    QTest::newRow("-24") << QByteArray("-24") << raw("\x37");
+    QTest::newRow("-2^63") << QByteArray("-9223372036854775808") << raw("\x3b\x7f\xff\xff\xff\xff\xff\xff" "\xff");
+    QTest::newRow("-2^64") << QByteArray("-18446744073709551616") << raw("\xfb\xc3\xf0\x00\x00\x00\x00\x00" "\x00");
+    QTest::newRow("2^64") << QByteArray("18446744073709551616") << raw("\xfb\x43\xf0\x00\x00\x00\x00\x00" "\x00");
+    QTest::newRow("1.0") << QByteArray("1.0") << raw("\x01");
+    QTest::newRow("-1.0") << QByteArray("-1.0") << raw("\x20");
+    QTest::newRow("1e3") << QByteArray("1e3") << raw("\x19\x03\xe8");
+    QTest::newRow("1E+2") << QByteArray("1E+2") << raw("\x18\x64");
+    QTest::newRow("0.5") << QByteArray("0.5") << raw("\xfb\x3f\xe0\x00\x00\x00\x00\x00" "\x00");
+    QTest::newRow("-0.0") << QByteArray("-0.0") << raw("\xfb\x80\x00\x00\x00\x00\x00\x00" "\x00");
+    QTest::newRow("1.5e-2") << QByteArray("1.5e-2") << raw("\xfb\x3f\x8e\xb8\x51\xeb\x85\x1e" "\xb8");
+    QTest::newRow("false") << QByteArray("false") << raw("\xf4");
+    QTest::newRow("true") << QByteArray("true") << raw("\xf5");
+    QTest::newRow("null") << QByteArray("null") << raw("\xf6");
+    QTest::newRow("whitespace") << QByteArray(" \x09\x0d\x0a""1\x0a") << raw("\x01");
+}
+
+void addTextStringsData()
+{
+    QTest::newRow("empty") << QByteArray("\"\"") << raw("\x60");
+    QTest::newRow("Hello") << QByteArray("\"Hello\"") << raw("\x65\x48\x65\x6c\x6c\x6f");
+    QTest::newRow("escapes") << QByteArray("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"") << raw("\x68\x22\x5c\x2f\x08\x0c\x0a\x0d" "\x09");
+    QTest::newRow("u0000") << QByteArray("\"\\u0000\"") << raw("\x61\x00");
+    QTest::newRow("u00e9") << QByteArray("\"\\u00e9\"") << raw("\x62\xc3\xa9");
+    QTest::newRow("u00E9") << QByteArray("\"\\u00E9\"") << raw("\x62\xc3\xa9");
+    QTest::newRow("u20ac") << QByteArray("\"\\u20ac\"") << raw("\x63\xe2\x82\xac");
+    QTest::newRow("surrogate-pair") << QByteArray("\"\\ud83d\\ude00\"") << raw("\x64\xf0\x9f\x98\x80");
+    QTest::newRow("utf8") << QByteArray("\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"") << raw("\x69\xc3\xa9\xe2\x82\xac\xf0\x9f" "\x98\x80");
+    QTest::newRow("mixed") << QByteArray("\"a\\tb\"") << raw("\x63\x61\x09\x62");
+}
+
+void addContainersData()
+{
+    QTest::newRow("emptyarray") << QByteArray("[]") << raw("\x80");
+    QTest::newRow("emptymap") << QByteArray("{}") << raw("\xa0");
+    QTest::newRow("emptyarray-whitespace") << QByteArray("[ \n ]") << raw("\x80");
+    QTest::newRow("array") << QByteArray("[1, 2, 3]") << raw("\x83\x01\x02\x03");
+    QTest::newRow("nested-array") << QByteArray("[[1], [[]], []]") << raw("\x83\x81\x01\x81\x80\x80");
+    QTest::newRow("map") << QByteArray("{\"a\": 1, \"b\": [true]}") << raw("\xa2\x61\x61\x01\x61\x62\x81\xf5");
+    QTest::newRow("nested-map") << QByteArray("{\"a\": {\"b\": {}}}") << raw("\xa1\x61\x61\xa1\x61\x62\xa0");
+    QTest::newRow("array-of-maps") << QByteArray("[{\"x\": null}, {}]") << raw("\x82\xa1\x61\x78\xf6\xa0");
+    QTest::newRow("brackets-in-strings") << QByteArray("[\"[\", \"\\\"]\", {\"{,\": \"}\"}]")
+                                         << raw("\x83\x61[\x62\"]\xa1\x62{,\x61}");
+    QTest::newRow("backslashes") << QByteArray("[\"\\\\\", \"\\\\\\\"\", 1]") << raw("\x83\x61\\\x62\\\"\x01");
+}
+
+CborError convertBuffer(const QByteArray &json, QByteArray *output, int flags)
+{
+    CborGrowableBuffer buffer;
+    CborEncoder encoder;
+    cbor_encoder_init_growable(&encoder, &buffer, nullptr, 0);
+    CborError err = cbor_encode_from_json_buffer(&encoder, json.constData(), json.size(), flags);
+    *output = QByteArray(reinterpret_cast<const char *>(buffer.data), int(buffer.size));
+    cbor_growable_buffer_free(&buffer);
+    return err;
+}
+
+CborError convertStream(const QByteArray &json, QByteArray *output, int flags)
+{
+    FILE *f = tmpfile();
+    if (!f)
+        return CborErrorIO;
+    if (fwrite(json.constData(), 1, json.size(), f) != size_t(json.size())) {
+        fclose(f);
+        return CborErrorIO;
+    }
+    rewind(f);
+
+    CborGrowableBuffer buffer;
+    CborEncoder encoder;
+    cbor_encoder_init_growable(&encoder, &buffer, nullptr, 0);
+    CborError err = cbor_encode_from_json(&encoder, f, flags);
+    *output = QByteArray(reinterpret_cast<const char *>(buffer.data), int(buffer.size));
+    cbor_growable_buffer_free(&buffer);
+    fclose(f);
+    return err;
+}
+
+void compareOne(const QByteArray &json, const QByteArray &expected, int flags)
+{
+    QByteArray output;
+    QCOMPARE(convertBuffer(json, &output, flags), CborNoError);
+    QCOMPARE(output.toHex(), expected.toHex());
+
+    QCOMPARE(convertStream(json, &output, flags), CborNoError);
+    QCOMPARE(output.toHex(), expected.toHex());
+}
+
+void compareError(const QByteArray &json, CborError expectedError, int flags)
+{
+    QByteArray output;
+    QCOMPARE(convertBuffer(json, &output, flags), expectedError);
+    QCOMPARE(convertStream(json, &output, flags), expectedError);
+}
+
+void tst_FromJson::initTestCase()
+{
+    setlocale(LC_ALL, "C");
+}
+
+void tst_FromJson::fixed_data()
+{
+    addColumns();
+    addFixedData();
+}
+
+void tst_FromJson::fixed()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(QByteArray, expected);
+
+    compareOne(json, expected, CborConvertFromJsonDefaultFlags);
+}
+
+void tst_FromJson::textstrings_data()
+{
+    addColumns();
+    addTextStringsData();
+}
+
+void tst_FromJson::containers_data()
+{
+    addColumns();
+    addContainersData();
+}
+
+void tst_FromJson::errors_data()
+{
+    addErrorColumns();
+    QTest::newRow("empty") << QByteArray("") << CborErrorUnexpectedEOF;
+    QTest::newRow("unterminated-array") << QByteArray("[1,") << CborErrorUnexpectedEOF;
+    QTest::newRow("unterminated-string") << QByteArray("\"abc") << CborErrorUnexpectedEOF;
+    QTest::newRow("garbage") << QByteArray("1 2") << CborErrorGarbageAtEnd;
+    QTest::newRow("trailing-comma") << QByteArray("[1,]") << CborErrorJsonSyntax;
+    QTest::newRow("non-string-key") << QByteArray("{1:2}") << CborErrorJsonSyntax;
+    QTest::newRow("leading-zero") << QByteArray("01") << CborErrorJsonSyntax;
+    QTest::newRow("leading-plus") << QByteArray("+1") << CborErrorJsonSyntax;
+    QTest::newRow("bare-word") << QByteArray("nan") << CborErrorJsonSyntax;
+    QTest::newRow("truncated-literal") << QByteArray("tru") << CborErrorUnexpectedEOF;
+    QTest::newRow("bad-escape") << QByteArray("\"\\x\"") << CborErrorJsonSyntax;
+    QTest::newRow("control-char") << QByteArray("\"a\x01\"") << CborErrorJsonSyntax;
+    QTest::newRow("lone-high-surrogate") << QByteArray("\"\\ud800\"") << CborErrorInvalidUtf8TextString;
+    QTest::newRow("lone-low-surrogate") << QByteArray("\"\\udc00\"") << CborErrorInvalidUtf8TextString;
+    QTest::newRow("invalid-utf8") << QByteArray("\"\xc3(\"") << CborErrorInvalidUtf8TextString;
+    QTest::newRow("too-deep") << QByteArray(1100, '[') + QByteArray(1100, ']') << CborErrorNestingTooDeep;
+}
+
+void tst_FromJson::errors()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(CborError, expectedError);
+
+    compareError(json, expectedError, CborConvertFromJsonDefaultFlags);
+}
+
+void tst_FromJson::decimalPointLocale()
+{
+    // JSON always uses '.', whatever the locale's decimal point is
+    if (!setlocale(LC_NUMERIC, "de_DE.UTF-8") && !setlocale(LC_NUMERIC, "de_DE"))
+        QSKIP("German locale not available");
+
+    // the second one is long enough to be copied to the scratch buffer
+    QByteArray longNumber = "1.5" + QByteArray(80, '0');
+    QByteArray output1, output2, output3;
+    CborError err1 = convertBuffer("1.5", &output1, CborConvertFromJsonDefaultFlags);
+    CborError err2 = convertStream("[0.5, -2.25e1]", &output2, CborConvertFromJsonDefaultFlags);
+    CborError err3 = convertBuffer(longNumber, &output3, CborConvertFromJsonDefaultFlags);
+    setlocale(LC_NUMERIC, "C");
+
+    QCOMPARE(err1, CborNoError);
+    QCOMPARE(output1.toHex(), raw("\xfb\x3f\xf8\x00\x00\x00\x00\x00" "\x00").toHex());
+    QCOMPARE(err2, CborNoError);
+    QCOMPARE(output2.toHex(), raw("\x82\xfb\x3f\xe0\x00\x00\x00\x00" "\x00\x00\xfb\xc0\x36\x80\x00\x00\x00\x00\x00").toHex());
+    QCOMPARE(err3, CborNoError);
+    QCOMPARE(output3.toHex(), output1.toHex());
+}
+
+void tst_FromJson::metaData_data()
+{
+    addColumns();
+    QTest::newRow("uint-precision") << QByteArray("{\"v\": 18446744073709551615, \"v$cbor\": {\"t\": 0, \"v\": \"+ffffffffffffffff\"}}") << raw("\xa1\x61\x76\x1b\xff\xff\xff\xff" "\xff\xff\xff\xff");
+    QTest::newRow("negint-precision") << QByteArray("{\"v\": -18446744073709551616, \"v$cbor\": {\"t\": 0, \"v\": \"-ffffffffffffffff\"}}") << raw("\xa1\x61\x76\x3b\xff\xff\xff\xff" "\xff\xff\xff\xff");
+    QTest::newRow("bytestring-base64url") << QByteArray("{\"v\": \"AQID\", \"v$cbor\": {\"t\": 64}}") << raw("\xa1\x61\x76\x43\x01\x02\x03");
+    QTest::newRow("bytestring-base64") << QByteArray("{\"v\": \"+/8=\", \"v$cbor\": {\"t\": 64}}") << raw("\xa1\x61\x76\x42\xfb\xff");
+    QTest::newRow("bytestring-tag21") << QByteArray("{\"v\": \"AQID\", \"v$cbor\": {\"tag\": \"21\", \"t\": 64}}") << raw("\xa1\x61\x76\xd5\x43\x01\x02\x03");
+    QTest::newRow("bytestring-tag23") << QByteArray("{\"v\": \"010203\", \"v$cbor\": {\"tag\": \"23\", \"t\": 64}}") << raw("\xa1\x61\x76\xd7\x43\x01\x02\x03");
+    QTest::newRow("bignum") << QByteArray("{\"v\": \"~AQ\", \"v$cbor\": {\"tag\": \"3\", \"t\": 64}}") << raw("\xa1\x61\x76\xc3\x41\x01");
+    QTest::newRow("tagged-int") << QByteArray("{\"v\": 1, \"v$cbor\": {\"tag\": \"1\"}}") << raw("\xa1\x61\x76\xc1\x01");
+    QTest::newRow("tagged-string") << QByteArray("{\"v\": \"x\", \"v$cbor\": {\"tag\": \"32\"}}") << raw("\xa1\x61\x76\xd8\x20\x61\x78");
+    QTest::newRow("undefined") << QByteArray("{\"v\": \"undefined\", \"v$cbor\": {\"t\": 247}}") << raw("\xa1\x61\x76\xf7");
+    QTest::newRow("simple") << QByteArray("{\"v\": \"simple(32)\", \"v$cbor\": {\"t\": 224, \"v\": 32}}") << raw("\xa1\x61\x76\xf8\x20");
+    QTest::newRow("half") << QByteArray("{\"v\": 1.5, \"v$cbor\": {\"t\": 249}}") << raw("\xa1\x61\x76\xf9\x3e\x00");
+    QTest::newRow("float") << QByteArray("{\"v\": 1.5, \"v$cbor\": {\"t\": 250}}") << raw("\xa1\x61\x76\xfa\x3f\xc0\x00\x00");
+    QTest::newRow("double") << QByteArray("{\"v\": 1, \"v$cbor\": {\"t\": 251}}") << raw("\xa1\x61\x76\xfb\x3f\xf0\x00\x00" "\x00\x00\x00\x00");
+    QTest::newRow("nan") << QByteArray("{\"v\": null, \"v$cbor\": {\"t\": 251, \"v\": \"nan\"}}") << raw("\xa1\x61\x76\xfb\x7f\xf8\x00\x00" "\x00\x00\x00\x00");
+    QTest::newRow("-inf") << QByteArray("{\"v\": null, \"v$cbor\": {\"t\": 250, \"v\": \"-inf\"}}") << raw("\xa1\x61\x76\xfa\xff\x80\x00\x00");
+    QTest::newRow("unknown-members") << QByteArray("{\"v\": 1, \"v$cbor\": {\"x\": [1, {}], \"tag\": \"2\", \"y\": null}}") << raw("\xa1\x61\x76\xc2\x01");
+    QTest::newRow("no-metadata") << QByteArray("{\"v\": 1, \"w\": 2}") << raw("\xa2\x61\x76\x01\x61\x77\x02");
+    QTest::newRow("escaped-name") << QByteArray("{\"\\u0076\": 1, \"v$cbor\": {\"tag\": \"1\"}}") << raw("\xbf\x61\x76\xc1\x01\xff");
+    QTest::newRow("nonadjacent-metadata") << QByteArray("{\"v$cbor\": {\"t\": 247}, \"v\": 1}") << raw("\xa1\x61\x76\x01");
+}
+
+void tst_FromJson::metaData()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(QByteArray, expected);
+
+    compareOne(json, expected, CborConvertReadMetadata);
+}
+
+void tst_FromJson::metaDataNotRequested()
+{
+    // without CborConvertReadMetadata, the metadata members are regular members
+    compareOne("{\"v\": 1, \"v$cbor\": {\"t\": 251}}",
+               raw("\xa2\x61\x76\x01\x66v$cbor\xa1\x61t\x18\xfb"),
+               CborConvertFromJsonDefaultFlags);
+}
+
+void tst_FromJson::metaDataErrors_data()
+{
+    addErrorColumns();
+    QTest::newRow("bad-tag") << QByteArray("{\"v\": 1, \"v$cbor\": {\"tag\": \"x\"}}") << CborErrorJsonInvalidMetadata;
+    QTest::newRow("bad-type") << QByteArray("{\"v\": 1, \"v$cbor\": {\"t\": \"0\"}}") << CborErrorJsonInvalidMetadata;
+    QTest::newRow("bad-precision") << QByteArray("{\"v\": 1, \"v$cbor\": {\"t\": 0, \"v\": \"ffff\"}}") << CborErrorJsonInvalidMetadata;
+    QTest::newRow("bad-base64") << QByteArray("{\"v\": \"A!\", \"v$cbor\": {\"t\": 64}}") << CborErrorJsonInvalidMetadata;
+    QTest::newRow("bytestring-not-string") << QByteArray("{\"v\": 1, \"v$cbor\": {\"t\": 64}}") << CborErrorJsonInvalidMetadata;
+    QTest::newRow("metadata-not-object") << QByteArray("{\"v\": 1, \"v$cbor\": 1}") << CborErrorJsonInvalidMetadata;
+}
+
+void tst_FromJson::metaDataErrors()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(CborError, expectedError);
+
+    compareError(json, expectedError, CborConvertReadMetadata);
+}
+
+void tst_FromJson::metaDataRoundTrip_data()
+{
+    QTest::addColumn<QByteArray>("cbor");
+    QTest::newRow("2^64-1") << raw("\xa1\x61\x76\x1b\xff\xff\xff\xff" "\xff\xff\xff\xff");
+    QTest::newRow("-2^53-1") << raw("\xa1\x61\x76\x3b\x00\x20\x00\x00" "\x00\x00\x00\x00");
+    QTest::newRow("-2^64+epsilon") << raw("\xa1\x61\x76\x3b\xff\xff\xff\xff" "\xff\xff\xf8\x00");
+    QTest::newRow("-2^64") << raw("\xa1\x61\x76\x3b\xff\xff\xff\xff" "\xff\xff\xff\xff");
+    QTest::newRow("bytestring") << raw("\xa1\x61\x76\x43\x01\x02\x03");
+    QTest::newRow("undefined") << raw("\xa1\x61\x76\xf7");
+    QTest::newRow("float") << raw("\xa1\x61\x76\xfa\x3f\xc0\x00\x00");
+}
+
+void tst_FromJson::metaDataRoundTrip()
+{
+    QFETCH(QByteArray, cbor);
+
+    // convert to JSON with the metadata and back
+    FILE *f = tmpfile();
+    QVERIFY(f);
+    CborParser parser;
+    CborValue first;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const uint8_t *>(cbor.constData()), cbor.size(), 0,
+                              &parser, &first), CborNoError);
+    CborError err = cbor_value_to_json(f, &first, CborConvertAddMetadata);
+    QByteArray json(int(ftell(f)), Qt::Uninitialized);
+    rewind(f);
+    size_t n = fread(json.data(), 1, json.size(), f);
+    fclose(f);
+    QCOMPARE(err, CborNoError);
+    QCOMPARE(int(n), json.size());
+
+    compareOne(json, cbor, CborConvertReadMetadata);
+}
+
+void tst_FromJson::outOfMemory_data()
+{
+    addColumns();
+    addFixedData();
+    addContainersData();
+}
+
+void tst_FromJson::outOfMemory()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(QByteArray, expected);
+
+    // the conversion continues after running out of buffer, to report the size needed
+    uint8_t buffer[4];
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+    CborError err = cbor_encode_from_json_buffer(&encoder, json.constData(), json.size(),
+                                                 CborConvertFromJsonDefaultFlags);
+    if (expected.size() <= int(sizeof(buffer))) {
+        QCOMPARE(err, CborNoError);
+        QCOMPARE(QByteArray(reinterpret_cast<char *>(buffer), int(cbor_encoder_get_buffer_size(&encoder, buffer))),
+                 expected);
+    } else {
+        QCOMPARE(err, CborErrorOutOfMemory);
+        QCOMPARE(sizeof(buffer) + cbor_encoder_get_extra_bytes_needed(&encoder), size_t(expected.size()));
+    }
+}
+
+void tst_FromJson::largeStream()
+{
+    // larger than what the stream conversion reads at a time, with strings
+    // and numbers crossing the read boundaries
+    QByteArray json = "{\"items\": [";
+    QByteArray expected = raw("\xa1\x65items\x99\x13\x88");
+    for (int i = 0; i < 5000; ++i) {
+        if (i)
+            json += ", ";
+        json += "[\"item\\t" + QByteArray::number(i % 10) + "\", " + QByteArray::number(1000000 + i) + "]";
+        expected += raw("\x82\x66item\t") + QByteArray::number(i % 10) + raw("\x1a\x00");
+        expected += char(((1000000 + i) >> 16) & 0xff);
+        expected += char(((1000000 + i) >> 8) & 0xff);
+        expected += char((1000000 + i) & 0xff);
+    }
+    json += "]}";
+
+    compareOne(json, expected, CborConvertFromJsonDefaultFlags);
+    compareOne(json, expected, CborConvertReadMetadata);
+}
+
+void tst_FromJson::largeContainer()
+{
+    // the stream conversion only reads so far ahead to find the length of a
+    // container, so a larger one is encoded with indefinite length
+    QByteArray json = "[";
+    QByteArray items;
+    for (int i = 0; i < 300000; ++i) {
+        json += i ? ", \"abc\"" : "\"abc\"";
+        items += raw("\x63""abc");
+    }
+    json += "]";
+
+    QByteArray output;
+    QCOMPARE(convertBuffer(json, &output, CborConvertFromJsonDefaultFlags), CborNoError);
+    QCOMPARE(output.toHex(), (raw("\x9a\x00\x04\x93\xe0") + items).toHex());
+
+    QCOMPARE(convertStream(json, &output, CborConvertFromJsonDefaultFlags), CborNoError);
+    QCOMPARE(output.toHex(), (raw("\x9f") + items + raw("\xff")).toHex());
+}
+
+QTEST_MAIN(tst_FromJson)
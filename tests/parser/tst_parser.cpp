@@ -86,6 +86,14 @@ private slots:
 
     void readerApi_data() { arrays_data(); }
     void readerApi();
+    void mappedFile();
+    void streamParser_data();
+    void streamParser();
+    void streamParserErrors_data();
+    void streamParserErrors();
+    void callbacks();
+    void callbacksErrors_data() { streamParserErrors_data(); }
+    void callbacksErrors();
     void reparse_data();
     void reparse();
 
@@ -100,24 +108,42 @@ private slots:
     void stringLength();
     void stringCompare_data();
     void stringCompare();
+    void dupStringWithArena();
     void mapFind_data();
     void mapFind();
+    void mapFindMultiple_data() { mapFind_data(); }
+    void mapFindMultiple();
+    void containerIndex_data() { arrays_data(); }
+    void containerIndex();
+    void containerIndexMapFind_data() { mapFind_data(); }
+    void containerIndexMapFind();
 
     // validation & errors
     void checkedIntegers_data();
     void checkedIntegers();
+    void integerArrays_data() { checkedIntegers_data(); }
+    void integerArrays();
+    void floatArrays_data();
+    void floatArrays();
+    void numberArrayErrors();
+    void typedArrays();
     void validationValid_data() { arrays_data(); }
     void validationValid();
     void validation_data();
     void validation();
     void strictValidation_data();
     void strictValidation();
+    void readerValidation_data();
+    void readerValidation();
     void incompleteData_data();
     void incompleteData();
     void endPointer_data();
     void endPointer();
+    void advanceSmallScalars_data();
+    void advanceSmallScalars();
     void recursionLimit_data();
     void recursionLimit();
+    void validateAndIndex();
 };
 
 struct ParserWrapper
@@ -810,6 +836,251 @@ void tst_Parser::readerApi()
     QCOMPARE(input.consumed, data.size());
 }
 
+static CborError streamEvents(const QByteArray &data, int fragmentSize, QString *parsed)
+{
+    CborStreamParser parser;
+    CborStreamEvent event;
+    CborError err = CborErrorUnexpectedEOF;
+    cbor_stream_parser_init(&parser);
+    parsed->clear();
+
+    for (int offset = 0; offset < data.size(); offset += fragmentSize) {
+        cbor_stream_parser_feed(&parser, data.constData() + offset, qMin(fragmentSize, data.size() - offset));
+        while ((err = cbor_stream_parser_next(&parser, &event)) == CborNoError) {
+            QString indefinite = event.flags & CborStreamFlag_IndefiniteLength ? "_" : "";
+            switch (event.event) {
+            case CborStreamValue:
+                *parsed += QString::asprintf("%s%x:%llu ", event.flags & CborStreamFlag_NegativeInteger ? "-" : "",
+                                             event.type, (unsigned long long)event.value);
+                break;
+            case CborStreamContainerStart:
+                *parsed += (event.type == CborMapType ? '{' : '[') + indefinite + QString::number(event.value) + ' ';
+                break;
+            case CborStreamContainerEnd:
+                *parsed += event.type == CborMapType ? "} " : "] ";
+                break;
+            case CborStreamStringStart:
+                *parsed += (event.type == CborTextStringType ? 't' : 'b') + indefinite +
+                        QString::number(event.value) + '(';
+                break;
+            case CborStreamStringData:
+                *parsed += QString::fromLatin1(reinterpret_cast<const char *>(event.data), int(event.size));
+                break;
+            case CborStreamStringEnd:
+                *parsed += ") ";
+                break;
+            }
+        }
+        if (err != CborErrorUnexpectedEOF)
+            return err;
+    }
+    if (cbor_stream_parser_get_offset(&parser) != uint64_t(data.size()))
+        return CborErrorInternalError;
+    return cbor_stream_parser_at_top_level(&parser) ? CborNoError : err;
+}
+
+void tst_Parser::streamParser_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("integers") << raw("\x01\x18\x18\x20\x3b\xff\xff\xff\xff\xff\xff\xff\xff")
+                              << "0:1 0:24 -0:0 -0:18446744073709551615 ";
+    QTest::newRow("simple") << raw("\xf4\xf5\xf6\xf7\xe0\xf8\xff")
+                            << "f5:0 f5:1 f6:22 f7:23 e0:0 e0:255 ";
+    QTest::newRow("floats") << raw("\xf9\x3c\0\xfa\x3f\x80\0\0\xfb\x3f\xf0\0\0\0\0\0\0")
+                            << "f9:15360 fa:1065353216 fb:4607182418800017408 ";
+    QTest::newRow("tags") << raw("\xc1\x1a\x5f\x5e\x6f\xe3\xd8\x40\x40")
+                          << "c0:1 0:1600024547 c0:64 b0() ";
+    QTest::newRow("strings") << raw("\x60\x65Hello\x5f\x42" "ab\x40\x41" "c\xff\x7f\xff")
+                             << "t0() t5(Hello) b_0(abc) t_0() ";
+    QTest::newRow("containers") << raw("\x80\xa0\x9f\xff\xbf\xff\x82\x81\x01\x9f\x02\xff")
+                                << "[0 ] {0 } [_0 ] {_0 } [2 [1 0:1 ] [_0 0:2 ] ] ";
+    QTest::newRow("map") << raw("\xa2\x61" "a\x01\x61" "b\xbf\x01\xc1\x02\xff")
+                         << "{2 t1(a) 0:1 t1(b) {_0 0:1 c0:1 0:2 } } ";
+    QTest::newRow("sequence") << raw("\x01\x81\x02\x03") << "0:1 [1 0:2 ] 0:3 ";
+}
+
+void tst_Parser::streamParser()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, expected);
+
+    // the result must not depend on where the data is split
+    for (int fragmentSize = 1; fragmentSize <= data.size(); ++fragmentSize) {
+        QString parsed;
+        QCOMPARE(streamEvents(data, fragmentSize, &parsed), CborNoError);
+        QCOMPARE(parsed, expected);
+    }
+}
+
+void tst_Parser::streamParserErrors_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<CborError>("expectedError");
+
+    QTest::newRow("truncated-header") << raw("\x1b\0\0") << CborErrorUnexpectedEOF;
+    QTest::newRow("truncated-string") << raw("\x62" "a") << CborErrorUnexpectedEOF;
+    QTest::newRow("truncated-array") << raw("\x82\x01") << CborErrorUnexpectedEOF;
+    QTest::newRow("truncated-tag") << raw("\xc1") << CborErrorUnexpectedEOF;
+    QTest::newRow("illegal-number") << raw("\x1c") << CborErrorIllegalNumber;
+    QTest::newRow("indefinite-integer") << raw("\x1f") << CborErrorIllegalNumber;
+    QTest::newRow("unknown-simple") << raw("\xfc") << CborErrorUnknownType;
+    QTest::newRow("illegal-simple") << raw("\xf8\x1f") << CborErrorIllegalSimpleType;
+    QTest::newRow("break") << raw("\xff") << CborErrorUnexpectedBreak;
+    QTest::newRow("break-definite-array") << raw("\x81\xff") << CborErrorUnexpectedBreak;
+    QTest::newRow("break-after-tag") << raw("\x9f\xc1\xff") << CborErrorUnexpectedBreak;
+    QTest::newRow("break-after-map-key") << raw("\xbf\x01\xff") << CborErrorUnexpectedBreak;
+    QTest::newRow("wrong-chunk-type") << raw("\x5f\x61" "a\xff") << CborErrorIllegalType;
+    QTest::newRow("nested-indefinite-chunk") << raw("\x7f\x7f\xff\xff") << CborErrorIllegalType;
+    QTest::newRow("too-deep") << QByteArray(CBOR_STREAM_PARSER_MAX_DEPTH + 1, '\x81') << CborErrorNestingTooDeep;
+}
+
+void tst_Parser::streamParserErrors()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(CborError, expectedError);
+
+    for (int fragmentSize = 1; fragmentSize <= data.size(); ++fragmentSize) {
+        QString parsed;
+        QCOMPARE(streamEvents(data, fragmentSize, &parsed), expectedError);
+    }
+}
+
+struct CallbackRecorder
+{
+    QString log;
+    int stopAfter = -1;
+
+    CborError add(const QString &s)
+    {
+        log += s + ' ';
+        return --stopAfter == 0 ? CborErrorInternalError : CborNoError;
+    }
+
+    static CallbackRecorder *self(void *context) { return static_cast<CallbackRecorder *>(context); }
+    static QString length(size_t n) { return n == CborIndefiniteLength ? "_" : QString::number(n); }
+    static const CborCallbacks callbacks;
+};
+
+const CborCallbacks CallbackRecorder::callbacks = {
+    [](void *c, uint64_t v) { return self(c)->add(QString::number(v)); },
+    [](void *c, uint64_t v) { return self(c)->add("-1-" + QString::number(v)); },
+    [](void *c, CborTag t) { return self(c)->add(QString::number(t) + '('); },
+    [](void *c, uint8_t t) { return self(c)->add("simple(" + QString::number(t) + ')'); },
+    [](void *c, bool b) { return self(c)->add(b ? "true" : "false"); },
+    [](void *c) { return self(c)->add("null"); },
+    [](void *c) { return self(c)->add("undefined"); },
+    [](void *c, uint16_t v) { return self(c)->add("half:" + QString::number(v, 16)); },
+    [](void *c, float f) { return self(c)->add(QString::number(f) + 'f'); },
+    [](void *c, double d) { return self(c)->add(QString::number(d)); },
+    [](void *c, CborType type, size_t n) { return self(c)->add((type == CborTextStringType ? "t" : "b") + length(n) + '<'); },
+    [](void *c, CborType, const uint8_t *data, size_t len) {
+        return self(c)->add(QString::fromLatin1(reinterpret_cast<const char *>(data), int(len)));
+    },
+    [](void *c, CborType) { return self(c)->add(">"); },
+    [](void *c, size_t n) { return self(c)->add('[' + length(n)); },
+    [](void *c) { return self(c)->add("]"); },
+    [](void *c, size_t n) { return self(c)->add('{' + length(n)); },
+    [](void *c) { return self(c)->add("}"); },
+};
+
+void tst_Parser::callbacks()
+{
+    QByteArray data = raw("\xa2\x61" "a\x82\x01\x20\x7f\x62" "bc\xff\xbf\xc1\xf5\xf6\xf4\xf7\xff"
+                          "\x9f\xf0\xf9\x3c\0\xfa\x3f\xc0\0\0\xfb\x40\x04\0\0\0\0\0\0\xff" "\x44" "abcd");
+    QString expected = "{2 t1< a > [2 1 -1-0 ] t_< bc > {_ 1( true null false undefined } } "
+                       "[_ simple(16) half:3c00 1.5f 2.5 ] b4< abcd > ";
+
+    CallbackRecorder recorder;
+    QCOMPARE(cbor_parse_with_callbacks(reinterpret_cast<const uint8_t *>(data.constData()), data.size(),
+                                       &CallbackRecorder::callbacks, &recorder), CborNoError);
+    QCOMPARE(recorder.log, expected);
+
+    // stopping from a callback
+    recorder = CallbackRecorder();
+    recorder.stopAfter = 3;
+    QCOMPARE(cbor_parse_with_callbacks(reinterpret_cast<const uint8_t *>(data.constData()), data.size(),
+                                       &CallbackRecorder::callbacks, &recorder), CborErrorInternalError);
+    QCOMPARE(recorder.log, QString("{2 t1< a "));
+
+    // truncated data
+    recorder = CallbackRecorder();
+    QCOMPARE(cbor_parse_with_callbacks(reinterpret_cast<const uint8_t *>(data.constData()), data.size() - 1,
+                                       &CallbackRecorder::callbacks, &recorder), CborErrorUnexpectedEOF);
+    QCOMPARE(recorder.log, expected.left(expected.indexOf("b4<")));   // the truncated string isn't reported
+
+    // null callbacks are skipped
+    CborCallbacks onlyIntegers = {};
+    onlyIntegers.on_uint = CallbackRecorder::callbacks.on_uint;
+    recorder = CallbackRecorder();
+    QCOMPARE(cbor_parse_with_callbacks(reinterpret_cast<const uint8_t *>(data.constData()), data.size(),
+                                       &onlyIntegers, &recorder), CborNoError);
+    QCOMPARE(recorder.log, QString("1 "));
+
+    // dispatching fragments: strings come in pieces
+    CborStreamParser parser;
+    cbor_stream_parser_init(&parser);
+    recorder = CallbackRecorder();
+    cbor_stream_parser_feed(&parser, data.constData(), data.size() - 2);
+    QCOMPARE(cbor_stream_parser_dispatch(&parser, &CallbackRecorder::callbacks, &recorder), CborErrorUnexpectedEOF);
+    cbor_stream_parser_feed(&parser, data.constData() + data.size() - 2, 2);
+    QCOMPARE(cbor_stream_parser_dispatch(&parser, &CallbackRecorder::callbacks, &recorder), CborErrorUnexpectedEOF);
+    QVERIFY(cbor_stream_parser_at_top_level(&parser));
+    QCOMPARE(recorder.log, expected.replace("abcd", "ab cd"));
+}
+
+void tst_Parser::callbacksErrors()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(CborError, expectedError);
+
+    CallbackRecorder recorder;
+    QCOMPARE(cbor_parse_with_callbacks(reinterpret_cast<const uint8_t *>(data.constData()), data.size(),
+                                       &CallbackRecorder::callbacks, &recorder), expectedError);
+}
+
+void tst_Parser::mappedFile()
+{
+#if defined(Q_OS_UNIX)
+    QTemporaryFile tmp;
+    QVERIFY(tmp.open());
+    tmp.write(raw("\x82\x01\x63one"));
+    tmp.flush();
+
+    CborMappedFile file;
+    CborParser parser;
+    CborValue first, element;
+    QCOMPARE(cbor_parser_init_file(QFile::encodeName(tmp.fileName()).constData(), 0, &file, &parser, &first),
+             CborNoError);
+    QCOMPARE(file.size, size_t(6));
+    QVERIFY(cbor_value_is_array(&first));
+    QCOMPARE(cbor_value_enter_container(&first, &element), CborNoError);
+    QVERIFY(cbor_value_is_integer(&element));
+    QCOMPARE(cbor_value_advance_fixed(&element), CborNoError);
+    QVERIFY(cbor_value_is_text_string(&element));
+    QCOMPARE(cbor_value_advance(&element), CborNoError);
+    QCOMPARE(cbor_value_leave_container(&first, &element), CborNoError);
+    QCOMPARE((void *)cbor_value_get_next_byte(&first), (void *)(file.data + file.size));
+    cbor_mapped_file_close(&file);
+    QVERIFY(!file.data);
+
+    // empty files can't be parsed
+    tmp.resize(0);
+    QCOMPARE(cbor_parser_init_file(QFile::encodeName(tmp.fileName()).constData(), 0, &file, &parser, &first),
+             CborErrorUnexpectedEOF);
+    cbor_mapped_file_close(&file);
+
+    // errors opening the file
+    QCOMPARE(cbor_parser_init_file("/nonexistent/file", 0, &file, &parser, &first), CborErrorIO);
+    cbor_mapped_file_close(&file);
+    QCOMPARE(cbor_parser_init_file("/dev/null", 0, &file, &parser, &first), CborErrorUnsupportedSource);
+    cbor_mapped_file_close(&file);
+#else
+    QSKIP("Memory-mapped files are only supported on Unix");
+#endif
+}
+
 void tst_Parser::reparse_data()
 {
     // only one-item rows
@@ -1177,6 +1448,52 @@ void tst_Parser::stringCompare()
     compareOneString("\xc1\xc2" + data, string, expected);
 }
 
+void tst_Parser::dupStringWithArena()
+{
+    alignas(16) char memory[64];
+    CborArena arena;
+    cbor_arena_init(&arena, memory, sizeof(memory));
+
+    ParserWrapper w;
+    QCOMPARE(w.init(raw("\x83\x65Hello\x7f\x62Wo\x63rld\xff\x58\x40" "0123456789abcdef" "0123456789abcdef"
+                        "0123456789abcdef" "0123456789abcdef")), CborNoError);
+    cbor_parser_set_allocator(&w.parser, cbor_arena_get_allocator(&arena));
+
+    CborValue element;
+    QCOMPARE(cbor_value_enter_container(&w.first, &element), CborNoError);
+
+    char *hello, *world;
+    size_t helloLen, worldLen;
+    QCOMPARE(cbor_value_dup_text_string(&element, &hello, &helloLen, &element), CborNoError);
+    QCOMPARE(QByteArray(hello, int(helloLen)), QByteArray("Hello"));
+    QVERIFY(hello >= memory && hello < memory + sizeof(memory));
+    QCOMPARE(cbor_value_dup_text_string(&element, &world, &worldLen, &element), CborNoError);
+    QCOMPARE(QByteArray(world, int(worldLen)), QByteArray("World"));
+    QVERIFY(world > hello && world < memory + sizeof(memory));
+    size_t used = cbor_arena_get_used_size(&arena);
+    QVERIFY(used > 0);
+
+    // freeing in reverse order gives the memory back
+    const CborAllocator *allocator = cbor_arena_get_allocator(&arena);
+    allocator->deallocate(allocator->context, world, worldLen + 1);
+    QVERIFY(cbor_arena_get_used_size(&arena) < used);
+    allocator->deallocate(allocator->context, hello, helloLen + 1);
+    QCOMPARE(cbor_arena_get_used_size(&arena), size_t(0));
+
+    // the 64-byte string doesn't fit with its terminating NUL
+    uint8_t *bytes;
+    size_t len;
+    QCOMPARE(cbor_value_dup_byte_string(&element, &bytes, &len, &element), CborErrorOutOfMemory);
+
+    // resetting releases everything at once
+    QCOMPARE(cbor_value_enter_container(&w.first, &element), CborNoError);
+    QCOMPARE(cbor_value_dup_text_string(&element, &hello, &helloLen, &element), CborNoError);
+    QCOMPARE(cbor_value_dup_text_string(&element, &world, &worldLen, &element), CborNoError);
+    QVERIFY(cbor_arena_get_used_size(&arena) > 0);
+    cbor_arena_reset(&arena);
+    QCOMPARE(cbor_arena_get_used_size(&arena), size_t(0));
+}
+
 void tst_Parser::mapFind_data()
 {
     // Rules:
@@ -1267,6 +1584,140 @@ void tst_Parser::mapFind()
     }
 }
 
+void tst_Parser::mapFindMultiple()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, expected);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    // the results must match those of cbor_value_map_find_value() for each key
+    static const char *const keys[] = { "haystack", "needle", "z", "", "needle" };
+    const size_t count = sizeof(keys) / sizeof(keys[0]);
+    CborValue elements[count];
+    err = cbor_value_map_find_values(&w.first, keys, count, elements);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+    QCOMPARE(cbor_value_is_valid(&elements[1]), expected);
+    QCOMPARE(cbor_value_is_valid(&elements[4]), expected);
+
+    for (size_t i = 0; i < count; ++i) {
+        CborValue element;
+        err = cbor_value_map_find_value(&w.first, keys[i], &element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QCOMPARE(int(elements[i].type), int(element.type));
+        if (cbor_value_is_valid(&element))
+            QCOMPARE((void *)cbor_value_get_next_byte(&elements[i]), (void *)cbor_value_get_next_byte(&element));
+    }
+}
+
+void tst_Parser::containerIndex()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, expected);
+
+    auto check = [&](const QByteArray &array) {
+        ParserWrapper w;
+        CborError err = w.init(array);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+        CborContainerIndex index;
+        uint32_t offsets[3];
+        err = cbor_value_create_container_index(&w.first, &index, offsets, nullptr, 2);
+        QCOMPARE(err, CborErrorOutOfMemory);
+        QCOMPARE(cbor_container_index_get_required_count(&index), size_t(3));
+        QCOMPARE(cbor_container_index_get_count(&index), size_t(0));
+        CborValue item;
+        QCOMPARE(cbor_container_index_get_item(&index, 2, &item), CborErrorAdvancePastEOF);
+        err = cbor_value_create_container_index(&w.first, &index, offsets, nullptr, 3);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QCOMPARE(cbor_container_index_get_count(&index), size_t(3));
+
+        // access in reverse order
+        CborValue element;
+        for (int i = 2; i >= 0; --i) {
+            err = cbor_container_index_get_item(&index, i, &element);
+            QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+            QString decoded;
+            err = parseOne(&element, &decoded);
+            QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+            QCOMPARE(decoded, expected);
+        }
+
+        // an odd position in an array is an element like any other
+        err = cbor_container_index_get_item(&index, 1, &element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QVERIFY(!(element.flags & CborIteratorFlag_NextIsMapKey));
+        err = cbor_value_advance(&element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        {
+            QString decoded;
+            err = parseOne(&element, &decoded);
+            QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+            QCOMPARE(decoded, expected);
+            QVERIFY(cbor_value_at_end(&element));
+        }
+
+        // continuing the iteration from the last item must reach the end
+        err = cbor_container_index_get_item(&index, 2, &element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        err = cbor_value_advance(&element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QVERIFY(cbor_value_at_end(&element));
+        err = cbor_value_leave_container(&w.first, &element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QCOMPARE((void *)cbor_value_get_next_byte(&w.first), (void *)w.end());
+
+        QCOMPARE(cbor_container_index_get_item(&index, 3, &element), CborErrorAdvancePastEOF);
+        QVERIFY(!cbor_value_is_valid(&element));
+    };
+
+    check("\x83" + data + data + data);
+    if (QTest::currentTestFailed()) return;
+    check("\x9f" + data + data + data + "\xff");
+}
+
+void tst_Parser::containerIndexMapFind()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, expected);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    CborContainerIndex index;
+    uint32_t offsets[4], keyHashes[2];
+    for (int i = 0; i < 2; ++i) {
+        // with and without key hashes
+        uint32_t *hashes = i ? nullptr : keyHashes;
+        err = cbor_value_create_container_index(&w.first, &index, offsets, hashes, 4);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+        CborValue element;
+        err = cbor_container_index_map_find_value(&index, "needle", &element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+        if (expected) {
+            QCOMPARE(int(element.type), int(CborTagType));
+
+            CborTag tag;
+            err = cbor_value_get_tag(&element, &tag);
+            QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+            QCOMPARE(int(tag), 42);
+
+            bool equals;
+            err = cbor_value_text_string_equals(&element, "haystack", &equals);
+            QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+            QVERIFY(equals);
+        } else {
+            QCOMPARE(int(element.type), int(CborInvalidType));
+        }
+    }
+}
+
 void tst_Parser::checkedIntegers_data()
 {
     QTest::addColumn<QByteArray>("data");
@@ -1339,6 +1790,225 @@ void tst_Parser::checkedIntegers()
     }
 }
 
+void tst_Parser::integerArrays()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QVariant, result);
+    int64_t expected = result.toLongLong();
+
+    // three copies of the element, then a trailing item
+    for (const QByteArray &array : { "\x83" + data + data + data + '\1',
+                                     "\x9f" + data + data + data + "\xff\1" }) {
+        ParserWrapper w;
+        CborError err = w.init(array);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+        CborValue next;
+        int64_t buffer64[3];
+        size_t count = 3;
+        err = cbor_value_get_int64_array(&w.first, buffer64, &count, &next);
+        if (result.isNull()) {
+            QCOMPARE(err, CborErrorDataTooLarge);
+        } else {
+            QCOMPARE(err, CborNoError);
+            QCOMPARE(count, size_t(3));
+            for (int64_t v : buffer64)
+                QCOMPARE(v, expected);
+            QCOMPARE((void *)cbor_value_get_next_byte(&next), (void *)(w.end() - 1));
+        }
+
+        int32_t buffer32[3];
+        count = 3;
+        err = cbor_value_get_int32_array(&w.first, buffer32, &count, nullptr);
+        if (result.isNull() || expected != int32_t(expected)) {
+            QCOMPARE(err, CborErrorDataTooLarge);
+        } else {
+            QCOMPARE(err, CborNoError);
+            for (int32_t v : buffer32)
+                QCOMPARE(v, int32_t(expected));
+        }
+
+        uint64_t bufferU64[3];
+        count = 3;
+        err = cbor_value_get_uint64_array(&w.first, bufferU64, &count, nullptr);
+        if (data.at(0) & 0x20) {
+            QCOMPARE(err, CborErrorDataTooLarge);
+        } else {
+            QCOMPARE(err, CborNoError);
+            uint64_t raw;
+            CborValue element;
+            QCOMPARE(cbor_value_enter_container(&w.first, &element), CborNoError);
+            cbor_value_get_raw_integer(&element, &raw);
+            for (uint64_t v : bufferU64)
+                QCOMPARE(v, raw);
+        }
+    }
+}
+
+void tst_Parser::floatArrays_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<double>("expected");
+    QTest::addColumn<bool>("fitsFloat");
+
+    QTest::newRow("half-1.0") << raw("\xf9\x3c\x00") << 1.0 << true;
+    QTest::newRow("half-inf") << raw("\xf9\x7c\x00") << double(INFINITY) << true;
+    QTest::newRow("float-1.5") << raw("\xfa\x3f\xc0\x00\x00") << 1.5 << true;
+    QTest::newRow("float-0.1") << raw("\xfa\x3d\xcc\xcc\xcd") << double(0.1f) << true;
+    QTest::newRow("double-1.5") << raw("\xfb\x3f\xf8\0\0\0\0\0\0") << 1.5 << true;
+    QTest::newRow("double-0.1") << raw("\xfb\x3f\xb9\x99\x99\x99\x99\x99\x9a") << 0.1 << false;
+    QTest::newRow("double-1e300") << raw("\xfb\x7e\x37\xe4\x3c\x88\x00\x75\x9c") << 1e300 << false;
+}
+
+void tst_Parser::floatArrays()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(double, expected);
+    QFETCH(bool, fitsFloat);
+
+    for (const QByteArray &array : { "\x82" + data + data + '\1',
+                                     "\x9f" + data + data + "\xff\1" }) {
+        ParserWrapper w;
+        CborError err = w.init(array);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+        CborValue next;
+        double bufferD[2];
+        size_t count = 2;
+        err = cbor_value_get_double_array(&w.first, bufferD, &count, &next);
+        QCOMPARE(err, CborNoError);
+        QCOMPARE(count, size_t(2));
+        QCOMPARE(bufferD[0], expected);
+        QCOMPARE(bufferD[1], expected);
+        QCOMPARE((void *)cbor_value_get_next_byte(&next), (void *)(w.end() - 1));
+
+        float bufferF[2];
+        count = 2;
+        err = cbor_value_get_float_array(&w.first, bufferF, &count, nullptr);
+        if (fitsFloat) {
+            QCOMPARE(err, CborNoError);
+            QCOMPARE(bufferF[0], float(expected));
+            QCOMPARE(bufferF[1], float(expected));
+        } else {
+            QCOMPARE(err, CborErrorDataTooLarge);
+        }
+
+        // integer arrays don't accept floating point
+        int64_t bufferI[2];
+        count = 2;
+        QCOMPARE(cbor_value_get_int64_array(&w.first, bufferI, &count, nullptr), CborErrorIllegalType);
+    }
+}
+
+void tst_Parser::numberArrayErrors()
+{
+    int64_t buffer[4];
+    size_t count;
+
+    {
+        // buffer too small: the required size is reported
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\x86\1\2\3\4\5\6")), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_int64_array(&w.first, buffer, &count, nullptr), CborErrorOutOfMemory);
+        QCOMPARE(count, size_t(6));
+        QCOMPARE(buffer[3], int64_t(4));
+    }
+    {
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\x9f\1\2\3\4\5\6\xff")), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_int64_array(&w.first, buffer, &count, nullptr), CborErrorOutOfMemory);
+        QCOMPARE(count, size_t(6));
+    }
+    {
+        // empty array
+        ParserWrapper w;
+        CborValue next;
+        QCOMPARE(w.init(raw("\x80\1")), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_int64_array(&w.first, buffer, &count, &next), CborNoError);
+        QCOMPARE(count, size_t(0));
+        QVERIFY(cbor_value_is_integer(&next));
+    }
+    {
+        // mixed types and tags are rejected
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\x83\1\x61z\3")), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_int64_array(&w.first, buffer, &count, nullptr), CborErrorIllegalType);
+    }
+    {
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\x83\1\xc1\2\3")), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_int64_array(&w.first, buffer, &count, nullptr), CborErrorIllegalType);
+    }
+    {
+        // truncated data
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\x83\1\x19\1")), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_int64_array(&w.first, buffer, &count, nullptr), CborErrorUnexpectedEOF);
+    }
+}
+
+void tst_Parser::typedArrays()
+{
+    const uint8_t *bytes;
+    const uint16_t *words;
+    uint16_t buffer[4];
+    size_t count;
+    CborValue next;
+
+    {
+        // uint8 arrays are always returned in place
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\xd8\x40\x43\1\2\3\xf6")), CborNoError);
+        count = 0;
+        QCOMPARE(cbor_value_get_uint8_typed_array(&w.first, &bytes, &count, nullptr, &next), CborNoError);
+        QCOMPARE(count, size_t(3));
+        QCOMPARE((void *)bytes, (void *)(w.begin() + 3));
+        QVERIFY(cbor_value_is_null(&next));
+    }
+    for (const QByteArray &data : { raw("\xd8\x41\x44\1\2\3\4\xf6"),             // big endian
+                                    raw("\xd8\x45\x44\2\1\4\3\xf6"),             // little endian
+                                    raw("\xd8\x41\x5f\x41\1\x43\2\3\4\xff\xf6") }) { // chunked
+        ParserWrapper w;
+        QCOMPARE(w.init(data), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_uint16_typed_array(&w.first, &words, &count, buffer, &next), CborNoError);
+        QCOMPARE(count, size_t(2));
+        QCOMPARE(words[0], uint16_t(0x102));
+        QCOMPARE(words[1], uint16_t(0x304));
+        QVERIFY(cbor_value_is_null(&next));
+    }
+    {
+        // buffer too small for a chunked string: the required size is reported
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\xd8\x41\x5f\x41\1\x43\2\3\4\xff")), CborNoError);
+        count = 1;
+        QCOMPARE(cbor_value_get_uint16_typed_array(&w.first, &words, &count, buffer, nullptr), CborErrorOutOfMemory);
+        QCOMPARE(count, size_t(2));
+    }
+    {
+        // length not a multiple of the element size
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\xd8\x41\x43\1\2\3")), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_uint16_typed_array(&w.first, &words, &count, buffer, nullptr), CborErrorImproperValue);
+    }
+    {
+        // wrong tag or tagged type
+        ParserWrapper w;
+        QCOMPARE(w.init(raw("\xd8\x42\x44\1\2\3\4")), CborNoError);
+        count = 4;
+        QCOMPARE(cbor_value_get_uint16_typed_array(&w.first, &words, &count, buffer, nullptr), CborErrorIllegalType);
+        QCOMPARE(w.init(raw("\xd8\x41\x82\1\2")), CborNoError);
+        QCOMPARE(cbor_value_get_uint16_typed_array(&w.first, &words, &count, buffer, nullptr), CborErrorIllegalType);
+    }
+}
+
 void tst_Parser::validationValid()
 {
     // verify that all valid data validate properly
@@ -1373,11 +2043,14 @@ void tst_Parser::validation()
 
     CborError err2 = cbor_value_validate_basic(&w.first);
     CborError err3 = cbor_value_validate(&w.first, CborValidateBasic);
+    CborValidationFrame stack[64];
+    CborError err4 = cbor_value_validate_with_stack(&w.first, CborValidateBasic, stack, 64);
     err = parseOne(&w.first, &decoded);
     QCOMPARE(err, expectedError);
     if (!QByteArray(QTest::currentDataTag()).contains("utf8")) {
         QCOMPARE(err2, expectedError);
         QCOMPARE(err3, expectedError);
+        QCOMPARE(err4, expectedError);
     }
 
     // see if we've got a map
@@ -1627,10 +2300,66 @@ void tst_Parser::strictValidation_data()
     QTest::newRow("invalid-utf8-overlong-4-5") << raw("\x65\xf8\x80\x84\x80\x80") << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
     QTest::newRow("invalid-utf8-overlong-4-6") << raw("\x66\xfc\x80\x80\x84\x80\x80") << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
 
+    // long strings, which are validated in blocks: make sure the errors are
+    // found at any position, including when a sequence crosses a block boundary
+    auto longString = [](const QByteArray &contents) {
+        return raw("\x78") + char(contents.size()) + contents;
+    };
+    const QByteArray euro = raw("\xe2\x82\xac");
+    const QByteArray clef = raw("\xf0\x9d\x84\x9e");
+    for (int pos : { 0, 13, 14, 15, 16, 17, 29, 30, 31, 32, 33, 63, 64, 70 }) {
+        QByteArray ascii(80, 'a');
+        QTest::newRow(("valid-utf8-long-euro-at-" + QByteArray::number(pos)).constData())
+                << longString(ascii.left(pos) + euro + ascii.mid(pos)) << int(CborValidateStrictMode) << CborNoError;
+        QTest::newRow(("valid-utf8-long-4bytes-at-" + QByteArray::number(pos)).constData())
+                << longString(ascii.left(pos) + clef + ascii.mid(pos)) << int(CborValidateStrictMode) << CborNoError;
+        QTest::newRow(("invalid-utf8-long-truncated-at-" + QByteArray::number(pos)).constData())
+                << longString(ascii.left(pos) + euro.left(2) + ascii.mid(pos)) << int(CborValidateStrictMode)
+                << CborErrorInvalidUtf8TextString;
+        QTest::newRow(("invalid-utf8-long-surrogate-at-" + QByteArray::number(pos)).constData())
+                << longString(ascii.left(pos) + raw("\xed\xa0\x80") + ascii.mid(pos)) << int(CborValidateStrictMode)
+                << CborErrorInvalidUtf8TextString;
+        QTest::newRow(("invalid-utf8-long-ends-with-lead-" + QByteArray::number(pos)).constData())
+                << longString(ascii.left(pos) + clef.left(3)) << int(CborValidateStrictMode)
+                << CborErrorInvalidUtf8TextString;
+        QByteArray text;
+        while (text.size() < 120)
+            text += "\xc3\xa9" + euro + clef + 'x';
+        text[pos] = '\xff';
+        QTest::newRow(("invalid-utf8-long-ff-at-" + QByteArray::number(pos)).constData())
+                << longString(text) << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
+    }
+
     QTest::newRow("nonunique-content-map-UU") << raw("\xa2\0\1\0\2") << int(CborValidateStrictMode) << CborErrorMapKeysNotUnique;
     QTest::newRow("nonunique-content-map-SS") << raw("\xa2\x61z\1\x61z\2") << int(CborValidateStrictMode) << CborErrorMapKeysNotUnique;
     QTest::newRow("nonunique-content-map-AA") << raw("\xa2\x81\x65Hello\1\x81\x65Hello\2") << int(CborValidateStrictMode) << CborErrorMapKeysNotUnique;
 
+    // uniqueness without sorting
+    int unsorted = CborValidateMapKeysAreUniqueUnsorted;
+    QTest::newRow("unique-unsorted-map-UU") << raw("\xa2\1\1\0\0") << unsorted << CborNoError;
+    QTest::newRow("unique-unsorted-map-SS") << raw("\xa2\x61z\1\x62zz\2") << unsorted << CborNoError;
+    QTest::newRow("unique-unsorted-nested-map") << raw("\xa2\0\xa1\0\0\1\xa1\0\0") << unsorted << CborNoError;
+    QTest::newRow("nonunique-unsorted-map-UU") << raw("\xa3\1\1\0\0\1\2") << unsorted << CborErrorMapKeysNotUnique;
+    QTest::newRow("nonunique-unsorted-map-SS") << raw("\xa2\x61z\1\x61z\2") << unsorted << CborErrorMapKeysNotUnique;
+    QTest::newRow("nonunique-unsorted-map-AA") << raw("\xa2\x81\x65Hello\1\x81\x65Hello\2") << unsorted << CborErrorMapKeysNotUnique;
+    QTest::newRow("nonunique-unsorted-map-_UU") << raw("\xbf\1\1\0\0\1\2\xff") << unsorted << CborErrorMapKeysNotUnique;
+    QTest::newRow("nonunique-unsorted-nested-map") << raw("\xa1\0\xa3\1\0\2\0\1\0") << unsorted << CborErrorMapKeysNotUnique;
+    QTest::newRow("unsorted-length-map-UU-canonical") << raw("\xa2\1\1\0\0") << int(unsorted | CborValidateCanonicalFormat)
+                                                       << CborErrorMapNotSorted;
+    {
+        // large enough for the hash table to grow
+        QByteArray map = raw("\xb8\x64");
+        for (int i = 99; i >= 0; --i) {
+            if (i >= 24)
+                map += '\x18';
+            map += char(i);
+            map += '\0';
+        }
+        QTest::newRow("unique-unsorted-map-100") << map << unsorted << CborNoError;
+        map[map.size() - 2] = '\x17';
+        QTest::newRow("nonunique-unsorted-map-100") << map << unsorted << CborErrorMapKeysNotUnique;
+    }
+
     QTest::newRow("tag-0-unsigned") << raw("\xc0\x00") << int(CborValidateStrictMode) << CborErrorInappropriateTagForType;
     QTest::newRow("tag-0-bytearray") << raw("\xc0\x40") << int(CborValidateStrictMode) << CborErrorInappropriateTagForType;
     QTest::newRow("tag-0-string") << raw("\xc0\x60") << int(CborValidateStrictMode) << CborNoError;
@@ -1773,6 +2502,52 @@ void tst_Parser::strictValidation()
 
     err = cbor_value_validate(&w.first, flags);
     QCOMPARE(err, expectedError);
+
+    // there can't be more items than bytes
+    QVector<CborIndexEntry> entries(data.size());
+    CborDocumentIndex index;
+    err = cbor_value_validate_and_index(&w.first, flags, &index, entries.data(), entries.size());
+    QCOMPARE(err, expectedError);
+}
+
+void tst_Parser::readerValidation_data()
+{
+    addValidationColumns();
+
+    int canonical = CborValidateCanonicalFormat;
+    QTest::newRow("sorted-map-SS") << raw("\xa2\x60\0\x61z\1") << canonical << CborNoError;
+    QTest::newRow("unsorted-length-map-SS") << raw("\xa2\x61z\1\x60\0") << canonical << CborErrorMapNotSorted;
+    QTest::newRow("unsorted-content-map-SS") << raw("\xa2\x61z\1\x61y\0") << canonical << CborErrorMapNotSorted;
+    QTest::newRow("unsorted-chunked-map-SS") << raw("\xbf\x7f\x61z\xff\1\x7f\x61y\xff\2\xff") << int(CborValidateMapIsSorted & ~CborValidateNoIndeterminateLength)
+                                             << CborErrorMapNotSorted;
+    QTest::newRow("nonunique-content-map-SS") << raw("\xa2\x61z\1\x61z\2") << int(CborValidateStrictMode) << CborErrorMapKeysNotUnique;
+    QTest::newRow("nonunique-tagged-map-UU") << raw("\xa2\xc1\0\1\xc1\0\2") << int(CborValidateMapKeysAreUnique) << CborErrorMapKeysNotUnique;
+    QTest::newRow("unsorted-nested-map") << raw("\xa2\0\xa2\1\0\0\0\1\0") << canonical << CborErrorMapNotSorted;
+
+    // the keys are copied into a fixed-size buffer
+    QByteArray key(250, 'a');
+    QTest::newRow("sorted-map-long-key") << raw("\xa2\x60\0\x78\xfa") + key + '\1' << canonical << CborNoError;
+    key = QByteArray(256, 'a');
+    QTest::newRow("sorted-map-too-long-key") << raw("\xa2\x60\0\x79\1\0") + key + '\1' << canonical << CborErrorDataTooLarge;
+    QTest::newRow("array-key") << raw("\xa2\x81\0\1\x81\1\2") << canonical << CborErrorUnimplementedValidation;
+    QTest::newRow("unique-unsorted-map") << raw("\xa2\1\1\0\0") << int(CborValidateMapKeysAreUniqueUnsorted)
+                                         << CborErrorUnimplementedValidation;
+}
+
+void tst_Parser::readerValidation()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, flags);
+    QFETCH(CborError, expectedError);
+
+    Input input = { data, 0 };
+    CborParser parser;
+    CborValue first;
+    CborError err = cbor_parser_init_reader(&byteArrayOps, &parser, &first, &input);
+    QCOMPARE(err, CborNoError);
+
+    err = cbor_value_validate(&first, flags);
+    QCOMPARE(err, expectedError);
 }
 
 void tst_Parser::incompleteData_data()
@@ -1832,6 +2607,52 @@ void tst_Parser::endPointer()
     QCOMPARE(int(cbor_value_get_next_byte(&w.first) - w.begin()), offset);
 }
 
+void tst_Parser::advanceSmallScalars_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<CborError>("expectedError");
+
+    // long enough to exercise any vectorised code paths and their tails
+    const QByteArray pool = raw("\x00\x17\x20\x37\xe0\xf4\xf5\xf6\xf7");
+    QByteArray scalars;
+    for (int i = 0; i < 101; ++i)
+        scalars += pool.at(i % pool.size());
+    const QByteArray even = scalars.left(100);
+    const QByteArray trailer = even.left(40);
+
+    QTest::newRow("array") << raw("\x98\x65") + scalars + trailer << 103 << CborNoError;
+    QTest::newRow("_array") << raw("\x9f") + scalars + raw("\xff") + trailer << 103 << CborNoError;
+    QTest::newRow("map") << raw("\xb8\x32") + even + trailer << 102 << CborNoError;
+    QTest::newRow("_map") << raw("\xbf") + even + raw("\xff") + trailer << 102 << CborNoError;
+    QTest::newRow("mixed") << raw("\x98\x67") + scalars.left(50) + raw("\x18\x18\x38\x18") + scalars.mid(50)
+                           << 107 << CborNoError;
+    QTest::newRow("nested") << raw("\x82\x9f") + scalars + raw("\xff\x98\x65") + scalars + trailer
+                            << 207 << CborNoError;
+    QTest::newRow("tagged") << raw("\x98\x65") + scalars.left(50) + raw("\xc1") + scalars.mid(50) + trailer
+                            << 104 << CborNoError;
+
+    QTest::newRow("_map-odd") << raw("\xbf") + scalars + raw("\xff") << 0 << CborErrorUnexpectedBreak;
+    QTest::newRow("array-truncated") << raw("\x98\x66") + scalars << 0 << CborErrorUnexpectedEOF;
+    QTest::newRow("_array-truncated") << raw("\x9f") + scalars << 0 << CborErrorUnexpectedEOF;
+}
+
+void tst_Parser::advanceSmallScalars()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, offset);
+    QFETCH(CborError, expectedError);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    err = cbor_value_advance(&w.first);
+    QCOMPARE(err, expectedError);
+    if (!err)
+        QCOMPARE(int(cbor_value_get_next_byte(&w.first) - w.begin()), offset);
+}
+
 void tst_Parser::recursionLimit_data()
 {
     static const int recursions = CBOR_PARSER_MAX_RECURSIONS + 2;
@@ -1893,6 +2714,16 @@ void tst_Parser::recursionLimit()
     err = cbor_value_advance(&it);
     QCOMPARE(err, CborErrorNestingTooDeep);
 
+    err = cbor_value_validate(&w.first, CborValidateBasic);
+    QCOMPARE(err, CborErrorNestingTooDeep);
+
+    // the explicit stack is only bound by its size
+    QVector<CborValidationFrame> stack(data.size());
+    err = cbor_value_validate_with_stack(&w.first, CborValidateBasic, stack.data(), stack.size());
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+    err = cbor_value_validate_with_stack(&w.first, CborValidateBasic, stack.data(), 16);
+    QCOMPARE(err, CborErrorNestingTooDeep);
+
     it = w.first;
     if (cbor_value_is_map(&it)) {
         CborValue dummy;
@@ -1901,5 +2732,91 @@ void tst_Parser::recursionLimit()
     }
 }
 
+void tst_Parser::validateAndIndex()
+{
+    // [1, {"a": h'0102', _ "b": _ "cd" "e"}, 1(2)]
+    QByteArray data = raw("\x83\x01\xa2\x61" "a\x42\x01\x02\x7f\x61" "b\xff\x7f\x62" "cd\x61" "e\xff\xc1\x02");
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    CborIndexEntry entries[8];
+    CborDocumentIndex index;
+    err = cbor_value_validate_and_index(&w.first, 0, &index, entries, 2);
+    QCOMPARE(err, CborErrorOutOfMemory);
+    QCOMPARE(cbor_document_index_get_required_count(&index), size_t(8));
+    QCOMPARE(cbor_document_index_get_count(&index), size_t(0));
+
+    // an undersized index has no entries, not just the first few
+    CborValue item;
+    size_t found;
+    QVERIFY(!cbor_document_index_get_entry(&index, 0));
+    QVERIFY(!cbor_document_index_get_entry(&index, 7));
+    QCOMPARE(cbor_document_index_get_value(&index, 2, &item), CborErrorAdvancePastEOF);
+    QCOMPARE(cbor_document_index_map_find_value(&index, 2, "a", &found), CborErrorAdvancePastEOF);
+
+    err = cbor_value_validate_and_index(&w.first, CborValidateStrictMode, &index, entries, 8);
+    QCOMPARE(err, CborErrorUnknownLength);
+
+    err = cbor_value_validate_and_index(&w.first, CborValidateCompleteData, &index, entries, 8);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+    QCOMPARE(cbor_document_index_get_count(&index), size_t(8));
+    QCOMPARE(cbor_document_index_get_required_count(&index), size_t(8));
+
+    struct Expected { uint32_t offset, end, next, count; CborType type; uint8_t flags; };
+    static const Expected expected[] = {
+        { 0, 21, 8, 3, CborArrayType, 0 },
+        { 1, 2, 2, 0, CborIntegerType, 0 },
+        { 2, 19, 7, 4, CborMapType, 0 },
+        { 3, 5, 4, 1, CborTextStringType, 0 },
+        { 5, 8, 5, 2, CborByteStringType, 0 },
+        { 8, 12, 6, 1, CborTextStringType, CborIndexEntryFlag_IndefiniteLength },
+        { 12, 19, 7, 3, CborTextStringType, CborIndexEntryFlag_IndefiniteLength },
+        { 19, 21, 8, 0, CborIntegerType, CborIndexEntryFlag_Tagged }
+    };
+    for (size_t i = 0; i < 8; ++i) {
+        const CborIndexEntry *entry = cbor_document_index_get_entry(&index, i);
+        QVERIFY(entry);
+        QCOMPARE(entry->offset, expected[i].offset);
+        QCOMPARE(entry->end, expected[i].end);
+        QCOMPARE(entry->next, expected[i].next);
+        QCOMPARE(entry->count, expected[i].count);
+        QCOMPARE(int(entry->type), int(expected[i].type));
+        QCOMPARE(int(entry->flags), int(expected[i].flags));
+    }
+    QVERIFY(!cbor_document_index_get_entry(&index, 8));
+
+    // zero-copy access to strings
+    const uint8_t *ptr;
+    size_t len;
+    QCOMPARE(cbor_document_index_get_string(&index, 4, &ptr, &len), CborNoError);
+    QCOMPARE(QByteArray(reinterpret_cast<const char *>(ptr), int(len)), raw("\1\2"));
+    QCOMPARE(cbor_document_index_get_string(&index, 6, &ptr, &len), CborErrorUnknownLength);
+    QCOMPARE(cbor_document_index_get_string(&index, 1, &ptr, &len), CborErrorIllegalType);
+
+    // random access with the iterator API
+    CborValue value;
+    int64_t n;
+    QCOMPARE(cbor_document_index_get_value(&index, 7, &value), CborNoError);
+    QVERIFY(cbor_value_is_tag(&value));
+    QCOMPARE(cbor_value_skip_tag(&value), CborNoError);
+    QCOMPARE(cbor_value_get_int64(&value, &n), CborNoError);
+    QCOMPARE(n, int64_t(2));
+    QCOMPARE(cbor_value_advance(&value), CborNoError);
+    QVERIFY(cbor_value_at_end(&value));
+    QCOMPARE(cbor_document_index_get_value(&index, 8, &value), CborErrorAdvancePastEOF);
+    QVERIFY(!cbor_value_is_valid(&value));
+
+    // map lookups
+    size_t position;
+    QCOMPARE(cbor_document_index_map_find_value(&index, 2, "a", &position), CborNoError);
+    QCOMPARE(position, size_t(4));
+    QCOMPARE(cbor_document_index_map_find_value(&index, 2, "b", &position), CborNoError);
+    QCOMPARE(position, size_t(6));
+    QCOMPARE(cbor_document_index_map_find_value(&index, 2, "cde", &position), CborNoError);
+    QCOMPARE(position, size_t(0));
+    QCOMPARE(cbor_document_index_map_find_value(&index, 0, "a", &position), CborErrorIllegalType);
+}
+
 QTEST_MAIN(tst_Parser)
 #include "tst_parser.moc"
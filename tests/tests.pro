@@ -1,3 +1,3 @@
 TEMPLATE = subdirs
-SUBDIRS = parser encoder cpp tojson
+SUBDIRS = parser encoder cpp tojson fromjson
 msvc: SUBDIRS -= tojson
@@ -73,6 +73,9 @@ private slots:
     void metaDataAndTagsToObjects();
     void metaDataForKeys_data();
     void metaDataForKeys();
+    void invalidUtf8_data();
+    void invalidUtf8();
+    void arenaAllocator();
 };
 #include "tst_tojson.moc"
 
@@ -100,6 +103,8 @@ void addFixedData()
     QTest::newRow("-2") << raw("\x21") << "-2";
     QTest::newRow("-2^53+1") << raw("\x3b\0\x1f\xff\xff""\xff\xff\xff\xfe") << "-9007199254740991";
     QTest::newRow("-2^64+epsilon") << raw("\x3b\xff\xff\xff\xff""\xff\xff\xf8\x00") << "-18446744073709549568";
+    QTest::newRow("-(2^64-epsilon)") << raw("\x3b\xff\xff\xff\xff""\xff\xff\xf7\xff") << "-18446744073709549568";
+    QTest::newRow("-2^64") << raw("\x3b\xff\xff\xff\xff""\xff\xff\xff\xff") << "-18446744073709551616";
 
     QTest::newRow("false") << raw("\xf4") << "false";
     QTest::newRow("true") << raw("\xf5") << "true";
@@ -126,6 +131,13 @@ void addFixedData()
     QTest::newRow("2.f^64") << raw("\xfa\x5f\x80\0\0") << "1.8446744073709552e+19";
     QTest::newRow("2.^64") << raw("\xfb\x43\xf0\0\0\0\0\0\0") << "1.8446744073709552e+19";
 
+    // shortest representation that reads back as the same double
+    QTest::newRow("0.1") << raw("\xfb\x3f\xb9\x99\x99""\x99\x99\x99\x9a") << "0.1";
+    QTest::newRow("1.e-5") << raw("\xfb\x3e\xe4\xf8\xb5""\x88\xe3\x68\xf1") << "1e-05";
+    QTest::newRow("-2.5e-7") << raw("\xfb\xbe\x90\xc6\xf7""\xa0\xb5\xed\x8d") << "-2.5e-07";
+    QTest::newRow("1.e300") << raw("\xfb\x7e\x37\xe4\x3c""\x88\x00\x75\x9c") << "1e+300";
+    QTest::newRow("1.f/3") << raw("\xfa\x3e\xaa\xaa\xab") << "0.3333333432674408";
+
     // infinities and NaN are not supported in JSON, they convert to null
     QTest::newRow("nan_f16") << raw("\xf9\x7e\x00") << "null";
     QTest::newRow("nan_f") << raw("\xfa\x7f\xc0\0\0") << "null";
@@ -155,6 +167,19 @@ void addTextStringsData()
     QTest::newRow("_textstring5*2") << raw("\x7f\x63Hel\x62lo\xff") << "\"Hello\"";
     QTest::newRow("_textstring5*5") << raw("\x7f\x61H\x61""e\x61l\x61l\x61o\xff") << "\"Hello\"";
     QTest::newRow("_textstring5*6") << raw("\x7f\x61H\x61""e\x61l\x60\x61l\x61o\xff") << "\"Hello\"";
+
+    // characters that need escaping
+    QTest::newRow("textstring-quote") << raw("\x61\"") << "\"\\\"\"";
+    QTest::newRow("textstring-backslash") << raw("\x61\\") << "\"\\\\\"";
+    QTest::newRow("textstring-shortescapes") << raw("\x65\b\f\n\r\t") << "\"\\b\\f\\n\\r\\t\"";
+    QTest::newRow("textstring-controls") << raw("\x64\0\1\x0b\x1f") << "\"\\u0000\\u0001\\u000B\\u001F\"";
+    QTest::newRow("textstring-nonascii") << raw("\x65\x7f\xe2\x82\xac/")
+                                         << QString::fromLatin1("\"\x7f\xe2\x82\xac/\"");
+    QTest::newRow("textstring40-quote") << raw("\x78\x28") + QByteArray(39, 'a') + '"'
+                                        << '"' + QString(39, 'a') + "\\\"\"";
+    QTest::newRow("textstring40-newlines") << raw("\x78\x28") + QByteArray(40, '\n')
+                                           << '"' + QString("\\n").repeated(40) + '"';
+    QTest::newRow("_textstring-escapes") << raw("\x7f\x62\"a\x60\x62\\\n\xff") << "\"\\\"a\\\\\\n\"";
 }
 
 void addNonJsonData()
@@ -227,12 +252,55 @@ void compareOne_real(const QByteArray &data, const QString &expected, int flags,
     // check that we consumed everything
     QCOMPARE((void*)cbor_value_get_next_byte(&first), (void*)data.constEnd());
 
+    // the conversion to a memory buffer must produce the same
+    CborGrowableBuffer buffer;
+    cbor_growable_buffer_init(&buffer, nullptr, 0);
+    cbor_parser_init(reinterpret_cast<const quint8 *>(data.constData()), data.length(), 0, &parser, &first);
+    err = cbor_value_to_json_buffer_advance(&buffer, &first, flags);
+    decoded = QString::fromLatin1(reinterpret_cast<const char *>(buffer.data), int(buffer.size));
+    cbor_growable_buffer_free(&buffer);
+    QVERIFY2(!err, QByteArray::number(line) + ": Got error \"" + cbor_error_string(err) + "\"");
+    QCOMPARE(decoded, expected);
+    QCOMPARE((void*)cbor_value_get_next_byte(&first), (void*)data.constEnd());
+
     compareFailed = false;
 }
 #define compareOne(data, expected, flags) \
     compareOne_real(data, expected, flags, __LINE__); \
     if (compareFailed) return
 
+void tst_ToJson::invalidUtf8_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::newRow("overlong") << raw("\x62\xc0\x80");
+    QTest::newRow("surrogate") << raw("\x63\xed\xa0\x80");
+    QTest::newRow("truncated") << raw("\x61\xc3");
+    QTest::newRow("continuation") << raw("\x61\xa9");
+    QTest::newRow("split-chunks") << raw("\x7f\x61\xc3\x61\xa9\xff");
+    QTest::newRow("in-array") << raw("\x82\x61""a\x61\xff");
+    QTest::newRow("map-key") << raw("\xa1\x62\xc3\x28\x01");
+}
+
+void tst_ToJson::invalidUtf8()
+{
+    QFETCH(QByteArray, data);
+    for (int flags : { int(CborConvertDefaultFlags), int(CborConvertAddMetadata) }) {
+        CborParser parser;
+        CborValue first;
+        QCOMPARE(cbor_parser_init(reinterpret_cast<const quint8 *>(data.constData()), data.length(), 0,
+                                  &parser, &first), CborNoError);
+        QString decoded;
+        QCOMPARE(parseOne(&first, &decoded, flags), CborErrorInvalidUtf8TextString);
+
+        CborGrowableBuffer buffer;
+        cbor_growable_buffer_init(&buffer, nullptr, 0);
+        cbor_parser_init(reinterpret_cast<const quint8 *>(data.constData()), data.length(), 0, &parser, &first);
+        CborError err = cbor_value_to_json_buffer_advance(&buffer, &first, flags);
+        cbor_growable_buffer_free(&buffer);
+        QCOMPARE(err, CborErrorInvalidUtf8TextString);
+    }
+}
+
 void tst_ToJson::initTestCase()
 {
     setlocale(LC_ALL, "C");
@@ -474,6 +542,12 @@ void tst_ToJson::taggedByteStringsToBase16_data()
                                   << "MTIzNDU2Nzg5MDEyMzQ1Njc4OTAxMjM0"
                                   << "MTIzNDU2Nzg5MDEyMzQ1Njc4OTAxMjM0"
                                   << "313233343536373839303132333435363738393031323334";
+    QTest::newRow("bytestring6-62-63") << raw("\x46\xfb\xef\xbe\xff\xff\xff") << "----____" << "++++////"
+                                       << "fbefbeffffff";
+    QTest::newRow("bytestring64") << raw("\x58\x40") + QByteArray::fromHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f")
+                                  << "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0-Pw"
+                                  << "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw=="
+                                  << "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f";
 
     // strings with undefined length
     QTest::newRow("_emptybytestring") << raw("\x5f\xff") << "" << "" << "";
@@ -484,6 +558,12 @@ void tst_ToJson::taggedByteStringsToBase16_data()
                                     << "SGVsbG8" << "SGVsbG8=" << "48656c6c6f";
     QTest::newRow("_bytestring5*6") << raw("\x5f\x41H\x41""e\x40\x41l\x41l\x41o\xff")
                                     << "SGVsbG8" << "SGVsbG8=" << "48656c6c6f";
+    QTest::newRow("_bytestring64*3") << raw("\x5f\x41") + QByteArray::fromHex("00")
+                                         + raw("\x58\x21") + QByteArray::fromHex("0102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f2021")
+                                         + raw("\x58\x1e") + QByteArray::fromHex("22232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f") + raw("\xff")
+                                     << "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0-Pw"
+                                     << "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw=="
+                                     << "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f";
 }
 
 void tst_ToJson::taggedByteStringsToBase16()
@@ -552,7 +632,7 @@ void tst_ToJson::metaData_data()
     QTest::newRow("-1") << raw("\x20") << QString();
     QTest::newRow("-2") << raw("\x21") << QString();
     QTest::newRow("-2^53+1") << raw("\x3b\0\x1f\xff\xff""\xff\xff\xff\xfe") << QString();
-    QTest::newRow("-2^64+epsilon") << raw("\x3b\xff\xff\xff\xff""\xff\xff\xf8\x00") << QString();
+    QTest::newRow("-(2^64-epsilon)") << raw("\x3b\xff\xff\xff\xff""\xff\xff\xf7\xff") << QString();
     QTest::newRow("emptytextstring") << raw("\x60") << QString();
     QTest::newRow("textstring1") << raw("\x61 ") << QString();
     QTest::newRow("0.5") << raw("\xfb\x3f\xe0\0\0\0\0\0\0") << QString();
@@ -591,6 +671,10 @@ void tst_ToJson::metaData_data()
                                  << "\"t\":0,\"v\":\"+8000000000000001\"";
     QTest::newRow("-2^53-1") << raw("\x3b\0\x20\0\0""\0\0\0\0")
                              << "\"t\":0,\"v\":\"-20000000000000\"";
+    QTest::newRow("-2^64+epsilon") << raw("\x3b\xff\xff\xff\xff""\xff\xff\xf8\x00")
+                                   << "\"t\":0,\"v\":\"-fffffffffffff800\"";
+    QTest::newRow("-2^64") << raw("\x3b\xff\xff\xff\xff""\xff\xff\xff\xff")
+                           << "\"t\":0,\"v\":\"-ffffffffffffffff\"";
 
     // simple values
     QTest::newRow("simple0") << raw("\xe0") << "\"t\":224,\"v\":0";
@@ -718,4 +802,32 @@ void tst_ToJson::metaDataForKeys()
                CborConvertAddMetadata | CborConvertStringifyMapKeys);
 }
 
+void tst_ToJson::arenaAllocator()
+{
+    QByteArray data = raw("\xa3\x65Hello\x65World\x65""bytes\x44\1\2\3\4\x63hex\xd7\x42\xab\xcd");
+    alignas(16) char memory[64];
+    CborArena arena;
+    cbor_arena_init(&arena, memory, sizeof(memory));
+
+    CborParser parser;
+    CborValue first;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const quint8 *>(data.constData()), data.length(), 0, &parser, &first),
+             CborNoError);
+    cbor_parser_set_allocator(&parser, cbor_arena_get_allocator(&arena));
+
+    QString decoded;
+    QCOMPARE(parseOne(&first, &decoded, 0), CborNoError);
+    QCOMPARE(decoded, QString("{\"Hello\":\"World\",\"bytes\":\"AQIDBA\",\"hex\":\"abcd\"}"));
+
+    // all temporaries were freed in reverse order, so the arena is empty again
+    QCOMPARE(cbor_arena_get_used_size(&arena), size_t(0));
+
+    // an arena that is too small causes an allocation failure
+    cbor_arena_init(&arena, memory, 4);
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const quint8 *>(data.constData()), data.length(), 0, &parser, &first),
+             CborNoError);
+    cbor_parser_set_allocator(&parser, cbor_arena_get_allocator(&arena));
+    QCOMPARE(parseOne(&first, &decoded, 0), CborErrorOutOfMemory);
+}
+
 QTEST_MAIN(tst_ToJson)
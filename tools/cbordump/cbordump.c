@@ -47,6 +47,21 @@ void printerror(CborError err, const char *fname)
     exit(EXIT_FAILURE);
 }
 
+void dumpValue(CborValue *value, const uint8_t *end, const char *fname, bool printJson, int flags)
+{
+    CborError err;
+    if (printJson)
+        err = cbor_value_to_json_advance(stdout, value, flags);
+    else
+        err = cbor_value_to_pretty_advance_flags(stdout, value, flags);
+    if (!err)
+        puts("");
+    if (!err && cbor_value_get_next_byte(value) != end)
+        err = CborErrorGarbageAtEnd;
+    if (err)
+        printerror(err, fname);
+}
+
 void dumpFile(FILE *in, const char *fname, bool printJson, int flags)
 {
     static const size_t chunklen = 16 * 1024;
@@ -71,19 +86,32 @@ void dumpFile(FILE *in, const char *fname, bool printJson, int flags)
     CborParser parser;
     CborValue value;
     CborError err = cbor_parser_init(buffer, buflen, 0, &parser, &value);
-    if (!err) {
-        if (printJson)
-            err = cbor_value_to_json_advance(stdout, &value, flags);
-        else
-            err = cbor_value_to_pretty_advance_flags(stdout, &value, flags);
-        if (!err)
-            puts("");
+    if (err)
+        printerror(err, fname);
+    dumpValue(&value, buffer + buflen, fname, printJson, flags);
+}
+
+#ifndef WITHOUT_MMAP
+bool dumpMappedFile(const char *fname, bool printJson, int flags)
+{
+    CborMappedFile file;
+    CborParser parser;
+    CborValue value;
+    CborError err = cbor_parser_init_file(fname, 0, &file, &parser, &value);
+    if (err == CborErrorUnsupportedSource)
+        return false;       /* not a regular file, read it instead */
+    if (err == CborErrorIO) {
+        fprintf(stderr, "%s: %s\n", fname, strerror(errno));
+        exit(EXIT_FAILURE);
     }
-    if (!err && cbor_value_get_next_byte(&value) != buffer + buflen)
-        err = CborErrorGarbageAtEnd;
     if (err)
         printerror(err, fname);
+
+    dumpValue(&value, file.data + file.size, fname, printJson, flags);
+    cbor_mapped_file_close(&file);
+    return true;
 }
+#endif
 
 int main(int argc, char **argv)
 {
@@ -149,6 +177,11 @@ int main(int argc, char **argv)
         dumpFile(stdin, "-", printJson, printJson ? json_flags : cbor_flags);
     } else {
         for ( ; *fname; ++fname) {
+#ifndef WITHOUT_MMAP
+            /* map regular files instead of copying them into memory */
+            if (dumpMappedFile(*fname, printJson, printJson ? json_flags : cbor_flags))
+                continue;
+#endif
             FILE *in = fopen(*fname, "rb");
             if (!in) {
                 perror("open");
@@ -7,4 +7,5 @@ DESTDIR = ../../bin
 CBORDIR = $$PWD/../../src
 INCLUDEPATH += $$CBORDIR
 SOURCES += cbordump.c
+!unix: DEFINES += WITHOUT_MMAP
 LIBS += ../../lib/libtinycbor.a